@@ -0,0 +1,194 @@
+// OBJ 加载基准测试
+// 对比逐行 std::getline + std::stringstream 的旧解析器、基于 mmap + from_chars
+// 的并行解析器以及直接映射 .smesh 网格缓存, 测试数据为自带的模型和一个合成的大网格
+//
+// 用法: load_bench [--triangles N] [--repeat N] [--keep] [file.obj ...]
+// 不指定文件时测试 assets 下的两个模型和一个 N 个三角形 (默认 10M) 的合成网格
+
+#include "mesh_cache.h"
+#include "model.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifndef RENDERER_ASSET_DIR
+#define RENDERER_ASSET_DIR "assets"
+#endif
+
+namespace {
+
+// 旧版 Model::Model 的解析逻辑, 仅保留作为对比基准
+struct LegacyModel {
+    std::vector<Vec3f> vertices;
+    std::vector<int> faces;
+};
+
+LegacyModel legacy_load(const std::string &filename) {
+    LegacyModel model;
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open " << filename << '\n';
+        return model;
+    }
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::stringstream line_ss(line);
+        std::string prefix;
+        line_ss >> prefix;
+        if (prefix == "v") {
+            float x, y, z;
+            line_ss >> x >> y >> z;
+            model.vertices.push_back({x, y, z});
+        } else if (prefix == "f") {
+            std::string seg;
+            while (line_ss >> seg) {
+                std::stringstream seg_ss(seg);
+                int index;
+                seg_ss >> index;
+                model.faces.push_back(--index);
+            }
+        }
+    }
+    return model;
+}
+
+// 生成 n x n 个格子 (2 * n * n 个三角形) 的网格, 带 vt 和 vn
+bool write_synthetic_obj(const std::string &filename, long long triangles) {
+    const int n = std::max(1, static_cast<int>(std::sqrt(triangles / 2.0)));
+    std::FILE *out = std::fopen(filename.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Failed to open file " << filename << ".\n";
+        return false;
+    }
+
+    std::vector<char> buffer(1 << 20);
+    std::setvbuf(out, buffer.data(), _IOFBF, buffer.size());
+    std::fprintf(out, "# synthetic grid %dx%d\n", n, n);
+    for (int y = 0; y <= n; ++y) {
+        for (int x = 0; x <= n; ++x) {
+            float u = static_cast<float>(x) / n, v = static_cast<float>(y) / n;
+            std::fprintf(out, "v %.6f %.6f %.6f\n", u * 2 - 1, v * 2 - 1,
+                         0.1f * std::sin(u * 20) * std::cos(v * 20));
+        }
+    }
+    for (int y = 0; y <= n; ++y) {
+        for (int x = 0; x <= n; ++x)
+            std::fprintf(out, "vt %.4f %.4f 0.0\n", static_cast<float>(x) / n,
+                         static_cast<float>(y) / n);
+    }
+    for (int i = 0; i < (n + 1) * (n + 1); ++i) std::fputs("vn 0 0 1\n", out);
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
+            int a = y * (n + 1) + x + 1, b = a + 1, c = a + n + 1, d = c + 1;
+            std::fprintf(out, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b,
+                         b, d, d, d);
+            std::fprintf(out, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, d, d,
+                         d, c, c, c);
+        }
+    }
+    return std::fclose(out) == 0;
+}
+
+// 多次运行取最短耗时, 单位毫秒
+template <typename Function> double time_ms(int repeat, Function &&function) {
+    double best = 0;
+    for (int i = 0; i < repeat; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        function();
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        best = i ? std::min(best, ms) : ms;
+    }
+    return best;
+}
+
+void bench_file(const std::string &filename, int repeat) {
+    int legacy_vertices = 0, legacy_faces = 0;
+    int vertices = 0, faces = 0;
+
+    // 加载时 Model 会向 std::cerr 打印统计信息, 计时期间屏蔽
+    std::streambuf *cerr_buffer = std::cerr.rdbuf(nullptr);
+    double legacy = time_ms(repeat, [&]() {
+        LegacyModel model = legacy_load(filename);
+        legacy_vertices = model.vertices.size();
+        legacy_faces = model.faces.size() / 3;
+    });
+    double current = time_ms(repeat, [&]() {
+        Model model(filename);
+        vertices = model.num_vertices();
+        faces = model.num_faces();
+    });
+
+    // 缓存写到临时目录, 记录的源文件不在同一目录, 打开时不做过期检查
+    const std::string cache =
+        (std::filesystem::temp_directory_path() /
+         std::filesystem::path(mesh_cache_path(filename)).filename())
+            .string();
+    double cached = 0;
+    if (Model(filename).write_cache(cache, filename)) {
+        cached = time_ms(repeat, [&]() {
+            Model model(cache);
+            if (model.num_faces() != faces) vertices = -1;
+        });
+        std::filesystem::remove(cache);
+    }
+    std::cerr.rdbuf(cerr_buffer);
+    std::cerr.clear();
+
+    std::printf("%-40s %10d %10d %12.2f %12.2f %12.3f %8.2fx%s\n",
+                std::filesystem::path(filename).filename().string().c_str(),
+                vertices, faces, legacy, current, cached, legacy / current,
+                vertices == legacy_vertices && faces == legacy_faces
+                    ? ""
+                    : "  (count mismatch)");
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    long long triangles = 10'000'000;
+    int repeat = 3;
+    bool keep = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--triangles" && i + 1 < argc) {
+            triangles = std::atoll(argv[++i]);
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--keep") {
+            keep = true;
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    std::string synthetic;
+    if (files.empty()) {
+        files.push_back(RENDERER_ASSET_DIR "/african_head/african_head.obj");
+        files.push_back(RENDERER_ASSET_DIR "/diablo3_pose/diablo3_pose.obj");
+        if (triangles > 0) {
+            synthetic = (std::filesystem::temp_directory_path() /
+                         "load_bench_synthetic.obj")
+                            .string();
+            std::cerr << "Writing synthetic mesh " << synthetic << '\n';
+            if (!write_synthetic_obj(synthetic, triangles)) return 1;
+            files.push_back(synthetic);
+        }
+    }
+
+    std::printf("%-40s %10s %10s %12s %12s %12s %9s\n", "file", "vertices",
+                "faces", "legacy ms", "current ms", "cache ms", "speedup");
+    for (const std::string &file : files) bench_file(file, repeat);
+
+    if (!synthetic.empty() && !keep) std::filesystem::remove(synthetic);
+    return 0;
+}
@@ -0,0 +1,1271 @@
+// 渲染器基准测试
+// 包括 line_draw / barycentric_coordinates / 单个三角形光栅化 / TGA 编解码与图像变换 /
+// OBJ 加载等微基准, 以及用自带模型在多种分辨率下渲染整帧的端到端场景
+// 所有随机输入都使用固定种子生成, 每次运行的工作量完全相同
+//
+// 用法: renderer_bench [--repeat N] [--filter 子串] [--out file.json]
+//                      [--compare baseline.json] [--threshold 比例] [--list]
+//        renderer_bench --check-allocs
+//        renderer_bench --check-cracks
+// 结果写成 JSON (默认 renderer_bench.json), 可以直接作为之后 --compare 的基准
+// --compare 逐项比较中位数耗时, 比基准慢超过 threshold (默认 0.10) 的项视为回归,
+// 存在回归时返回 1
+// --check-allocs 用各种模式连续渲染多帧, 统计预热之后每帧的堆分配次数, 不为 0 时返回 1
+// --check-cracks 以不同的块大小流式渲染, 与内存中渲染的结果比较, 块的接缝处有裂缝时返回 1
+
+#include "animation.h"
+#include "depth_buffer.h"
+#include "frame_writer.h"
+#include "framebuffer.h"
+#include "image_transform.h"
+#include "line_draw.h"
+#include "mesh_cache.h"
+#include "mesh_optimize.h"
+#include "mesh_stream.h"
+#include "meshlet.h"
+#include "model.h"
+#include "msaa.h"
+#include "rasterizer.h"
+#include "shader_pipeline.h"
+#include "shaders.h"
+#include "tga_image.h"
+#include "texture.h"
+#include "wireframe.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <omp.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifndef RENDERER_ASSET_DIR
+#define RENDERER_ASSET_DIR "assets"
+#endif
+
+namespace fs = std::filesystem;
+
+// 堆分配计数: 替换全局的 operator new, 每次分配加 1, 供 --check-allocs 使用
+// 数组与 nothrow 版本的默认实现都调用这里的两个版本
+// 都不内联, 否则编译器在调用处看到 operator new 与 free 配对而误报不匹配
+static std::atomic<std::int64_t> heap_allocations{0};
+
+[[gnu::noinline]] void *operator new(std::size_t size) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void *operator new(std::size_t size, std::align_val_t align) {
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::size_t alignment = static_cast<std::size_t>(align);
+    // aligned_alloc 要求大小为对齐的整数倍
+    if (void *p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))
+        return p;
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void *p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+constexpr std::uint32_t bench_seed = 20240601;
+
+struct Benchmark {
+    std::string name;
+    std::function<void()> setup;         // 每次计时前调用, 不计入耗时
+    std::function<std::int64_t()> run;   // 返回处理的元素个数, 用于计算吞吐
+};
+
+struct Result {
+    std::string name;
+    double min_ms = 0, median_ms = 0;
+    std::int64_t items = 0;
+};
+
+// 防止编译器把只为计时而做的计算优化掉
+volatile float float_sink = 0;
+
+// Model 与 TgaImage 加载时向 std::cerr 打印信息, 计时期间屏蔽
+class CerrSilencer {
+  private:
+    std::streambuf *buffer_;
+
+  public:
+    CerrSilencer() : buffer_(std::cerr.rdbuf(nullptr)) {}
+    ~CerrSilencer() {
+        std::cerr.rdbuf(buffer_);
+        std::cerr.clear();
+    }
+};
+
+// 预热一次, 再运行 repeat 次, 记录最短与中位数耗时
+Result measure(const Benchmark &benchmark, int repeat) {
+    std::vector<double> times;
+    Result result;
+    result.name = benchmark.name;
+    for (int i = 0; i <= repeat; ++i) {
+        if (benchmark.setup) benchmark.setup();
+        auto start = std::chrono::steady_clock::now();
+        std::int64_t items = benchmark.run();
+        auto end = std::chrono::steady_clock::now();
+        if (!i) continue;
+        times.push_back(
+            std::chrono::duration<double, std::milli>(end - start).count());
+        result.items = items;
+    }
+    std::sort(times.begin(), times.end());
+    result.min_ms = times.front();
+    result.median_ms = times[times.size() / 2];
+    return result;
+}
+
+struct Asset {
+    std::string name;
+    std::string path;
+    std::unique_ptr<Model> model;
+};
+
+std::vector<Asset> load_assets() {
+    std::vector<Asset> assets;
+    for (const char *name : {"african_head", "diablo3_pose"}) {
+        Asset asset;
+        asset.name = name;
+        asset.path = std::string(RENDERER_ASSET_DIR "/") + name + "/" + name + ".obj";
+        {
+            CerrSilencer silencer;
+            asset.model = std::make_unique<Model>(asset.path);
+        }
+        if (!asset.model->num_faces()) {
+            std::cerr << "Failed to load " << asset.path << '\n';
+            continue;
+        }
+        assets.push_back(std::move(asset));
+    }
+    return assets;
+}
+
+// 边长约为 size 个像素的逆时针直角三角形, 位置与深度随机, 完全位于帧缓冲内
+std::vector<Vec3f> random_triangles(int count, float size, int width,
+                                    int height, std::uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> x_dist(0.f, width - 1 - size);
+    std::uniform_real_distribution<float> y_dist(0.f, height - 1 - size);
+    std::uniform_real_distribution<float> z_dist(0.f, 1.f);
+    std::vector<Vec3f> vertices;
+    vertices.reserve(count * 3);
+    for (int i = 0; i < count; ++i) {
+        const float x = x_dist(rng), y = y_dist(rng);
+        vertices.push_back({x, y, z_dist(rng)});
+        vertices.push_back({x + size, y, z_dist(rng)});
+        vertices.push_back({x, y + size, z_dist(rng)});
+    }
+    return vertices;
+}
+
+void add_micro_benchmarks(std::vector<Benchmark> &benchmarks,
+                          const std::vector<Asset> &assets) {
+    // line_draw: 与 line_draw 注释中的测试相同, 坐标范围 [0, 64)
+    {
+        auto lines = std::make_shared<std::vector<int>>();
+        std::mt19937 rng(bench_seed);
+        std::uniform_int_distribution<int> dist(0, 63);
+        for (int i = 0; i < (1 << 20) * 4; ++i) lines->push_back(dist(rng));
+        auto image = std::make_shared<TgaImage>(64, 64, TgaImage::RGB);
+        benchmarks.push_back({"line_draw", nullptr, [lines, image]() {
+                                  const TgaColor white = {255, 255, 255, 255};
+                                  const std::vector<int> &l = *lines;
+                                  for (std::size_t i = 0; i < l.size(); i += 4)
+                                      line_draw(l[i], l[i + 1], l[i + 2],
+                                                l[i + 3], *image, white);
+                                  return static_cast<std::int64_t>(l.size() / 4);
+                              }});
+    }
+
+    // barycentric_coordinates: 随机点相对固定三角形
+    {
+        auto points = std::make_shared<std::vector<Vec2f>>();
+        std::mt19937 rng(bench_seed);
+        std::uniform_real_distribution<float> dist(0.f, 1024.f);
+        for (int i = 0; i < 1 << 22; ++i)
+            points->push_back({dist(rng), dist(rng)});
+        benchmarks.push_back(
+            {"barycentric_coordinates", nullptr, [points]() {
+                 const Vec2f a{10.f, 20.f}, b{1000.f, 40.f}, c{500.f, 990.f};
+                 float sum = 0;
+                 for (const Vec2f &p : *points) {
+                     auto [alpha, beta, gamma] =
+                         barycentric_coordinates(p, a, b, c);
+                     sum += alpha + beta * 2 + gamma * 3;
+                 }
+                 float_sink = sum;
+                 return static_cast<std::int64_t>(points->size());
+             }});
+    }
+
+    // 单个三角形光栅化, 原始重心坐标实现与边函数实现
+    // 尺寸对应边函数实现的大小分类: subpixel 大多不覆盖像素中心 (EMPTY),
+    // tiny / small 大多是 TINY, medium 为 MEDIUM, large 为 LARGE
+    {
+        constexpr int size = 1024;
+        auto frame = std::make_shared<Framebuffer<PixelFormat::RGB>>(size, size);
+        auto depth = std::make_shared<DepthBuffer>(size, size);
+        const RasterPath edge_path = select_raster_path(RasterPath::AUTO);
+        struct SizeClass {
+            const char *name;
+            float size;
+            int count;
+        };
+        for (const SizeClass &size_class :
+             {SizeClass{"subpixel", 0.5f, 1 << 18}, SizeClass{"tiny", 2.f, 1 << 17},
+              SizeClass{"small", 4.f, 1 << 16}, SizeClass{"medium", 32.f, 1 << 12},
+              SizeClass{"large", 512.f, 16}}) {
+            auto vertices = std::make_shared<std::vector<Vec3f>>(
+                random_triangles(size_class.count, size_class.size, size, size,
+                                 bench_seed));
+            for (RasterPath path : {RasterPath::BARYCENTRIC, edge_path}) {
+                benchmarks.push_back(
+                    {std::string("triangle_rasterize/") + size_class.name +
+                         "/" + raster_path_name(path),
+                     [depth]() { depth->clear(); },
+                     [vertices, frame, depth, path]() {
+                         const TgaColor color = {200, 100, 50, 255};
+                         const std::vector<Vec3f> &v = *vertices;
+                         std::int64_t tested = 0;
+                         for (std::size_t i = 0; i < v.size(); i += 3) {
+                             if (path == RasterPath::BARYCENTRIC) {
+                                 tested += triangle_rasterize(
+                                     v[i], v[i + 1], v[i + 2], *frame, *depth,
+                                     color);
+                             } else {
+                                 tested += triangle_rasterize_edge(
+                                     v[i], v[i + 1], v[i + 2], *frame, *depth,
+                                     pack_color(color), 0, 0, size - 1, size - 1, path,
+                                     true);
+                             }
+                         }
+                         return tested;
+                     }});
+            }
+        }
+    }
+
+    // TGA 编解码、翻转与旋转, 图像为第一个模型渲染出的 1024x1024 帧
+    if (!assets.empty()) {
+        auto pixels = std::make_shared<Framebuffer<PixelFormat::RGB>>(1024, 1024);
+        DepthBuffer depth(1024, 1024);
+        rasterize(*assets.front().model, *pixels, depth);
+        // 包装帧缓冲, 像素由 pixels 持有, 各基准通过捕获 pixels 保证其生命周期
+        auto frame = std::make_shared<TgaImage>(TgaImage::wrap(*pixels));
+        const std::string filename =
+            (fs::temp_directory_path() / "renderer_bench.tga").string();
+        const std::int64_t count = 1024 * 1024;
+
+        benchmarks.push_back({"tga/rle_encode", nullptr, [pixels, frame, filename, count]() {
+                                  frame->write_tga_file(filename);
+                                  return count;
+                              }});
+        benchmarks.push_back({"tga/rle_decode",
+                              [pixels, frame, filename]() {
+                                  if (!fs::exists(filename))
+                                      frame->write_tga_file(filename);
+                              },
+                              [filename, count]() {
+                                  CerrSilencer silencer;
+                                  TgaImage image;
+                                  image.read_tga_file(filename);
+                                  return count;
+                              }});
+        benchmarks.push_back({"tga/flip_horizontally", nullptr, [pixels, frame, count]() {
+                                  frame->flip_horizontally();
+                                  return count;
+                              }});
+        benchmarks.push_back({"tga/flip_vertically", nullptr, [pixels, frame, count]() {
+                                  frame->flip_vertically();
+                                  return count;
+                              }});
+        auto rotated = std::make_shared<Framebuffer<PixelFormat::RGB>>(1024, 1024);
+        benchmarks.push_back({"image/transpose", nullptr, [pixels, rotated, count]() {
+                                  transpose(pixels->data(), 1024, 1024, 3, rotated->data());
+                                  return count;
+                              }});
+        benchmarks.push_back({"image/rotate_90_cw", nullptr, [pixels, rotated, count]() {
+                                  rotate_90_cw(pixels->data(), 1024, 1024, 3, rotated->data());
+                                  return count;
+                              }});
+    }
+
+    // OBJ 解析与直接映射网格缓存
+    for (const Asset &asset : assets) {
+        const std::string path = asset.path;
+        const std::int64_t faces = asset.model->num_faces();
+        benchmarks.push_back({"obj_load/" + asset.name, nullptr, [path, faces]() {
+                                  CerrSilencer silencer;
+                                  Model model(path);
+                                  return faces;
+                              }});
+
+        // 缓存写到临时目录, 记录的源文件不在同一目录, 打开时不做过期检查
+        const std::string cache =
+            (fs::temp_directory_path() / (asset.name + ".smesh")).string();
+        std::error_code ec;
+        fs::remove(cache, ec);
+        const Model *model = asset.model.get();
+        benchmarks.push_back({"obj_load/" + asset.name + ".smesh",
+                              [model, cache, path]() {
+                                  if (!fs::exists(cache))
+                                      model->write_cache(cache, path);
+                              },
+                              [cache, faces]() {
+                                  CerrSilencer silencer;
+                                  Model model(cache);
+                                  return faces;
+                              }});
+    }
+}
+
+// 着色管线的对照: 手写的光栅化循环, 覆盖、深度与插值和 triangle_rasterize_shaded 相同,
+// 插值的个数固定、着色直接写在内循环里, 用来衡量模板管线的抽象开销
+struct HandwrittenTriangle {
+    FixedPointTriangle fixed;
+    int x_min, y_min, x_max, y_max;
+    float z_lo, z_hi;
+    double q[3][8], inv_area;
+    float dqdx[8];
+};
+
+// 求出包围盒与插值量 (深度, 1 / w, varyings / w) 的增量, 三角形被剔除时返回 false
+template <int N>
+bool handwritten_setup(const TriangleSetup &setup, const ShadedTriangle<N> &triangle,
+                       DepthBuffer &depth_buffer, int clip_x_min, int clip_y_min,
+                       int clip_x_max, int clip_y_max, HandwrittenTriangle &t) {
+    if (!t.fixed.setup(setup.p0, setup.p1, setup.p2)) return false;
+    t.x_min = std::max(t.fixed.x_min, clip_x_min);
+    t.x_max = std::min(t.fixed.x_max, clip_x_max);
+    t.y_min = std::max(t.fixed.y_min, clip_y_min);
+    t.y_max = std::min(t.fixed.y_max, clip_y_max);
+    if (t.x_min > t.x_max || t.y_min > t.y_max) return false;
+    t.z_lo = std::min(std::min(setup.p0.z, setup.p1.z), setup.p2.z);
+    t.z_hi = std::max(std::max(setup.p0.z, setup.p1.z), setup.p2.z);
+    if (depth_buffer.is_occluded(t.x_min, t.y_min, t.x_max, t.y_max, t.z_hi)) return false;
+    const float z[3] = {setup.p0.z, setup.p1.z, setup.p2.z};
+    for (int j = 0; j < 3; ++j) {
+        t.q[j][0] = z[j];
+        t.q[j][1] = triangle.inv_w[j];
+        for (int k = 0; k < N; ++k) t.q[j][k + 2] = triangle.varyings[j][k];
+    }
+    t.inv_area = 1.0 / static_cast<double>(t.fixed.area);
+    for (int m = 0; m < N + 2; ++m) {
+        t.dqdx[m] = static_cast<float>((t.fixed.a[0] * t.q[0][m] + t.fixed.a[1] * t.q[1][m] +
+                                        t.fixed.a[2] * t.q[2][m]) *
+                                       t.inv_area);
+    }
+    return true;
+}
+
+float handwritten_row(const HandwrittenTriangle &t, const std::int64_t edge_row[3], int m) {
+    return static_cast<float>(
+        (edge_row[0] * t.q[0][m] + edge_row[1] * t.q[1][m] + edge_row[2] * t.q[2][m]) *
+        t.inv_area);
+}
+
+// 平面着色: 只插值深度, 颜色按面取
+std::int64_t handwritten_flat(const PackedPixel *face_pixels, const TriangleSetup &setup,
+                              const ShadedTriangle<0> &triangle,
+                              Framebuffer<PixelFormat::RGB> &frame_buffer,
+                              DepthBuffer &depth_buffer, int clip_x_min, int clip_y_min,
+                              int clip_x_max, int clip_y_max) {
+    HandwrittenTriangle t;
+    if (!handwritten_setup(setup, triangle, depth_buffer, clip_x_min, clip_y_min, clip_x_max,
+                           clip_y_max, t))
+        return 0;
+    const PackedPixel color = face_pixels[triangle.face];
+    std::int64_t tested = 0;
+    std::int64_t edge_row[3];
+    for (int i = 0; i < 3; ++i) edge_row[i] = t.fixed.edge(i, t.x_min, t.y_min);
+    for (int y = t.y_min; y <= t.y_max; ++y) {
+        const float z_row0 = handwritten_row(t, edge_row, 0);
+        float *z_row = depth_buffer.row(y);
+        std::uint8_t *color_row = frame_buffer.row(y);
+        std::int64_t e0 = edge_row[0], e1 = edge_row[1], e2 = edge_row[2];
+        for (int x = t.x_min; x <= t.x_max;
+             ++x, e0 += t.fixed.a[0], e1 += t.fixed.a[1], e2 += t.fixed.a[2]) {
+            if ((e0 | e1 | e2) < 0) continue;
+            ++tested;
+            const float dx = static_cast<float>(x - t.x_min);
+            const float depth = std::min(t.z_hi, std::max(t.z_lo, z_row0 + t.dqdx[0] * dx));
+            if (!(depth > z_row[x])) continue;
+            z_row[x] = depth;
+            depth_buffer.mark_dirty(x, y);
+            Framebuffer<PixelFormat::RGB>::store(color_row + x * 3, color);
+        }
+        for (int i = 0; i < 3; ++i) edge_row[i] += t.fixed.b[i];
+    }
+    return tested;
+}
+
+// Gouraud 着色: 插值漫反射与高光两项
+std::int64_t handwritten_gouraud(const ShaderUniforms &uniforms, const TriangleSetup &setup,
+                                 const ShadedTriangle<2> &triangle,
+                                 Framebuffer<PixelFormat::RGB> &frame_buffer,
+                                 DepthBuffer &depth_buffer, int clip_x_min, int clip_y_min,
+                                 int clip_x_max, int clip_y_max) {
+    HandwrittenTriangle t;
+    if (!handwritten_setup(setup, triangle, depth_buffer, clip_x_min, clip_y_min, clip_x_max,
+                           clip_y_max, t))
+        return 0;
+    std::int64_t tested = 0;
+    std::int64_t edge_row[3];
+    for (int i = 0; i < 3; ++i) edge_row[i] = t.fixed.edge(i, t.x_min, t.y_min);
+    for (int y = t.y_min; y <= t.y_max; ++y) {
+        const float z0 = handwritten_row(t, edge_row, 0), w0 = handwritten_row(t, edge_row, 1);
+        const float d0 = handwritten_row(t, edge_row, 2), s0 = handwritten_row(t, edge_row, 3);
+        float *z_row = depth_buffer.row(y);
+        std::uint8_t *color_row = frame_buffer.row(y);
+        std::int64_t e0 = edge_row[0], e1 = edge_row[1], e2 = edge_row[2];
+        for (int x = t.x_min; x <= t.x_max;
+             ++x, e0 += t.fixed.a[0], e1 += t.fixed.a[1], e2 += t.fixed.a[2]) {
+            if ((e0 | e1 | e2) < 0) continue;
+            ++tested;
+            const float dx = static_cast<float>(x - t.x_min);
+            const float depth = std::min(t.z_hi, std::max(t.z_lo, z0 + t.dqdx[0] * dx));
+            if (!(depth > z_row[x])) continue;
+            z_row[x] = depth;
+            depth_buffer.mark_dirty(x, y);
+            const float w = 1.f / (w0 + t.dqdx[1] * dx);
+            const float diffuse = (d0 + t.dqdx[2] * dx) * w;
+            const float specular = (s0 + t.dqdx[3] * dx) * w;
+            Framebuffer<PixelFormat::RGB>::store(color_row + x * 3,
+                                                 shade_color(uniforms.albedo, diffuse, specular));
+        }
+        for (int i = 0; i < 3; ++i) edge_row[i] += t.fixed.b[i];
+    }
+    return tested;
+}
+
+// Phong 着色: 插值法线与世界空间的位置, 每个像素求光照
+std::int64_t handwritten_phong(const ShaderUniforms &uniforms, const TriangleSetup &setup,
+                               const ShadedTriangle<6> &triangle,
+                               Framebuffer<PixelFormat::RGB> &frame_buffer,
+                               DepthBuffer &depth_buffer, int clip_x_min, int clip_y_min,
+                               int clip_x_max, int clip_y_max) {
+    HandwrittenTriangle t;
+    if (!handwritten_setup(setup, triangle, depth_buffer, clip_x_min, clip_y_min, clip_x_max,
+                           clip_y_max, t))
+        return 0;
+    std::int64_t tested = 0;
+    std::int64_t edge_row[3];
+    for (int i = 0; i < 3; ++i) edge_row[i] = t.fixed.edge(i, t.x_min, t.y_min);
+    for (int y = t.y_min; y <= t.y_max; ++y) {
+        float row0[8];
+        for (int m = 0; m < 8; ++m) row0[m] = handwritten_row(t, edge_row, m);
+        float *z_row = depth_buffer.row(y);
+        std::uint8_t *color_row = frame_buffer.row(y);
+        std::int64_t e0 = edge_row[0], e1 = edge_row[1], e2 = edge_row[2];
+        for (int x = t.x_min; x <= t.x_max;
+             ++x, e0 += t.fixed.a[0], e1 += t.fixed.a[1], e2 += t.fixed.a[2]) {
+            if ((e0 | e1 | e2) < 0) continue;
+            ++tested;
+            const float dx = static_cast<float>(x - t.x_min);
+            const float depth = std::min(t.z_hi, std::max(t.z_lo, row0[0] + t.dqdx[0] * dx));
+            if (!(depth > z_row[x])) continue;
+            z_row[x] = depth;
+            depth_buffer.mark_dirty(x, y);
+            const float w = 1.f / (row0[1] + t.dqdx[1] * dx);
+            const Vec3f normal = Vec3f{(row0[2] + t.dqdx[2] * dx) * w,
+                                       (row0[3] + t.dqdx[3] * dx) * w,
+                                       (row0[4] + t.dqdx[4] * dx) * w}
+                                     .normalized();
+            const Vec3f position = {(row0[5] + t.dqdx[5] * dx) * w,
+                                    (row0[6] + t.dqdx[6] * dx) * w,
+                                    (row0[7] + t.dqdx[7] * dx) * w};
+            float diffuse, specular;
+            blinn_phong(uniforms, normal, position, diffuse, specular);
+            Framebuffer<PixelFormat::RGB>::store(color_row + x * 3,
+                                                 shade_color(uniforms.albedo, diffuse, specular));
+        }
+        for (int i = 0; i < 3; ++i) edge_row[i] += t.fixed.b[i];
+    }
+    return tested;
+}
+
+// 按 tile 并行光栅化几何阶段已经准备好的三角形, rasterize_triangle(i, x_min, y_min, x_max, y_max)
+template <int N, typename Rasterize>
+std::int64_t raster_prepared(const PipelineScratch<N> &scratch, int width, int height,
+                             const Rasterize &rasterize_triangle) {
+    const TileBins &bins = scratch.bins;
+    std::int64_t tested = 0;
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : tested)
+    for (int tile = 0; tile < bins.num_tiles(); ++tile) {
+        if (bins.empty(tile)) continue;
+        int x_min, y_min, x_max, y_max;
+        bins.tile_rect(tile, width, height, x_min, y_min, x_max, y_max);
+        for (int k = bins.tile_begin[tile]; k < bins.tile_begin[tile + 1]; ++k)
+            tested += rasterize_triangle(bins.triangles[k], x_min, y_min, x_max, y_max);
+    }
+    return tested;
+}
+
+// 端到端场景: 自带模型在多种分辨率下渲染整帧, 吞吐为做了深度测试的像素数
+void add_scene_benchmarks(std::vector<Benchmark> &benchmarks,
+                          const std::vector<Asset> &assets) {
+    for (const Asset &asset : assets) {
+        for (int size : {512, 1024, 2048}) {
+            auto frame = std::make_shared<Framebuffer<PixelFormat::RGB>>();
+            auto depth = std::make_shared<DepthBuffer>();
+            const Model *model = asset.model.get();
+            benchmarks.push_back(
+                {"scene/" + asset.name + "/" + std::to_string(size),
+                 [frame, depth, size]() {
+                     if (frame->get_width() != size)
+                         *frame = Framebuffer<PixelFormat::RGB>(size, size);
+                     frame->clear();
+                     if (depth->get_width() != size)
+                         *depth = DepthBuffer(size, size);
+                     depth->clear();
+                 },
+                 [frame, depth, model]() {
+                     RasterOptions options;
+                     options.color_seed = bench_seed;
+                     return rasterize(*model, *frame, *depth, options);
+                 }});
+        }
+    }
+
+    // 可见性缓冲: 与 scene/<asset>/1024 渲染结果相同, 着色推迟到光栅化之后, 每个可见像素一次
+    for (const Asset &asset : assets) {
+        constexpr int size = 1024;
+        auto frame = std::make_shared<Framebuffer<PixelFormat::RGB>>(size, size);
+        auto depth = std::make_shared<DepthBuffer>(size, size);
+        auto scratch = std::make_shared<RasterScratch>();
+        const Model *model = asset.model.get();
+        benchmarks.push_back({"scene/" + asset.name + "/1024/visibility",
+                              [frame, depth]() {
+                                  frame->clear();
+                                  depth->clear();
+                              },
+                              [model, frame, depth, scratch]() {
+                                  RasterOptions options;
+                                  options.color_seed = bench_seed;
+                                  options.visibility_buffer = true;
+                                  options.scratch = scratch.get();
+                                  return rasterize(*model, *frame, *depth, options);
+                              }});
+    }
+    // 多重采样: 与 scene/<asset>/1024 相同的场景, 每个像素 4 / 8 个采样点, 包括逐 tile 的解析
+    for (const Asset &asset : assets) {
+        constexpr int size = 1024;
+        for (int samples : {4, 8}) {
+            auto frame = std::make_shared<Framebuffer<PixelFormat::RGB>>(size, size);
+            auto depth = std::make_shared<DepthBuffer>(size, size);
+            auto msaa = std::make_shared<MsaaBuffer>(size, size, samples);
+            auto scratch = std::make_shared<RasterScratch>();
+            const Model *model = asset.model.get();
+            benchmarks.push_back({"scene/" + asset.name + "/1024/msaa" + std::to_string(samples),
+                                  [frame, depth, msaa]() {
+                                      frame->clear();
+                                      depth->clear();
+                                      msaa->clear();
+                                  },
+                                  [model, frame, depth, msaa, scratch]() {
+                                      RasterOptions options;
+                                      options.color_seed = bench_seed;
+                                      options.msaa = msaa.get();
+                                      options.scratch = scratch.get();
+                                      return rasterize(*model, *frame, *depth, options);
+                                  }});
+        }
+    }
+    // 多重采样的解析: 1024x1024 个像素, 采样点为固定种子的随机颜色与深度, 单线程
+    for (int samples : {4, 8}) {
+        constexpr int size = 1024;
+        auto msaa = std::make_shared<MsaaBuffer>(size, size, samples);
+        std::mt19937 rng(bench_seed);
+        std::uniform_real_distribution<float> dist(0.f, 1.f);
+        for (int y = 0; y < size; ++y) {
+            PackedPixel *colors = msaa->colors(0, y);
+            float *depth = msaa->depth(0, y);
+            for (int k = 0; k < size * samples; ++k) {
+                colors[k] = rng();
+                depth[k] = dist(rng);
+            }
+        }
+        auto frame = std::make_shared<Framebuffer<PixelFormat::RGB>>(size, size);
+        auto depth = std::make_shared<DepthBuffer>(size, size);
+        for (RasterPath path : {RasterPath::SCALAR, RasterPath::SSE, RasterPath::AVX2}) {
+            if (select_raster_path(path) != path) continue;
+            benchmarks.push_back({"msaa/resolve/" + std::to_string(samples) + "x/" +
+                                      raster_path_name(path),
+                                  nullptr, [msaa, frame, depth, path]() {
+                                      msaa->resolve(*frame, *depth, 0, 0, size - 1, size - 1,
+                                                    path);
+                                      return std::int64_t(size) * size;
+                                  }});
+        }
+    }
+    // 纹理: 1024x1024 图像生成分块存储与 mip 链, 各路径批量双线性采样,
+    // 以及用该纹理渲染整帧 (与 scene/<asset>/1024/visibility 对比)
+    {
+        constexpr int size = 1024;
+        auto image = std::make_shared<TgaImage>(size, size, TgaImage::RGB);
+        for (int y = 0; y < size; ++y) {
+            std::uint8_t *row = image->row(y);
+            for (int x = 0; x < size; ++x) {
+                row[x * 3] = x;
+                row[x * 3 + 1] = y;
+                row[x * 3 + 2] = ((x >> 5) ^ (y >> 5)) & 1 ? 255 : 0;
+            }
+        }
+        auto texture = std::make_shared<Texture>();
+        texture->build(*image);
+        benchmarks.push_back({"texture/build/1024", nullptr, [image]() {
+                                  Texture built;
+                                  built.build(*image);
+                                  return std::int64_t(size) * size;
+                              }});
+
+        // 512x512 个像素旋转 30 度、每像素约 1.5 个纹素地映射到纹理上, 按 64 个一段采样第 0 级
+        constexpr int samples = 512 * 512, batch = 64;
+        auto u = std::make_shared<std::vector<float>>(samples);
+        auto v = std::make_shared<std::vector<float>>(samples);
+        const float c = 1.5f * std::cos(0.5236f) / size, s = 1.5f * std::sin(0.5236f) / size;
+        for (int i = 0; i < samples; ++i) {
+            const float x = i % 512, y = i / 512;
+            (*u)[i] = c * x - s * y;
+            (*v)[i] = s * x + c * y;
+        }
+        auto texels = std::make_shared<std::vector<PackedPixel>>(samples);
+        for (RasterPath path : {RasterPath::SCALAR, RasterPath::SSE, RasterPath::AVX2}) {
+            if (select_raster_path(path) != path) continue;
+            benchmarks.push_back(
+                {std::string("texture/sample/") + raster_path_name(path), nullptr,
+                 [texture, u, v, texels, path]() {
+                     for (int i = 0; i < samples; i += batch)
+                         texture->sample(u->data() + i, v->data() + i, batch, 0,
+                                         texels->data() + i, path);
+                     return std::int64_t(samples);
+                 }});
+        }
+
+        for (const Asset &asset : assets) {
+            auto frame = std::make_shared<Framebuffer<PixelFormat::RGB>>(size, size);
+            auto depth = std::make_shared<DepthBuffer>(size, size);
+            auto scratch = std::make_shared<RasterScratch>();
+            const Model *model = asset.model.get();
+            benchmarks.push_back({"scene/" + asset.name + "/1024/textured",
+                                  [frame, depth]() {
+                                      frame->clear();
+                                      depth->clear();
+                                  },
+                                  [model, frame, depth, scratch, texture]() {
+                                      RasterOptions options;
+                                      options.color_seed = bench_seed;
+                                      options.texture = texture.get();
+                                      options.scratch = scratch.get();
+                                      return rasterize(*model, *frame, *depth, options);
+                                  }});
+        }
+    }
+
+    // 可编程管线: 透视相机下三种着色器渲染整帧
+    // shader/raster/<着色器> 只计光栅化与着色, 几何与分块预先做好, 与 .../handwritten 的手写循环对比
+    for (const Asset &asset : assets) {
+        constexpr int size = 1024;
+        const Model *model = asset.model.get();
+        auto uniforms = std::make_shared<ShaderUniforms>();
+        const Mat4f view = Mat4f::look_at(uniforms->eye, {0.f, 0.f, 0.f}, {0.f, 1.f, 0.f});
+        uniforms->mvp = Mat4f::perspective(0.7854f, 1.f, 0.1f, 10.f) * view;
+        auto frame = std::make_shared<Framebuffer<PixelFormat::RGB>>(size, size);
+        auto depth = std::make_shared<DepthBuffer>(size, size);
+        auto clear = [frame, depth]() {
+            frame->clear();
+            depth->clear();
+        };
+        auto scratch = std::make_shared<ShadedScratch>();
+        for (ShaderKind shader : {ShaderKind::FLAT, ShaderKind::GOURAUD, ShaderKind::PHONG}) {
+            benchmarks.push_back({"scene/" + asset.name + "/1024/shader/" + shader_name(shader),
+                                  clear, [model, shader, uniforms, frame, depth, scratch]() {
+                                      return render_shaded(*model, shader, *uniforms, *frame,
+                                                           *depth, scratch.get());
+                                  }});
+        }
+        if (&asset != &assets.front()) continue;
+
+        auto prepared = std::make_shared<ShadedScratch>();
+        FlatShader::shade_faces(*model, *uniforms, prepared->face_pixels);
+        pipeline_geometry(*model, FlatShader(*model, *uniforms, prepared->face_pixels), size,
+                          size, prepared->flat);
+        pipeline_geometry(*model, GouraudShader(*model, *uniforms), size, size,
+                          prepared->gouraud);
+        pipeline_geometry(*model, PhongShader(*model, *uniforms), size, size, prepared->phong);
+        bin_triangles(prepared->flat.setups.data(), prepared->flat.setups.size(), size, size,
+                      prepared->flat.arena, prepared->flat.bins);
+        bin_triangles(prepared->gouraud.setups.data(), prepared->gouraud.setups.size(), size, size,
+                      prepared->gouraud.arena, prepared->gouraud.bins);
+        bin_triangles(prepared->phong.setups.data(), prepared->phong.setups.size(), size, size,
+                      prepared->phong.arena, prepared->phong.bins);
+
+        benchmarks.push_back(
+            {"shader/raster/flat", clear, [model, uniforms, prepared, frame, depth]() {
+                 const PipelineScratch<0> &flat = prepared->flat;
+                 const FlatShader shader(*model, *uniforms, prepared->face_pixels);
+                 return raster_prepared(flat, size, size, [&](int i, int x0, int y0, int x1,
+                                                              int y1) {
+                     return triangle_rasterize_shaded(shader, flat.setups[i], flat.triangles[i],
+                                                      *frame, *depth, x0, y0, x1, y1);
+                 });
+             }});
+        benchmarks.push_back(
+            {"shader/raster/flat/handwritten", clear, [prepared, frame, depth]() {
+                 const PipelineScratch<0> &flat = prepared->flat;
+                 return raster_prepared(flat, size, size, [&](int i, int x0, int y0, int x1,
+                                                              int y1) {
+                     return handwritten_flat(prepared->face_pixels.data(), flat.setups[i],
+                                             flat.triangles[i], *frame, *depth, x0, y0, x1, y1);
+                 });
+             }});
+        benchmarks.push_back(
+            {"shader/raster/gouraud", clear,
+             [model, uniforms, prepared, frame, depth]() {
+                 const PipelineScratch<2> &gouraud = prepared->gouraud;
+                 const GouraudShader shader(*model, *uniforms);
+                 return raster_prepared(gouraud, size, size, [&](int i, int x0, int y0, int x1,
+                                                                 int y1) {
+                     return triangle_rasterize_shaded(shader, gouraud.setups[i],
+                                                      gouraud.triangles[i], *frame, *depth, x0,
+                                                      y0, x1, y1);
+                 });
+             }});
+        benchmarks.push_back(
+            {"shader/raster/gouraud/handwritten", clear,
+             [uniforms, prepared, frame, depth]() {
+                 const PipelineScratch<2> &gouraud = prepared->gouraud;
+                 return raster_prepared(gouraud, size, size, [&](int i, int x0, int y0, int x1,
+                                                                 int y1) {
+                     return handwritten_gouraud(*uniforms, gouraud.setups[i],
+                                                gouraud.triangles[i], *frame, *depth, x0, y0,
+                                                x1, y1);
+                 });
+             }});
+        benchmarks.push_back(
+            {"shader/raster/phong", clear, [model, uniforms, prepared, frame, depth]() {
+                 const PipelineScratch<6> &phong = prepared->phong;
+                 const PhongShader shader(*model, *uniforms);
+                 return raster_prepared(phong, size, size, [&](int i, int x0, int y0, int x1,
+                                                               int y1) {
+                     return triangle_rasterize_shaded(shader, phong.setups[i],
+                                                      phong.triangles[i], *frame, *depth, x0,
+                                                      y0, x1, y1);
+                 });
+             }});
+        benchmarks.push_back(
+            {"shader/raster/phong/handwritten", clear,
+             [uniforms, prepared, frame, depth]() {
+                 const PipelineScratch<6> &phong = prepared->phong;
+                 return raster_prepared(phong, size, size, [&](int i, int x0, int y0, int x1,
+                                                               int y1) {
+                     return handwritten_phong(*uniforms, phong.setups[i], phong.triangles[i],
+                                              *frame, *depth, x0, y0, x1, y1);
+                 });
+             }});
+    }
+
+    // 网格优化: 优化本身的耗时, 以及优化后整帧渲染的耗时 (与 scene/<asset>/1024 对比)
+    for (const Asset &asset : assets) {
+        auto model = std::make_shared<Model>(asset.path);
+        benchmarks.push_back({"optimize/" + asset.name,
+                              [model]() { model->set_optimizations(0); },
+                              [model]() {
+                                  MeshOptimizeOptions options;
+                                  options.overdraw = true;
+                                  optimize_mesh(*model, options);
+                                  return std::int64_t(model->num_faces());
+                              }});
+        for (bool overdraw : {false, true}) {
+            auto optimized = std::make_shared<Model>(asset.path);
+            MeshOptimizeOptions options;
+            options.overdraw = overdraw;
+            optimize_mesh(*optimized, options);
+            constexpr int size = 1024;
+            auto frame = std::make_shared<Framebuffer<PixelFormat::RGB>>(size, size);
+            auto depth = std::make_shared<DepthBuffer>(size, size);
+            benchmarks.push_back(
+                {"scene/" + asset.name + "/1024/" + (overdraw ? "overdraw" : "optimized"),
+                 [frame, depth]() {
+                     frame->clear();
+                     depth->clear();
+                 },
+                 [optimized, frame, depth]() {
+                     RasterOptions options;
+                     options.color_seed = bench_seed;
+                     return rasterize(*optimized, *frame, *depth, options);
+                 }});
+        }
+    }
+
+    // 簇剔除: 转台一周的若干帧, 逐面剔除与先整簇剔除对比, 吞吐为帧数
+    for (const Asset &asset : assets) {
+        const Model *model = asset.model.get();
+        auto meshlets = std::make_shared<Meshlets>();
+        benchmarks.push_back({"meshlets/" + asset.name + "/build", nullptr,
+                              [model, meshlets]() {
+                                  build_meshlets(*model, *meshlets);
+                                  return std::int64_t(model->num_faces());
+                              }});
+        constexpr int frames = 16, size = 1024;
+        auto transforms = std::make_shared<std::vector<Affine3f>>();
+        turntable(frames, 1.f, *transforms);
+        for (bool use_meshlets : {false, true}) {
+            auto frame = std::make_shared<Framebuffer<PixelFormat::RGB>>(size, size);
+            auto depth = std::make_shared<DepthBuffer>(size, size);
+            auto scratch = std::make_shared<RasterScratch>();
+            benchmarks.push_back(
+                {"turntable/" + asset.name + (use_meshlets ? "/meshlets" : "/faces"),
+                 [model, meshlets]() {
+                     if (meshlets->meshlets.empty()) build_meshlets(*model, *meshlets);
+                 },
+                 [model, meshlets, transforms, frame, depth, scratch, use_meshlets]() {
+                     for (const Affine3f &transform : *transforms) {
+                         frame->clear();
+                         depth->clear();
+                         RasterOptions options;
+                         options.color_seed = bench_seed;
+                         options.transform = &transform;
+                         options.scratch = scratch.get();
+                         if (use_meshlets) options.meshlets = meshlets.get();
+                         rasterize(*model, *frame, *depth, options);
+                     }
+                     return std::int64_t(frames);
+                 }});
+        }
+    }
+
+    // 线框: 共享的边只画一次, 吞吐为画出的像素数
+    for (const Asset &asset : assets) {
+        const Model *model = asset.model.get();
+        auto edges = std::make_shared<std::vector<Edge>>();
+        extract_edges(*model, *edges);
+        for (int size : {1024, 2048}) {
+            auto frame = std::make_shared<Framebuffer<PixelFormat::RGB>>(size, size);
+            auto scratch = std::make_shared<WireframeScratch>();
+            benchmarks.push_back({"wireframe/" + asset.name + "/" + std::to_string(size),
+                                  [frame]() { frame->clear(); },
+                                  [model, edges, frame, scratch]() {
+                                      return wireframe_rasterize(*model, *edges, *frame,
+                                                                 pack_pixel(255, 255, 255),
+                                                                 nullptr, scratch.get());
+                                  }});
+        }
+    }
+
+    // 流式渲染: 从文件到画完一帧的端到端时间, 吞吐为三角形数
+    // in_memory 先加载整个模型再 rasterize; obj 边解析 OBJ 边渲染; cmesh 读取预先转换的分块网格
+    // 自带模型较小, 按 1024 个三角形分块, 使读取与光栅化能够重叠
+    for (const Asset &asset : assets) {
+        constexpr int size = 1024;
+        const std::string path = asset.path;
+        const std::int64_t faces = asset.model->num_faces();
+        const std::string chunked =
+            (fs::temp_directory_path() / (asset.name + ".cmesh")).string();
+        std::error_code ec;
+        fs::remove(chunked, ec);
+        MeshStreamOptions stream_options;
+        stream_options.chunk_triangles = 1024;
+        auto frame = std::make_shared<Framebuffer<PixelFormat::RGB>>(size, size);
+        auto depth = std::make_shared<DepthBuffer>(size, size);
+        auto scratch = std::make_shared<RasterScratch>();
+        auto clear = [frame, depth]() {
+            frame->clear();
+            depth->clear();
+        };
+        benchmarks.push_back({"stream/" + asset.name + "/in_memory", clear,
+                              [path, faces, frame, depth, scratch]() {
+                                  CerrSilencer silencer;
+                                  Model model(path);
+                                  RasterOptions options;
+                                  options.color_seed = bench_seed;
+                                  options.scratch = scratch.get();
+                                  rasterize(model, *frame, *depth, options);
+                                  return faces;
+                              }});
+        for (bool baked : {false, true}) {
+            benchmarks.push_back(
+                {"stream/" + asset.name + (baked ? "/cmesh" : "/obj"),
+                 [clear, baked, path, chunked, stream_options]() {
+                     if (baked && !fs::exists(chunked))
+                         write_chunked_mesh(path, chunked, stream_options);
+                     clear();
+                 },
+                 [baked, path, chunked, stream_options, frame, depth, scratch]() {
+                     MeshStream stream(baked ? chunked : path, stream_options);
+                     RasterOptions options;
+                     options.color_seed = bench_seed;
+                     options.scratch = scratch.get();
+                     return render_stream(stream, *frame, *depth, options).triangles;
+                 }});
+        }
+    }
+
+    // 多帧渲染并写出 TGA, 同步写出与交给 FrameWriter 异步写出对比, 吞吐为帧数
+    constexpr int frames = 8, size = 1024;
+    const std::string pattern =
+        (fs::temp_directory_path() / "renderer_bench_frame_").string();
+    for (const Asset &asset : assets) {
+        const Model *model = asset.model.get();
+        auto frame = std::make_shared<Framebuffer<PixelFormat::RGB>>(size, size);
+        auto depth = std::make_shared<DepthBuffer>(size, size);
+        benchmarks.push_back(
+            {"output/" + asset.name + "/sync", nullptr, [model, frame, depth, pattern]() {
+                 for (int i = 0; i < frames; ++i) {
+                     frame->clear();
+                     depth->clear();
+                     RasterOptions options;
+                     options.color_seed = bench_seed + i;
+                     rasterize(*model, *frame, *depth, options);
+                     TgaImage::wrap(*frame).write_tga_file(pattern + std::to_string(i) + ".tga");
+                 }
+                 return std::int64_t(frames);
+             }});
+        auto writer = std::make_shared<FrameWriter<PixelFormat::RGB>>(size, size);
+        benchmarks.push_back(
+            {"output/" + asset.name + "/async", nullptr, [model, writer, depth, pattern]() {
+                 for (int i = 0; i < frames; ++i) {
+                     auto &frame = writer->acquire();
+                     frame.color.clear();
+                     depth->clear();
+                     RasterOptions options;
+                     options.color_seed = bench_seed + i;
+                     rasterize(*model, frame.color, *depth, options);
+                     frame.filename = pattern + std::to_string(i) + ".tga";
+                     writer->submit(frame);
+                 }
+                 writer->flush();
+                 return std::int64_t(frames);
+             }});
+    }
+}
+
+void write_json(std::ostream &out, const std::vector<Result> &results,
+                int repeat) {
+    // 每个基准单独一行, --compare 按行读取
+    out << "{\n";
+    out << "  \"seed\": " << bench_seed << ",\n";
+    out << "  \"threads\": " << omp_get_max_threads() << ",\n";
+    out << "  \"repeat\": " << repeat << ",\n";
+    out << "  \"raster_path\": \""
+        << raster_path_name(select_raster_path(RasterPath::AUTO)) << "\",\n";
+    out << "  \"benchmarks\": [\n";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"min_ms\": " << r.min_ms
+            << ", \"median_ms\": " << r.median_ms << ", \"items\": " << r.items
+            << ", \"items_per_sec\": "
+            << (r.median_ms > 0 ? r.items / r.median_ms * 1000 : 0) << "}"
+            << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+// 读取 write_json 写出的结果, 只取名字和中位数耗时
+bool read_baseline(const std::string &filename, std::vector<Result> &results) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open file " << filename << ".\n";
+        return false;
+    }
+    const std::string name_key = "\"name\": \"";
+    const std::string median_key = "\"median_ms\": ";
+    std::string line;
+    while (std::getline(in, line)) {
+        std::size_t name_pos = line.find(name_key);
+        std::size_t median_pos = line.find(median_key);
+        if (name_pos == std::string::npos || median_pos == std::string::npos)
+            continue;
+        name_pos += name_key.size();
+        Result result;
+        result.name = line.substr(name_pos, line.find('"', name_pos) - name_pos);
+        result.median_ms =
+            std::strtod(line.c_str() + median_pos + median_key.size(), nullptr);
+        results.push_back(result);
+    }
+    return true;
+}
+
+// 返回回归的项数
+int compare(const std::vector<Result> &baseline,
+            const std::vector<Result> &results, double threshold) {
+    int regressions = 0;
+    std::printf("\n%-40s %12s %12s %9s\n", "benchmark", "baseline ms",
+                "current ms", "change");
+    for (const Result &result : results) {
+        auto it = std::find_if(baseline.begin(), baseline.end(),
+                               [&](const Result &r) { return r.name == result.name; });
+        if (it == baseline.end()) {
+            std::printf("%-40s %12s %12.3f %9s\n", result.name.c_str(), "-",
+                        result.median_ms, "new");
+            continue;
+        }
+        const double change =
+            it->median_ms > 0 ? result.median_ms / it->median_ms - 1 : 0;
+        const bool regressed = change > threshold;
+        regressions += regressed;
+        std::printf("%-40s %12.3f %12.3f %+8.1f%%%s\n", result.name.c_str(),
+                    it->median_ms, result.median_ms, change * 100,
+                    regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+// 稳态堆分配检查: 每种模式复用同一组中间结果, 转台上先渲染 warmup 帧让各 Arena 与缓冲达到稳定容量,
+// 再渲染 frames 帧并统计期间的堆分配次数, 所有模式都为 0 时返回 true
+bool check_allocations(const std::vector<Asset> &assets) {
+    constexpr int warmup = 4, frames = 16, size = 1024;
+    std::vector<Affine3f> transforms;
+    turntable(warmup + frames, 1.f, transforms);
+    auto image = std::make_unique<TgaImage>(256, 256, TgaImage::RGB);
+    for (int y = 0; y < 256; ++y) {
+        for (int x = 0; x < 256 * 3; ++x) image->row(y)[x] = x ^ y;
+    }
+    Texture texture;
+    texture.build(*image);
+
+    bool ok = true;
+    std::printf("%-40s %14s\n", "mode", "allocs/frame");
+    for (const Asset &asset : assets) {
+        const Model &model = *asset.model;
+        Framebuffer<PixelFormat::RGB> frame(size, size);
+        DepthBuffer depth(size, size);
+        MsaaBuffer msaa(size, size, 4);
+        Meshlets meshlets;
+        build_meshlets(model, meshlets);
+        std::vector<Edge> edges;
+        extract_edges(model, edges);
+        FrameStats stats;
+
+        // render(transform) 渲染一帧
+        auto check = [&](const std::string &mode, auto render) {
+            std::int64_t allocations = 0;
+            for (int i = 0; i < warmup + frames; ++i) {
+                if (i == warmup) allocations = heap_allocations.load();
+                frame.clear();
+                depth.clear();
+                msaa.clear();
+                render(transforms[i]);
+            }
+            allocations = heap_allocations.load() - allocations;
+            std::printf("%-40s %14.2f\n", (asset.name + "/" + mode).c_str(),
+                        static_cast<double>(allocations) / frames);
+            ok = ok && !allocations;
+        };
+        RasterScratch scratch;
+        auto raster = [&](auto configure) {
+            return [&, configure](const Affine3f &transform) {
+                RasterOptions options;
+                options.color_seed = bench_seed;
+                options.transform = &transform;
+                options.scratch = &scratch;
+                configure(options);
+                rasterize(model, frame, depth, options);
+            };
+        };
+        check("forward", raster([](RasterOptions &) {}));
+        check("stats", raster([&](RasterOptions &options) {
+                  stats.begin_frame(size, size);
+                  options.stats = &stats;
+              }));
+        check("meshlets", raster([&](RasterOptions &options) { options.meshlets = &meshlets; }));
+        check("visibility", raster([](RasterOptions &options) {
+                  options.visibility_buffer = true;
+              }));
+        check("textured", raster([&](RasterOptions &options) { options.texture = &texture; }));
+        check("msaa4", raster([&](RasterOptions &options) { options.msaa = &msaa; }));
+        check("msaa4/visibility", raster([&](RasterOptions &options) {
+                  options.msaa = &msaa;
+                  options.visibility_buffer = true;
+              }));
+
+        WireframeScratch wireframe_scratch;
+        check("wireframe", [&](const Affine3f &transform) {
+            wireframe_rasterize(model, edges, frame, pack_pixel(255, 255, 255), &transform,
+                                &wireframe_scratch);
+        });
+
+        ShadedScratch shaded_scratch;
+        ShaderUniforms uniforms;
+        for (ShaderKind shader : {ShaderKind::FLAT, ShaderKind::GOURAUD, ShaderKind::PHONG}) {
+            check(std::string("shader/") + shader_name(shader), [&](const Affine3f &transform) {
+                uniforms.model = Mat4f::from_affine(transform);
+                uniforms.mvp = uniforms.model;
+                render_shaded(model, shader, uniforms, frame, depth, &shaded_scratch);
+            });
+        }
+    }
+    std::printf(ok ? "no steady-state heap allocations\n"
+                   : "FAILED: heap allocations in steady state\n");
+    return ok;
+}
+
+// 流式渲染的裂缝检查: 转台上的每一帧先在内存中渲染整个模型作为参照,
+// 再从 OBJ 与 .cmesh 以不同的块大小流式渲染, 统计针孔的个数:
+// 流式渲染中没有被覆盖、四邻域都被覆盖, 而参照中被覆盖的像素
+// 量化只会让三角形的边缘移动个别像素, 不会产生这样孤立的空洞; 全部为 0 时返回 true
+bool check_stream_cracks(const std::vector<Asset> &assets) {
+    constexpr int frames = 4, size = 1024;
+    std::vector<Affine3f> transforms;
+    turntable(frames, 1.f, transforms);
+    Framebuffer<PixelFormat::RGB> frame(size, size);
+    DepthBuffer reference(size, size), depth(size, size);
+    RasterScratch scratch;
+
+    auto pinholes = [&]() {
+        std::int64_t count = 0;
+        for (int y = 1; y + 1 < size; ++y) {
+            const float *above = depth.row(y - 1), *row = depth.row(y);
+            const float *below = depth.row(y + 1), *expected = reference.row(y);
+            for (int x = 1; x + 1 < size; ++x) {
+                count += !row[x] && expected[x] && row[x - 1] && row[x + 1] && above[x] &&
+                         below[x];
+            }
+        }
+        return count;
+    };
+
+    bool ok = true;
+    std::printf("%-40s %14s\n", "mode", "pinholes");
+    for (const Asset &asset : assets) {
+        const std::string chunked =
+            (fs::temp_directory_path() / (asset.name + "_check.cmesh")).string();
+        for (int chunk_triangles : {64, 1024}) {
+            MeshStreamOptions stream_options;
+            stream_options.chunk_triangles = chunk_triangles;
+            if (!write_chunked_mesh(asset.path, chunked, stream_options)) return false;
+            for (bool baked : {false, true}) {
+                std::int64_t count = 0;
+                for (const Affine3f &transform : transforms) {
+                    RasterOptions options;
+                    options.color_seed = bench_seed;
+                    options.transform = &transform;
+                    options.scratch = &scratch;
+                    frame.clear();
+                    reference.clear();
+                    rasterize(*asset.model, frame, reference, options);
+                    frame.clear();
+                    depth.clear();
+                    MeshStream stream(baked ? chunked : asset.path, stream_options);
+                    if (!render_stream(stream, frame, depth, options).ok) return false;
+                    count += pinholes();
+                }
+                std::printf("%-40s %14lld\n",
+                            (asset.name + (baked ? "/cmesh/" : "/obj/") +
+                             std::to_string(chunk_triangles))
+                                .c_str(),
+                            static_cast<long long>(count));
+                ok = ok && !count;
+            }
+        }
+        std::error_code ec;
+        fs::remove(chunked, ec);
+    }
+    std::printf(ok ? "no cracks between stream chunks\n"
+                   : "FAILED: cracks between stream chunks\n");
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    int repeat = 5;
+    double threshold = 0.10;
+    bool list = false, check_allocs = false, check_cracks = false;
+    std::string filter, out_path = "renderer_bench.json", baseline_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (arg == "--compare" && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::atof(argv[++i]);
+        } else if (arg == "--list") {
+            list = true;
+        } else if (arg == "--check-allocs") {
+            check_allocs = true;
+        } else if (arg == "--check-cracks") {
+            check_cracks = true;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--repeat N] [--filter substring] [--out file.json]"
+                         " [--compare baseline.json] [--threshold ratio] [--list]\n"
+                      << "       " << argv[0] << " --check-allocs\n"
+                      << "       " << argv[0] << " --check-cracks\n";
+            return 1;
+        }
+    }
+
+    std::vector<Result> baseline;
+    if (!baseline_path.empty() && !read_baseline(baseline_path, baseline))
+        return 1;
+
+    const std::vector<Asset> assets = load_assets();
+    if (check_allocs) return check_allocations(assets) ? 0 : 1;
+    if (check_cracks) return check_stream_cracks(assets) ? 0 : 1;
+    std::vector<Benchmark> benchmarks;
+    add_micro_benchmarks(benchmarks, assets);
+    add_scene_benchmarks(benchmarks, assets);
+
+    std::vector<Result> results;
+    if (!list)
+        std::printf("%-40s %12s %12s %14s\n", "benchmark", "min ms", "median ms",
+                    "items/s");
+    for (const Benchmark &benchmark : benchmarks) {
+        if (benchmark.name.find(filter) == std::string::npos) continue;
+        if (list) {
+            std::printf("%s\n", benchmark.name.c_str());
+            continue;
+        }
+        Result result = measure(benchmark, repeat);
+        std::printf("%-40s %12.3f %12.3f %14.4g\n", result.name.c_str(),
+                    result.min_ms, result.median_ms,
+                    result.median_ms > 0 ? result.items / result.median_ms * 1000
+                                         : 0);
+        std::fflush(stdout);
+        results.push_back(result);
+    }
+    if (list) return 0;
+
+    std::error_code ec;
+    fs::remove(fs::temp_directory_path() / "renderer_bench.tga", ec);
+    for (const Asset &asset : assets) {
+        fs::remove(fs::temp_directory_path() / (asset.name + ".smesh"), ec);
+        fs::remove(fs::temp_directory_path() / (asset.name + ".cmesh"), ec);
+    }
+
+    std::ofstream out(out_path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open file " << out_path << ".\n";
+        return 1;
+    }
+    write_json(out, results, repeat);
+    std::cerr << "Wrote " << out_path << '\n';
+
+    if (!baseline.empty() && compare(baseline, results, threshold)) return 1;
+    return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "geometry.h"
+#include <string>
+#include <vector>
+
+// 多帧渲染的逐帧模型变换, 渲染前一次生成全部帧的变换
+
+// 转台: 模型绕 y 轴匀速旋转一周, 第 i 帧转过 2 * pi * i / frames, 再整体缩放 scale
+void turntable(int frames, float scale, std::vector<Affine3f> &out);
+
+// 读取相机路径文件, 每行一帧: yaw pitch roll [scale]
+// 角度单位为度, 相机先绕 y 轴转 yaw, 再绕 x 轴转 pitch, 最后绕视线转 roll;
+// 正交投影下相机绕模型转动等价于模型反向转动, 返回的是模型的变换
+// 空行与 # 开头的行忽略, 格式错误时返回 false 并输出行号
+bool read_camera_path(const std::string &filename, std::vector<Affine3f> &out);
+
+// 输出文件名模板须包含且只包含一个整数格式 (例如 frame_%04d.tga), %% 表示 %
+bool is_frame_pattern(const std::string &pattern);
+// 按模板生成第 index 帧的文件名, out 的容量足够时不分配内存
+void format_frame_name(const std::string &pattern, int index, std::string &out);
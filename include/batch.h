@@ -0,0 +1,68 @@
+#pragma once
+
+#include "depth_buffer.h"
+#include "framebuffer.h"
+#include "rasterizer.h"
+#include "work_pool.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 批量渲染的一个任务
+struct BatchJob {
+    std::string model;
+    int width = 0, height = 0;
+    std::string output;
+};
+
+// 读取任务清单, 每行一个任务: Path/to/model.obj|.smesh WxH output.tga
+// 空行与 # 开头的行忽略, 格式错误时返回 false 并输出行号
+bool read_batch_manifest(const std::string &filename, std::vector<BatchJob> &jobs);
+
+// 渲染一个任务需要的全部缓冲
+struct RenderBuffers {
+    Framebuffer<PixelFormat::RGB> frame;
+    DepthBuffer depth;
+    RasterScratch scratch;
+    std::vector<std::uint8_t> encode_buffer;
+};
+
+// 按分辨率分组的缓冲池, 同分辨率的任务复用缓冲, 线程安全
+class BufferPool {
+  private:
+    std::mutex mutex_;
+    std::map<std::pair<int, int>, std::vector<std::unique_ptr<RenderBuffers>>> free_;
+
+  public:
+    // 取一组 width x height 的缓冲, 池中没有时新建; 缓冲的内容是之前任务的, 由调用方清除
+    std::unique_ptr<RenderBuffers> acquire(int width, int height);
+    void release(std::unique_ptr<RenderBuffers> buffers);
+};
+
+struct BatchResult {
+    int succeeded = 0, failed = 0;
+    double ms = 0;
+};
+
+// 批量渲染
+// 工作线程池与缓冲池在多次 render 之间保持
+// 每个工作线程内 OpenMP 只用 1 个线程, 并行来自同时处理多个任务;
+// 任务按模型文件从大到小排列后分给各线程, 空闲的线程窃取其他线程的任务
+class BatchRenderer {
+  private:
+    WorkPool pool_;
+    BufferPool buffers_;
+
+  public:
+    // threads 不大于 0 时使用硬件线程数
+    explicit BatchRenderer(int threads = 0);
+
+    int get_threads() const { return pool_.size(); }
+
+    // 渲染全部任务, options 的 stats / transform / scratch / meshlets / texture / msaa 被忽略
+    BatchResult render(const std::vector<BatchJob> &jobs, const RasterOptions &options);
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "tga_image.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 32 位浮点深度缓冲
+// 深度范围为 [0, 1], 值越大离相机越近, 深度测试为 z > 缓冲中的值
+// 初始化为 0, 与之前 8 位深度缓冲清零后的行为一致
+//
+// 另外维护两层粗粒度的层次深度 (Hi-Z):
+// 第 1 层每个 block_size x block_size 的块记录块内最小深度 (最远的像素)
+// 第 2 层每个 coarse_size x coarse_size 的区域记录区域内最小深度
+// 三角形在某区域内的最大深度不大于该区域的最小深度时, 三角形在该区域被完全遮挡
+// 粗粒度层在像素被写入后延迟更新: 写入方调用 mark_dirty, 查询时重新计算
+// 旧值只会偏小 (深度只增不减), 所以即使未更新, 剔除也是保守正确的
+class DepthBuffer {
+  public:
+    static constexpr int block_size = 8;
+    static constexpr int coarse_size = block_size * block_size;
+
+  private:
+    int width_ = 0, height_ = 0;
+    int blocks_x_ = 0, blocks_y_ = 0;
+    int coarse_x_ = 0, coarse_y_ = 0;
+    std::vector<float> data_ = {};
+    std::vector<float> block_min_ = {};
+    std::vector<float> coarse_min_ = {};
+    std::vector<std::uint8_t> block_dirty_ = {};
+    std::vector<std::uint8_t> coarse_dirty_ = {};
+
+    void refresh_block(int block_index);
+    void refresh_coarse(int coarse_index);
+
+  public:
+    DepthBuffer() = default;
+    DepthBuffer(const int width, const int height);
+
+    int get_width() const { return width_; }
+    int get_height() const { return height_; }
+
+    void clear(float depth = 0.f);
+
+    // 第 y 行的起始地址, 不做边界检查
+    float *row(int y) { return data_.data() + y * width_; }
+    const float *row(int y) const { return data_.data() + y * width_; }
+
+    // 标记像素所在的块需要重新计算最小深度
+    void mark_dirty(int x, int y);
+    // 第 (block_x, block_y) 个块内的最小深度
+    float block_min(int block_x, int block_y);
+    // 判断矩形 [x_min, x_max]x[y_min, y_max] 内深度不超过 z_max
+    // 的片元是否一定无法通过深度测试
+    // 先查第 2 层, 不能剔除时再逐块查第 1 层
+    bool is_occluded(int x_min, int y_min, int x_max, int y_max, float z_max);
+
+    // 导出为灰度图, [0, 1] 映射到 [0, 255], 仅用于调试
+    // to_grayscale 写到调用方的 width * height 字节, 不分配内存
+    void to_grayscale(std::uint8_t *pixels) const;
+    TgaImage to_tga_image() const;
+    bool write_tga_file(const std::string &filename) const;
+};
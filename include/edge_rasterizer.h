@@ -0,0 +1,100 @@
+#pragma once
+
+#include "depth_buffer.h"
+#include "framebuffer.h"
+#include "geometry.h"
+#include "stats.h"
+#include "tga_image.h"
+#include <cstdint>
+#include <string>
+
+// 边函数光栅化的内循环实现
+// BARYCENTRIC 为逐像素求边函数、用 barycentric_coordinates 插值深度的参考实现
+// 其余路径每个三角形只建立一次边函数, 按行增量步进
+// SCALAR / SSE / AVX2 每次分别处理 1 / 4 / 8 个像素, 三者结果逐像素一致
+// 所有路径的覆盖判断都由 FixedPointTriangle 的整数边函数决定, 覆盖的像素完全相同
+enum class RasterPath { AUTO, BARYCENTRIC, SCALAR, SSE, AVX2 };
+
+// 顶点坐标的亚像素精度: 28.4 定点数, 每个像素 16 个亚像素
+constexpr int subpixel_bits = 4;
+constexpr int subpixel_scale = 1 << subpixel_bits;
+
+// 定点数表示的屏幕空间三角形与其整数边函数
+// 1. 顶点坐标四舍五入到 1/16 像素, 远在屏幕外的坐标截断到 [-2^17, 2^17] 像素
+// 2. 边函数 E_i(x, y) = a_i * x + b_i * y + c_i 在像素 (x, y) 的中心求值, 全部为整数运算
+//    E_0 对应顶点 A 的对边, 与 alpha 成正比, E_1 对应 beta, E_2 对应 gamma
+// 3. top-left 规则: 像素中心恰好落在边上时, 只有该边是上边或左边才算覆盖
+//    该规则已折算进 c_i, 像素被覆盖当且仅当三个边函数均非负
+// 共享一条边的两个三角形对边上的像素恰好一个覆盖, 不会重复着色, 相邻三角形之间也没有缝隙
+struct FixedPointTriangle {
+    std::int64_t a[3], b[3], c[3];
+    // 三个 (未加偏置的) 边函数之和, 为三角形面积的两倍, 单位为亚像素的平方
+    std::int64_t area;
+    // 像素中心可能被覆盖的像素范围, 未与屏幕求交
+    int x_min, y_min, x_max, y_max;
+
+    // 顶点需为逆时针绕序, 定点化后面积不为正 (退化或反向) 时返回 false
+    bool setup(const Vec3f &p0, const Vec3f &p1, const Vec3f &p2);
+
+    std::int64_t edge(int i, int x, int y) const {
+        return a[i] * x + b[i] * y + c[i];
+    }
+    bool covers(int x, int y) const {
+        return (edge(0, x, y) | edge(1, x, y) | edge(2, x, y)) >= 0;
+    }
+};
+
+// 深度的平面方程: z = (E_0 * az + E_1 * bz + E_2 * cz) / area, 用双精度由整数边函数求出
+// 各行行首的深度直接求值, 不随行累积误差
+// 传入 a / b 时得到深度对 x / y 的导数 (每像素)
+struct DepthPlane {
+    double z[3];
+    double scale;
+
+    DepthPlane(const FixedPointTriangle &triangle, const Vec3f &p0, const Vec3f &p1,
+               const Vec3f &p2)
+        : z{p0.z, p1.z, p2.z}, scale(1.0 / static_cast<double>(triangle.area)) {}
+
+    double at(const std::int64_t e[3]) const {
+        return (static_cast<double>(e[0]) * z[0] + static_cast<double>(e[1]) * z[1] +
+                static_cast<double>(e[2]) * z[2]) *
+               scale;
+    }
+};
+
+// 三角形在每个裁剪矩形 (tile) 内按屏幕大小分类 (TriangleClass, 定义在 stats.h),
+// 各类的遍历方式不同, 覆盖的像素与深度完全相同
+// EMPTY: 不覆盖任何像素中心: 包围盒内没有像素中心, 或 TINY 三角形逐像素判断后一个也不覆盖,
+//        在求深度平面之前剔除
+// TINY: 包围盒不超过 tiny_triangle_size x tiny_triangle_size 个像素, 先求出覆盖掩码,
+//       再逐个像素做深度测试, 不查询 Hi-Z, 不建立 span 的参数, 也不按块遍历
+// MEDIUM: 其余的三角形, 逐个 Hi-Z 块调用 span 内循环
+// LARGE: 面积不小于 large_triangle_pixels 个像素, 逐块先用块四角的边函数判断,
+//        整块在某条边外侧的块跳过, 整块被覆盖的块使用不做覆盖判断的内循环
+constexpr int tiny_triangle_size = 8;
+constexpr int large_triangle_pixels = 512;
+
+// AUTO 根据 CPU 特性选择最快的路径, 不支持的路径回退到能用的最快路径
+RasterPath select_raster_path(RasterPath requested);
+const char *raster_path_name(RasterPath path);
+// 解析 "barycentric" / "scalar" / "sse" / "avx2" / "auto", 失败返回 false
+bool parse_raster_path(const std::string &name, RasterPath &path);
+
+// 边函数法光栅化单个三角形, 只处理 [clip_x_min, clip_x_max]x[clip_y_min,
+// clip_y_max] 内的像素, 裁剪矩形必须位于帧缓冲内
+// pixel 为写入帧缓冲的像素值, 一般为 pack_color 打包的颜色, 写可见性缓冲时为面的编号
+// path 必须是 select_raster_path 返回的 SCALAR / SSE / AVX2 之一
+// hierarchical_z 为 true 时先用深度缓冲的粗粒度层剔除整个三角形或其中的块
+// stats 不为空时累加通过深度测试的像素个数、每个像素的覆盖次数与大小分类的计数
+// 返回做了深度测试的像素个数
+// 支持 PixelFormat 的全部三种格式, 在 edge_rasterizer.cpp 中显式实例化
+template <PixelFormat Format>
+std::int64_t triangle_rasterize_edge(const Vec3f &p0, const Vec3f &p1,
+                                     const Vec3f &p2,
+                                     Framebuffer<Format> &frame_buffer,
+                                     DepthBuffer &depth_buffer,
+                                     PackedPixel pixel, int clip_x_min,
+                                     int clip_y_min, int clip_x_max,
+                                     int clip_y_max, RasterPath path,
+                                     bool hierarchical_z,
+                                     ThreadStats *stats = nullptr);
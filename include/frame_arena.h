@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+// 帧内临时数据的线性分配器
+// 流水线每帧产生的中间结果 (变换后的顶点、三角形、分块列表等) 只在一帧内有效,
+// 从 Arena 顺序分配, 帧结束时 reset 一次性释放, 不逐个析构
+// 当前块不够时另分配一个更大的块; reset 时如果这一帧用了多个块, 合并为一个比这一帧用量大一半的块,
+// 所以用量稳定后每帧不再分配内存
+// 只能存放可平凡复制、可平凡析构的类型, reset 之后之前分配的指针全部失效
+// CMake 选项 RENDERER_ARENA_DEBUG 打开时 (定义 RENDERER_ARENA_DEBUG), reset 把用过的内存填为 0xcd,
+// 便于发现 reset 之后仍在使用的指针
+class Arena {
+  private:
+    // 块的起始地址对齐到 block_align, 容量至少为 min_block
+    static constexpr std::size_t block_align = 64;
+    static constexpr std::size_t min_block = 64 << 10;
+
+    std::byte *block_ = nullptr;
+    std::size_t capacity_ = 0, offset_ = 0;
+    std::vector<std::byte *> retired_ = {}; // 本帧写满的块, reset 时释放
+    std::size_t retired_bytes_ = 0;         // 写满的块中用掉的字节数
+    std::size_t peak_ = 0;                  // 历次 reset 时的最大用量
+    std::size_t blocks_allocated_ = 0;      // 分配块的次数
+
+    static std::byte *allocate_block(std::size_t capacity);
+    static void free_block(std::byte *block);
+    void *grow(std::size_t bytes, std::size_t align);
+
+  public:
+    Arena() = default;
+    // 预先分配容量为 capacity 的块
+    explicit Arena(std::size_t capacity);
+    ~Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+    Arena(Arena &&other) noexcept;
+    Arena &operator=(Arena &&) = delete;
+
+    // 分配 bytes 个字节, 起始地址对齐到 align (2 的幂, 不超过 block_align)
+    void *allocate(std::size_t bytes, std::size_t align) {
+        const std::size_t begin = (offset_ + align - 1) & ~(align - 1);
+        if (begin + bytes > capacity_) return grow(bytes, align);
+        offset_ = begin + bytes;
+        return block_ + begin;
+    }
+    // count 个未初始化的 T
+    template <typename T> T *allocate_array(std::size_t count) {
+        static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>,
+                      "arena memory is released without running destructors");
+        static_assert(alignof(T) <= block_align, "over-aligned arena type");
+        return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+    }
+    // 释放本帧分配的全部内存; 只用了一个块时只把偏移归零
+    void reset();
+
+    // 本帧已分配的字节数 (含对齐的空隙)
+    std::size_t used() const { return retired_bytes_ + offset_; }
+    // 当前块的容量
+    std::size_t capacity() const { return capacity_; }
+    // 各帧的最大用量
+    std::size_t peak() const { return std::max(peak_, used()); }
+    // 分配块的总次数, 用量稳定后不再增加
+    std::size_t blocks_allocated() const { return blocks_allocated_; }
+};
+
+// Arena 上的定长数组, 不持有内存, 随 Arena 的 reset 失效
+// 多帧渲染时每帧重新 allocate, 内容不保留
+template <typename T> class ArenaArray {
+  private:
+    T *data_ = nullptr;
+    int size_ = 0;
+
+  public:
+    // 从 arena 分配 size 个未初始化的元素
+    void allocate(Arena &arena, int size) {
+        data_ = arena.allocate_array<T>(size);
+        size_ = size;
+    }
+    // 从 arena 分配 size 个元素, 全部赋为 value
+    void assign(Arena &arena, int size, const T &value) {
+        allocate(arena, size);
+        std::fill(data_, data_ + size, value);
+    }
+
+    int size() const { return size_; }
+    bool empty() const { return !size_; }
+    T *data() { return data_; }
+    const T *data() const { return data_; }
+    T &operator[](int index) { return data_[index]; }
+    const T &operator[](int index) const { return data_[index]; }
+    T *begin() { return data_; }
+    T *end() { return data_ + size_; }
+    const T *begin() const { return data_; }
+    const T *end() const { return data_ + size_; }
+};
+
+// 一帧的全部 Arena: 所有线程共用、只在串行代码中分配的 shared, 以及每个 OpenMP 线程一个的 Arena
+// 线程的 Arena 只由该线程分配, 无需加锁, 各自对齐到缓存行
+class FrameArena {
+  private:
+    struct alignas(64) ThreadArena {
+        Arena arena;
+    };
+    Arena shared_;
+    std::vector<ThreadArena> threads_ = {};
+
+  public:
+    // 复位全部 Arena, 按当前 OpenMP 线程数准备线程的 Arena
+    // 线程数不变时不分配内存, 耗时与线程数成正比, 与上一帧分配的内容无关
+    void reset();
+
+    Arena &shared() { return shared_; }
+    // 第 thread 个 OpenMP 线程的 Arena, 必须在 reset 之后调用
+    Arena &thread(int thread) { return threads_[thread].arena; }
+
+    // 全部 Arena 的峰值用量之和
+    std::size_t peak() const;
+    // 全部 Arena 分配块的总次数
+    std::size_t blocks_allocated() const;
+    // 输出峰值用量与分配块的次数, name 为该 FrameArena 的用途
+    void write_report(std::ostream &out, const char *name) const;
+};
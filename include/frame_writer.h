@@ -0,0 +1,81 @@
+#pragma once
+
+#include "framebuffer.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 深度图的导出策略
+enum class DepthDump {
+    NONE,    // 不导出
+    ALWAYS,  // 每帧导出
+    IF_IDLE, // 写线程没有积压时才导出, 积压时丢弃深度图, 不拖慢渲染
+};
+
+struct FrameWriterOptions {
+    int slots = 2; // 帧槽个数, 即同时存在的帧缓冲个数, 至少为 1
+    DepthDump depth = DepthDump::NONE;
+};
+
+// 异步输出帧
+// 写线程在后台做 TGA 编码与写盘, 渲染线程渲染第 N + 1 帧时第 N 帧在写出,
+// 多帧渲染的总时间接近 max(光栅化, 编码) 而不是两者之和
+//
+// 帧槽在构造时一次分配, 之后循环使用, 每帧不再分配帧缓冲:
+// acquire 取一个空闲槽, 渲染到槽的帧缓冲后 submit 给写线程,
+// 写完后槽回到空闲队列; 所有槽都在排队或写出时 acquire 阻塞 (背压)
+// 只允许一个线程 acquire / submit
+template <PixelFormat Format> class FrameWriter {
+  public:
+    struct Frame {
+        Framebuffer<Format> color;
+        // 8 位深度图, 只在导出深度图时分配
+        Framebuffer<PixelFormat::GRAYSCALE> depth;
+        std::string filename;
+        std::string depth_filename; // 为空时不写深度图
+    };
+
+  private:
+    FrameWriterOptions options_;
+    std::vector<std::unique_ptr<Frame>> slots_;
+    std::deque<Frame *> free_;    // 空闲的槽
+    std::deque<Frame *> pending_; // 等待写出的槽
+    int writing_ = 0;             // 正在写出的槽数
+    bool stopping_ = false;
+    std::int64_t written_ = 0, failed_ = 0, dropped_depth_ = 0;
+    std::vector<std::uint8_t> encode_buffer_; // 只由写线程使用
+
+    mutable std::mutex mutex_;
+    std::condition_variable frame_freed_;
+    std::condition_variable frame_pending_;
+    std::thread thread_;
+
+    void run();
+
+  public:
+    FrameWriter(int width, int height, const FrameWriterOptions &options = {});
+    // 写出所有已提交的帧后退出写线程
+    ~FrameWriter();
+    FrameWriter(const FrameWriter &) = delete;
+    FrameWriter &operator=(const FrameWriter &) = delete;
+
+    // 取一个空闲的帧槽, 所有槽都被占用时阻塞
+    // 槽中的像素是之前某一帧的内容, 由调用方清除; 文件名已清空
+    Frame &acquire();
+    // 下一帧是否要导出深度图, 不导出时调用方不必准备 depth
+    bool wants_depth() const;
+    // 提交渲染完成的帧, filename 为空的帧不写出, 直接回收
+    void submit(Frame &frame);
+    // 等待所有已提交的帧写出
+    void flush();
+
+    std::int64_t get_written() const;
+    std::int64_t get_failed() const;
+    // 因写线程积压而丢弃的深度图个数
+    std::int64_t get_dropped_depth() const;
+};
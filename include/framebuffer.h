@@ -0,0 +1,102 @@
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "PackedPixel assumes a little-endian byte order"
+#endif
+
+// 像素格式, 值为每像素字节数, 分别对应 TGA 的 8 位灰度 / 24 位 / 32 位图像
+enum class PixelFormat { GRAYSCALE = 1, RGB = 3, RGBA = 4 };
+
+// 打包成 32 位整数的像素, 内存中的字节顺序与 TGA 相同, 依次为 b, g, r, a
+// 灰度图只使用最低字节
+using PackedPixel = std::uint32_t;
+
+constexpr PackedPixel pack_pixel(std::uint8_t b, std::uint8_t g, std::uint8_t r,
+                                 std::uint8_t a = 255) {
+    return b | g << 8 | r << 16 | static_cast<PackedPixel>(a) << 24;
+}
+
+// 帧的像素个数上限: 深度缓冲、可见性缓冲与统计按 int 的 y * width + x 寻址,
+// RGBA 帧的字节偏移也要在 int 范围内
+constexpr std::int64_t max_frame_pixels = INT_MAX / 4;
+
+// 宽高是否可用: TGA 的宽高为 16 位, 像素个数不超过 max_frame_pixels
+constexpr bool valid_frame_size(int width, int height) {
+    return width > 0 && height > 0 && width <= 65535 && height <= 65535 &&
+           static_cast<std::int64_t>(width) * height <= max_frame_pixels;
+}
+
+// 帧缓冲
+// 每像素字节数为编译期常量, 像素按行优先连续存放, 行与行之间没有填充
+// 像素访问不做边界检查, 调用方保证坐标位于 [0, width)x[0, height) 内
+// (光栅化时包围盒已经裁剪到帧缓冲内), 单个像素的读写编译为定长的存取
+// 写出文件时用 TgaImage::wrap 包装, 不拷贝像素
+template <PixelFormat Format> class Framebuffer {
+  public:
+    static constexpr PixelFormat format = Format;
+    static constexpr int bytespp = static_cast<int>(Format);
+
+  private:
+    int width_ = 0, height_ = 0;
+    std::vector<std::uint8_t> data_ = {};
+
+  public:
+    Framebuffer() = default;
+    Framebuffer(const int width, const int height)
+        : width_(width), height_(height),
+          data_(static_cast<std::size_t>(width) * height * bytespp, 0) {}
+
+    int get_width() const { return width_; }
+    int get_height() const { return height_; }
+
+    std::uint8_t *data() { return data_.data(); }
+    const std::uint8_t *data() const { return data_.data(); }
+    // 第 y 行的起始地址
+    std::uint8_t *row(int y) {
+        return data_.data() + static_cast<std::size_t>(y) * width_ * bytespp;
+    }
+    const std::uint8_t *row(int y) const {
+        return data_.data() + static_cast<std::size_t>(y) * width_ * bytespp;
+    }
+    std::uint8_t *pixel(int x, int y) { return row(y) + x * bytespp; }
+    const std::uint8_t *pixel(int x, int y) const {
+        return row(y) + x * bytespp;
+    }
+
+    // 把像素写到 dst 指向的 bytespp 个字节
+    static void store(std::uint8_t *dst, PackedPixel pixel) {
+        std::memcpy(dst, &pixel, bytespp);
+    }
+    static PackedPixel load(const std::uint8_t *src) {
+        PackedPixel pixel = 0;
+        std::memcpy(&pixel, src, bytespp);
+        return pixel;
+    }
+
+    void set(int x, int y, PackedPixel pixel) { store(this->pixel(x, y), pixel); }
+    PackedPixel get(int x, int y) const { return load(pixel(x, y)); }
+
+    // 填充第 y 行的 [x_begin, x_end)
+    void fill_span(int y, int x_begin, int x_end, PackedPixel pixel) {
+        std::uint8_t *dst = this->pixel(x_begin, y);
+        const int count = x_end - x_begin;
+        if constexpr (Format == PixelFormat::GRAYSCALE) {
+            std::memset(dst, pixel & 0xff, count);
+        } else {
+            for (int i = 0; i < count; ++i, dst += bytespp) store(dst, pixel);
+        }
+    }
+    void clear(PackedPixel pixel = 0) {
+        if (!pixel) {
+            std::memset(data_.data(), 0, data_.size());
+            return;
+        }
+        for (int y = 0; y < height_; ++y) fill_span(y, 0, width_, pixel);
+    }
+};
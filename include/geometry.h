@@ -61,11 +61,187 @@ template <typename T> struct Vec<3, T> {
     }
     // 模长平方
     T length_squared() const { return x * x + y * y + z * z; }
+    // 单位向量, 零向量返回自身
+    Vec<3, T> normalized() const {
+        const T length = std::sqrt(length_squared());
+        if (!(length > 0)) return *this;
+        return {x / length, y / length, z / length};
+    }
 };
 
 using Vec3f = Vec<3, float>;
 using Vec3i = Vec<3, int>;
 using Vec2f = Vec<2, float>;
+using Vec4f = Vec<4, float>;
+
+// 仿射变换 p' = m * p + t, m 为行优先的 3x3 矩阵
+// 用于把模型放到 NDC 中, 多帧渲染时每帧一个
+struct Affine3f {
+    float m[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    Vec3f t = {0, 0, 0};
+
+    Vec3f apply(const Vec3f &p) const {
+        return {m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + t.x,
+                m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + t.y,
+                m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + t.z};
+    }
+
+    // 先做 rhs 再做 *this
+    Affine3f operator*(const Affine3f &rhs) const {
+        Affine3f result;
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                result.m[i][j] = m[i][0] * rhs.m[0][j] + m[i][1] * rhs.m[1][j] +
+                                 m[i][2] * rhs.m[2][j];
+            }
+        }
+        result.t = apply(rhs.t);
+        return result;
+    }
+
+    // 绕 x / y / z 轴旋转, 弧度, 右手坐标系逆时针为正
+    static Affine3f rotation_x(float radians) {
+        const float c = std::cos(radians), s = std::sin(radians);
+        Affine3f a;
+        a.m[1][1] = c, a.m[1][2] = -s;
+        a.m[2][1] = s, a.m[2][2] = c;
+        return a;
+    }
+    static Affine3f rotation_y(float radians) {
+        const float c = std::cos(radians), s = std::sin(radians);
+        Affine3f a;
+        a.m[0][0] = c, a.m[0][2] = s;
+        a.m[2][0] = -s, a.m[2][2] = c;
+        return a;
+    }
+    static Affine3f rotation_z(float radians) {
+        const float c = std::cos(radians), s = std::sin(radians);
+        Affine3f a;
+        a.m[0][0] = c, a.m[0][1] = -s;
+        a.m[1][0] = s, a.m[1][1] = c;
+        return a;
+    }
+    static Affine3f scale(float factor) {
+        Affine3f a;
+        a.m[0][0] = a.m[1][1] = a.m[2][2] = factor;
+        return a;
+    }
+};
+
+// 4x4 矩阵 p' = m * p, m 为行优先, p 为齐次坐标的列向量
+// 用于可编程着色管线的模型 / 视图 / 投影变换
+// 投影变换与 viewport_trans 的约定一致: NDC 为 [-1, 1]^3, z 越大离相机越近,
+// 即近平面映射到 z = 1, 远平面映射到 z = -1 (与 OpenGL 的 z 方向相反)
+// 模型、视图、投影都为单位矩阵时与原有的正交渲染完全相同
+struct Mat4f {
+    float m[4][4] = {{1, 0, 0, 0}, {0, 1, 0, 0}, {0, 0, 1, 0}, {0, 0, 0, 1}};
+
+    Vec4f apply(const Vec4f &p) const {
+        Vec4f result;
+        for (int i = 0; i < 4; ++i)
+            result[i] = m[i][0] * p[0] + m[i][1] * p[1] + m[i][2] * p[2] + m[i][3] * p[3];
+        return result;
+    }
+    // 点 (w = 1)
+    Vec4f apply_point(const Vec3f &p) const { return apply(Vec4f{p.x, p.y, p.z, 1.f}); }
+    // 方向 (w = 0), 只用左上角的 3x3
+    Vec3f apply_direction(const Vec3f &d) const {
+        return {m[0][0] * d.x + m[0][1] * d.y + m[0][2] * d.z,
+                m[1][0] * d.x + m[1][1] * d.y + m[1][2] * d.z,
+                m[2][0] * d.x + m[2][1] * d.y + m[2][2] * d.z};
+    }
+
+    // 先做 rhs 再做 *this
+    Mat4f operator*(const Mat4f &rhs) const {
+        Mat4f result;
+        for (int i = 0; i < 4; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                result.m[i][j] = m[i][0] * rhs.m[0][j] + m[i][1] * rhs.m[1][j] +
+                                 m[i][2] * rhs.m[2][j] + m[i][3] * rhs.m[3][j];
+            }
+        }
+        return result;
+    }
+
+    static Mat4f from_affine(const Affine3f &a) {
+        Mat4f result;
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) result.m[i][j] = a.m[i][j];
+            result.m[i][3] = a.t[i];
+        }
+        return result;
+    }
+    static Mat4f translation(const Vec3f &t) {
+        Mat4f result;
+        for (int i = 0; i < 3; ++i) result.m[i][3] = t[i];
+        return result;
+    }
+    // 视图变换: 相机位于 eye 看向 center, 变换后相机看向 -z 方向, y 轴朝上
+    static Mat4f look_at(const Vec3f &eye, const Vec3f &center, const Vec3f &up) {
+        const Vec3f z = (eye - center).normalized();
+        const Vec3f x = up.cross(z).normalized();
+        const Vec3f y = z.cross(x);
+        Mat4f result;
+        const Vec3f *axes[3] = {&x, &y, &z};
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) result.m[i][j] = (*axes[i])[j];
+            result.m[i][3] = -(*axes[i] * eye);
+        }
+        return result;
+    }
+    // 透视投影, fovy 为竖直方向的视角 (弧度), aspect 为宽高比, 0 < near < far
+    // 视图空间的 z = -near 映射到 NDC z = 1, z = -far 映射到 -1, w = -z
+    static Mat4f perspective(float fovy, float aspect, float near, float far) {
+        const float f = 1.f / std::tan(fovy / 2);
+        Mat4f result;
+        result.m[0][0] = f / aspect;
+        result.m[1][1] = f;
+        result.m[2][2] = (far + near) / (far - near);
+        result.m[2][3] = 2 * far * near / (far - near);
+        result.m[3][2] = -1;
+        result.m[3][3] = 0;
+        return result;
+    }
+    // 正交投影, 把 [left, right]x[bottom, top]x[-far, -near] 映射到 NDC, z 方向同上
+    static Mat4f orthographic(float left, float right, float bottom, float top, float near,
+                              float far) {
+        Mat4f result;
+        result.m[0][0] = 2 / (right - left);
+        result.m[0][3] = -(right + left) / (right - left);
+        result.m[1][1] = 2 / (top - bottom);
+        result.m[1][3] = -(top + bottom) / (top - bottom);
+        result.m[2][2] = 2 / (far - near);
+        result.m[2][3] = (far + near) / (far - near);
+        return result;
+    }
+};
+
+// 矩阵栈, 栈顶为当前的变换, 初始为单位矩阵
+// 典型用法: load(projection), multiply(view), 然后对每个物体 push, multiply(model), 取 top, pop
+class MatrixStack {
+  private:
+    Mat4f stack_[16];
+    int top_ = 0;
+
+  public:
+    const Mat4f &top() const { return stack_[top_]; }
+    void load(const Mat4f &m) { stack_[top_] = m; }
+    // 栈顶右乘 m, 之后的顶点先做 m 再做原来的变换
+    void multiply(const Mat4f &m) { stack_[top_] = stack_[top_] * m; }
+    // 复制栈顶, 深度超过 16 时返回 false
+    bool push() {
+        if (top_ + 1 >= 16) return false;
+        stack_[top_ + 1] = stack_[top_];
+        ++top_;
+        return true;
+    }
+    // 栈中只剩一个矩阵时返回 false
+    bool pop() {
+        if (!top_) return false;
+        --top_;
+        return true;
+    }
+};
 
 // 点积法求重心坐标
 // P = A + beta * (B - A) + gamma * (C - A)
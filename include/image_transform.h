@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+// 行优先、行间无填充的像素缓冲上的几何变换, 只支持 1 / 3 / 4 字节的像素
+// TgaImage 与 Framebuffer 的像素都可以直接传入
+//
+// 上下翻转逐行交换, 每次交换整行连续的字节
+// 左右翻转逐行反转像素, 1 / 4 字节的像素用 SSE2 每次反转 16 个字节
+// 转置与旋转按 32x32 像素的块进行, 块内读写的行都留在缓存中,
+// 不会每个像素跨越整行步长
+
+// 原地上下翻转
+void flip_rows(std::uint8_t *pixels, int width, int height, int bytespp);
+// 原地左右翻转
+void flip_columns(std::uint8_t *pixels, int width, int height, int bytespp);
+// 原地旋转 180 度
+void rotate_180(std::uint8_t *pixels, int width, int height, int bytespp);
+
+// 以下变换输出到 dst, dst 为 height x width 的图像, 不能与 src 重叠
+// 旋转方向以第 0 行为最上方一行计算
+// dst 第 x 行为 src 第 x 列
+void transpose(const std::uint8_t *src, int width, int height, int bytespp,
+               std::uint8_t *dst);
+// 顺时针旋转 90 度
+void rotate_90_cw(const std::uint8_t *src, int width, int height, int bytespp,
+                  std::uint8_t *dst);
+// 逆时针旋转 90 度
+void rotate_90_ccw(const std::uint8_t *src, int width, int height, int bytespp,
+                   std::uint8_t *dst);
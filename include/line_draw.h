@@ -0,0 +1,16 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "tga_image.h"
+#include <climits>
+#include <cstdint>
+
+// Bresenham 画线, 端点坐标为像素坐标, 超出帧缓冲的像素不绘制
+void line_draw(int ax, int ay, int bx, int by, TgaImage &frame_buffer,
+               const TgaColor &color);
+// 同上, 只画 [clip_y_min, clip_y_max] 行内的像素, 返回画出的像素个数
+// 裁剪范围内画出的像素与不裁剪时相同, 分带画同一条线不会在带的边界错开
+template <PixelFormat Format>
+std::int64_t line_draw(int ax, int ay, int bx, int by,
+                       Framebuffer<Format> &frame_buffer, PackedPixel color,
+                       int clip_y_min = 0, int clip_y_max = INT_MAX);
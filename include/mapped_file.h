@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// 只读内存映射文件
+// POSIX 下使用 mmap, Windows 下使用 CreateFileMapping / MapViewOfFile
+class MappedFile {
+  private:
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+#ifdef _WIN32
+    void *file_handle_ = nullptr;
+    void *mapping_handle_ = nullptr;
+#endif
+
+  public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    // 映射整个文件, 失败时返回 false 并保持关闭状态
+    // copy_on_write 为 true 时映射页可写, 写入只影响本进程的私有副本
+    bool open(const std::string &filename, bool copy_on_write = false);
+    void close();
+
+    bool is_open() const { return data_ != nullptr; }
+    const char *data() const { return data_; }
+    std::size_t size() const { return size_; }
+};
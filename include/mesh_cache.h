@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// 二进制网格缓存 (.smesh)
+// 布局: MeshCacheHeader | 源 OBJ 文件名 | 各数据段
+// 数据段与 Model 内存中的布局完全相同, 按 mesh_cache_alignment 对齐,
+// 加载时直接映射文件, 不解析也不拷贝
+// 文件按小端序写入, 字节序不同的机器上缓存视为无效
+//
+// 缓存记录源 OBJ 的大小、修改时间和内容哈希:
+// 大小或哈希不同视为过期; 只有修改时间不同时重新计算哈希确认
+// 源 OBJ 不存在或无法读取时无从判断, 输出警告后仍使用缓存
+// 加载时检查各段的大小以及面的各索引都在范围内, 否则视为无效
+constexpr char mesh_cache_magic[8] = {'S', 'R', 'M', 'E', 'S', 'H', 0, 0};
+constexpr std::uint32_t mesh_cache_version = 1;
+constexpr std::uint32_t mesh_cache_endian_tag = 0x01020304;
+constexpr std::uint64_t mesh_cache_alignment = 64;
+
+// 数据段, 顺序与 Model 的成员一致
+enum MeshCacheSection {
+    VERTICES,
+    TEX_COORDS,
+    NORMALS,
+    FACES,
+    FACE_TEX_COORDS,
+    FACE_NORMALS,
+    MESH_CACHE_SECTIONS
+};
+
+struct MeshCacheHeader {
+    char magic[8] = {};
+    std::uint32_t version = 0;
+    std::uint32_t endian_tag = 0;
+
+    std::uint64_t source_size = 0;
+    std::int64_t source_mtime = 0;
+    std::uint64_t source_hash = 0;
+
+    // 各数据段的元素个数及其相对文件开头的字节偏移
+    std::uint64_t counts[MESH_CACHE_SECTIONS] = {};
+    std::uint64_t offsets[MESH_CACHE_SECTIONS] = {};
+
+    // 紧跟在文件头之后的源 OBJ 文件名长度, 文件名相对缓存所在目录
+    std::uint32_t source_name_length = 0;
+    // 数据做过的网格优化, 见 Model::get_optimizations, 旧版本缓存中为 0
+    std::uint32_t optimizations = 0;
+};
+
+static_assert(sizeof(MeshCacheHeader) == 144, "MeshCacheHeader layout mismatch!");
+
+// OBJ 文件对应的缓存路径, 即把扩展名替换为 .smesh
+std::string mesh_cache_path(const std::string &obj_filename);
+bool is_mesh_cache_path(const std::string &filename);
+// 缓存中记录的源 OBJ 路径, 缓存无法读取或没有记录时返回空串
+std::string mesh_cache_source(const std::string &cache_filename);
+
+// 源文件的大小与修改时间, 文件不存在时返回 false
+bool source_stamp(const std::string &filename, std::uint64_t &size,
+                  std::int64_t &mtime);
+// 文件内容的 64 位 FNV-1a 哈希
+std::uint64_t hash_file(const std::string &filename);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "model.h"
+#include <cstdint>
+
+// 加载时的网格优化, 只改变面与顶点的顺序, 网格本身不变
+// 1. 三角形按 Tipsify (Sander et al. 2007) 重排: 围绕顶点成扇输出, 相邻的三角形尽量共享顶点,
+//    三角形阶段取变换后的顶点时命中缓存
+// 2. 顶点 (以及纹理坐标、法线) 按在面中首次出现的顺序重新编号,
+//    顶点阶段与三角形阶段都近似顺序地访问顶点数组
+// 3. 可选: 把第 1 步的结果切成小簇, 朝外的簇排在前面, 先画更可能遮挡其它部分的面,
+//    减少通过深度测试后又被覆盖的片元
+// 面的随机颜色由面的索引决定, 优化后渲染结果与优化前不同
+
+// 做过的优化, 记录在 Model::get_optimizations 中
+enum MeshOptimization : std::uint32_t {
+    MESH_OPTIMIZE_VERTEX_CACHE = 1u << 0, // 第 1、2 步
+    MESH_OPTIMIZE_OVERDRAW = 1u << 1,     // 第 3 步
+};
+
+struct MeshOptimizeOptions {
+    int cache_size = 16;   // Tipsify 假设的顶点缓存大小
+    bool overdraw = false; // 是否做第 3 步
+    // 第 3 步切分簇时, 簇的 ACMR 不超过所在区间整体 ACMR 的该倍数即可切分
+    // 越大簇越小, 排序越自由, 但顶点缓存命中率下降越多
+    float overdraw_threshold = 1.05f;
+};
+
+// 以大小为 cache_size 的 FIFO 缓存模拟变换后的顶点缓存, 按面的顺序逐个取顶点
+// acmr: 平均每个三角形的未命中次数, 在 0.5 左右 (理想) 到 3 之间
+// atvr: 被引用的顶点平均被变换的次数, 不小于 1
+struct VertexCacheStats {
+    double acmr = 0, atvr = 0;
+};
+VertexCacheStats vertex_cache_stats(const Model &model, int cache_size = 16);
+
+// 按 options 优化模型, 已经做过的优化不再重复, 模型被修改时返回 true
+bool optimize_mesh(Model &model, const MeshOptimizeOptions &options = {});
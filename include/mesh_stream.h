@@ -0,0 +1,196 @@
+#pragma once
+
+#include "depth_buffer.h"
+#include "frame_arena.h"
+#include "framebuffer.h"
+#include "geometry.h"
+#include "rasterizer.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 分块网格 (.cmesh) 与核外 (out-of-core) 流式渲染
+// 网格按面的顺序切成最多 chunk_triangles 个三角形的块, 每块独立编码:
+// - 块内用到的顶点按原下标升序排列, 位置量化为 16 位整数, 每个顶点 6 字节;
+//   每个坐标轴的步长为 2 的幂, 由整个网格的包围盒决定, 所有块相同 (见 lattice_exponents);
+//   块的原点对齐到步长, 所以同一坐标在所有块中解码结果逐位相同,
+//   相邻块共用的顶点位置一致, 块的接缝处不出现裂缝
+//   步长约为网格包围盒边长的 1 / 65535, 反量化的误差不超过步长的一半
+// - 三角形的块内顶点下标依次与前一个下标做差, zigzag 后以 LEB128 变长编码
+// 渲染时读线程按顺序读出各块, 渲染线程逐块解码、光栅化到同一帧,
+// 内存占用只与块的大小和预读的块数有关, 与网格的大小无关
+//
+// 布局: ChunkedMeshHeader | 块 0 | 块 1 | ... | 块偏移表
+// 块: MeshChunkHeader | 量化的位置 uint16[3 * num_vertices] | 下标的变长编码 (index_bytes 字节)
+// 每块的起始位置对齐到 chunked_mesh_alignment; 偏移表为 num_chunks + 1 个 uint64,
+// 最后一项为偏移表自身的位置, 即最后一块 (含对齐填充) 的结尾
+// 文件按小端序写入, 字节序不同的机器上视为无效
+constexpr char chunked_mesh_magic[8] = {'S', 'R', 'C', 'M', 'E', 'S', 'H', 0};
+constexpr std::uint32_t chunked_mesh_version = 2;
+constexpr std::uint32_t chunked_mesh_endian_tag = 0x01020304;
+constexpr std::uint64_t chunked_mesh_alignment = 8;
+// 每块三角形个数的上限, 保证块内的顶点下标与解码后的数组长度都在 int 范围内
+constexpr int max_chunk_triangles = 1 << 22;
+
+struct ChunkedMeshHeader {
+    char magic[8] = {};
+    std::uint32_t version = 0;
+    std::uint32_t endian_tag = 0;
+    std::uint64_t num_triangles = 0;
+    std::uint64_t num_chunks = 0;
+    std::uint64_t table_offset = 0;    // 块偏移表相对文件开头的字节偏移
+    std::uint32_t chunk_triangles = 0; // 写入时每块三角形个数的上限
+    std::int32_t exponent[3] = {};     // 各坐标轴量化步长的指数, 每块的 exponent 都与此相同
+};
+
+static_assert(sizeof(ChunkedMeshHeader) == 56, "ChunkedMeshHeader layout mismatch!");
+
+struct MeshChunkHeader {
+    // 每个坐标轴的量化格点: 坐标 = (origin + q) * 2^exponent, q 为 16 位无符号整数
+    // exponent 在整个网格中相同, origin 为块内最小坐标所在的格点
+    // origin + q 的绝对值不超过 2^24, 反量化没有舍入误差
+    std::int32_t origin[3] = {};
+    std::int32_t exponent[3] = {};
+    std::uint64_t first_triangle = 0; // 块中第一个三角形在整个网格中的编号, 决定面的颜色
+    std::uint32_t num_vertices = 0;
+    std::uint32_t num_triangles = 0;
+    std::uint32_t index_bytes = 0; // 下标的变长编码的字节数
+    std::uint32_t reserved = 0;
+};
+
+static_assert(sizeof(MeshChunkHeader) == 48, "MeshChunkHeader layout mismatch!");
+
+// OBJ 文件对应的分块网格路径, 即把扩展名替换为 .cmesh
+std::string chunked_mesh_path(const std::string &obj_filename);
+bool is_chunked_mesh_path(const std::string &filename);
+
+// 编码后的一块, 布局与文件中的块相同
+// 缓冲区在各块间复用, data 的容量只增不减, size 为当前块的字节数
+struct EncodedChunk {
+    std::vector<std::uint8_t> data;
+    std::size_t size = 0;
+
+    MeshChunkHeader header() const;
+};
+
+// 整个网格各坐标轴的量化步长的指数, 使包围盒 (不计非有限值的坐标) 能放进 16 位
+// 网格的所有块都用这一组步长编码, 共用的顶点在各块中量化为同一格点
+void lattice_exponents(const Vec3f *positions, std::size_t count, std::int32_t exponent[3]);
+
+// 把一组三角形编码为一块
+// indices 为 3 * num_triangles 个 positions 的下标, 块内只保存用到的顶点
+// exponent 为 lattice_exponents 对整个网格求出的步长; 非有限值的坐标量化为块的边界
+// 临时数组从 scratch 分配, 函数开始时复位 scratch
+void encode_chunk(const Vec3f *positions, const int *indices, int num_triangles,
+                  std::uint64_t first_triangle, const std::int32_t exponent[3], Arena &scratch,
+                  EncodedChunk &out);
+
+// 解码后的一块, 数组来自 Arena
+struct DecodedChunk {
+    ArenaArray<Vec3f> positions; // 反量化的顶点位置
+    ArenaArray<int> indices;     // 3 * 三角形个数个块内顶点下标
+    int first_triangle = 0;
+
+    int num_triangles() const { return indices.size() / 3; }
+};
+
+// 解码一块, 数组从 arena 分配; 数据损坏 (长度不符或下标越界) 时返回 false
+bool decode_chunk(const EncodedChunk &chunk, Arena &arena, DecodedChunk &out);
+
+struct MeshStreamOptions {
+    // 从 OBJ 读取时每块的三角形个数, 多边形面的三角形不拆到两块, 所以一块可能略多;
+    // 截断到 [1, max_chunk_triangles / 2]; .cmesh 的分块在写入时已确定
+    int chunk_triangles = 1 << 16;
+    // 预读的块数: 读线程最多领先渲染线程的块数, 至少为 1
+    int prefetch = 2;
+};
+
+// 分块网格的读取流
+// 读线程在后台按顺序产生编码后的块:
+// - .cmesh 逐块读出字节, 内存占用为 (prefetch + 1) 块与块偏移表
+// - OBJ 逐段 (每次 1MB) 读两遍: 第一遍读出全部顶点位置并求出量化步长,
+//   第二遍解析面, 攒够 chunk_triangles 个三角形后编码为一块;
+//   面可以引用任意位置的顶点, 所以读线程保留全部顶点位置 (每个 12 字节),
+//   面、纹理坐标与法线不驻留; 内存完全有界需要先用 write_chunked_mesh 转换
+// 三角形的编号与 Model 加载同一文件时面的编号相同 (有问题的行同样整行丢弃)
+// 块缓冲区在构造时创建 prefetch + 1 个, 之后循环使用: 渲染线程用 next 取块, 处理完后 release 归还,
+// 缓冲区都被占用时读线程阻塞 (背压), 读取与渲染互相重叠
+// 只允许一个线程调用 next / release
+class MeshStream {
+  private:
+    std::string filename_;
+    MeshStreamOptions options_;
+    std::vector<std::unique_ptr<EncodedChunk>> slots_;
+    std::deque<EncodedChunk *> free_;  // 空闲的缓冲区
+    std::deque<EncodedChunk *> ready_; // 读好等待渲染的块
+    bool finished_ = false;            // 读线程已产生全部的块
+    bool stopping_ = false;
+    bool failed_ = false;
+    std::int64_t bytes_read_ = 0, encoded_bytes_ = 0, chunks_ = 0;
+    double wait_ms_ = 0; // 只由渲染线程访问
+
+    mutable std::mutex mutex_;
+    std::condition_variable chunk_freed_;
+    std::condition_variable chunk_ready_;
+    std::thread thread_;
+
+    void run();
+    // 读线程的两种来源, 只有打开或读取失败时返回 false, 被要求停止时返回 true
+    bool read_chunked();
+    bool read_obj();
+    // 读线程取一个空闲的缓冲区, 被要求停止时返回 nullptr
+    EncodedChunk *acquire();
+    // 提交读好的块, bytes_read 为到目前为止从文件读取的字节数
+    void submit(EncodedChunk *chunk, std::int64_t bytes_read);
+
+  public:
+    explicit MeshStream(const std::string &filename, const MeshStreamOptions &options = {});
+    // 未读完时让读线程在当前块之后停止
+    ~MeshStream();
+    MeshStream(const MeshStream &) = delete;
+    MeshStream &operator=(const MeshStream &) = delete;
+
+    // 取下一块, 读线程还没读好时阻塞; 全部读完或出错时返回 nullptr
+    EncodedChunk *next();
+    // 归还 next 返回的块, 之后不能再访问
+    void release(EncodedChunk *chunk);
+
+    // 打开、读取或解析出错, next 返回 nullptr 之后才能确定
+    bool failed() const;
+    // 从文件读取的字节数, OBJ 读两遍, 约为文件大小的两倍
+    std::int64_t bytes_read() const;
+    // 已产生的块数与这些块编码后的总字节数
+    std::int64_t chunks() const;
+    std::int64_t encoded_bytes() const;
+    // 渲染线程在 next 中等待读线程的总时间
+    double wait_ms() const { return wait_ms_; }
+};
+
+// 把 OBJ 流式转换为 .cmesh, 读取 OBJ 的内存占用同 MeshStream, 写出时只保留块偏移表
+bool write_chunked_mesh(const std::string &obj_filename, const std::string &filename,
+                        const MeshStreamOptions &options = {});
+
+struct StreamRenderResult {
+    std::int64_t tested = 0;    // 做了深度测试的像素个数
+    std::int64_t triangles = 0; // 解码的三角形个数
+    std::int64_t vertices = 0;  // 解码的顶点个数, 跨块共用的顶点在每块中各计一次
+    std::int64_t chunks = 0;
+    bool ok = false; // 读取失败或块损坏时为 false, 已画入帧的块保留
+};
+
+// 流式渲染: 逐块解码、做顶点阶段, 再用 rasterize_indexed 画入同一帧
+// 每块解码之后立即归还缓冲区, 读线程读下一块与本块的光栅化重叠
+// 块的中间结果从 options.scratch 的 Arena 分配 (为空时临时创建), 每块开始时复位,
+// 用量只与块的大小有关; 其余选项的含义同 rasterize_indexed
+// options.stats 不为空时等待读线程的时间计入 LOAD, 解码与顶点变换计入 VERTEX
+// 位置经过量化, 与 rasterize 整个模型相比三角形的边缘可能有个别像素不同;
+// 量化的格点由整个网格决定, 所以结果与分块方式 (每块的三角形个数) 无关
+// 支持 PixelFormat 的全部三种格式, 在 mesh_stream.cpp 中显式实例化
+template <PixelFormat Format>
+StreamRenderResult render_stream(MeshStream &stream, Framebuffer<Format> &frame_buffer,
+                                 DepthBuffer &depth_buffer, const RasterOptions &options = {});
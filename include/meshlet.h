@@ -0,0 +1,53 @@
+#pragma once
+
+#include "geometry.h"
+#include "model.h"
+#include <vector>
+
+// 网格簇 (meshlet): 一组相邻且朝向相近的面
+// 每个簇记录模型空间的包围球与法线锥, 光栅化时先整簇剔除背向相机或位于屏幕外的簇,
+// 被剔除的簇内的面不再做逐面的取顶点、背面剔除与包围盒计算
+// 簇也是三角形阶段分给线程的工作单位
+struct Meshlet {
+    int face_begin = 0, face_count = 0; // 面在 Meshlets::faces 中的区间
+    Vec3f center = {0, 0, 0};           // 包围球, 包含簇内全部顶点
+    float radius = 0;
+    // 法线锥: 簇内每个面的单位法线 n 满足 dot(n, cone_axis) >= cone_cutoff
+    // cone_cutoff <= 0 时法线张开超过半球, 不做整簇背面剔除
+    Vec3f cone_axis = {0, 0, 1};
+    float cone_cutoff = -1;
+};
+
+struct Meshlets {
+    std::vector<Meshlet> meshlets;
+    std::vector<int> faces; // 按簇排列的面索引, 模型的每个面恰好出现一次
+};
+
+// 把模型的面划分为簇
+// 从按顺序第一个未分配的面开始, 沿共享顶点的相邻面贪心扩展, 优先加入法线与簇的平均法线
+// 接近且离簇中心近的面, 达到 max_faces 个面, 或已有一半以上且剩下的相邻面朝向差别较大时结束
+// 法线无法可靠求出的退化面单独成簇, 这些簇不做背面剔除
+void build_meshlets(const Model &model, Meshlets &out, int max_faces = 128);
+
+enum class MeshletCull { VISIBLE, BACKFACE, OFFSCREEN };
+
+// 一帧的簇剔除参数, 由视口大小与模型变换求出
+// 剔除是保守的: 被剔除的簇内每个面在逐面剔除中也一定被判为背面、退化或位于屏幕外,
+// 所以使用簇剔除与否渲染结果相同
+class MeshletCuller {
+  private:
+    Affine3f transform_ = {};
+    // 法线变换, 为 transform 线性部分的余子式矩阵
+    // 线性部分不是旋转乘均匀缩放时法线锥的夹角不再保持, 不做背面剔除
+    float normal_matrix_[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+    bool backface_ = true;
+    float scale_x_ = 0, scale_y_ = 0;   // 视口变换的缩放
+    float radius_x_ = 0, radius_y_ = 0; // 包围球半径投影到屏幕 x / y 方向的倍数
+    int width_ = 0, height_ = 0;
+
+  public:
+    // transform 的含义与 RasterOptions::transform 相同, 为空时不变换
+    MeshletCuller(int width, int height, const Affine3f *transform = nullptr);
+
+    MeshletCull cull(const Meshlet &meshlet) const;
+};
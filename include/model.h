@@ -1,19 +1,94 @@
 #pragma once
 
+#include "frame_arena.h"
 #include "geometry.h"
+#include "mapped_file.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include <vector>
 
+// 模型数据数组
+// 从 OBJ 解析时数据由内部的 std::vector 持有
+// 从网格缓存加载时直接指向映射的文件内容, 不做拷贝
+template <typename T> class MeshArray {
+  private:
+    std::vector<T> storage_ = {};
+    T *data_ = nullptr;
+    std::size_t size_ = 0;
+
+  public:
+    MeshArray() = default;
+    MeshArray(const MeshArray &) = delete;
+    MeshArray &operator=(const MeshArray &) = delete;
+    MeshArray(MeshArray &&) = default;
+    MeshArray &operator=(MeshArray &&) = default;
+
+    // 调整大小, 之后数据总是由自身持有, 原有内容保留
+    void resize(std::size_t size) {
+        if (data_ != storage_.data()) storage_.assign(data_, data_ + size_);
+        storage_.resize(size);
+        data_ = storage_.data();
+        size_ = size;
+    }
+    // 引用外部数据, 调用方保证其生命周期
+    void view(T *data, std::size_t size) {
+        storage_ = {};
+        data_ = data;
+        size_ = size;
+    }
+
+    std::size_t size() const { return size_; }
+    T *data() { return data_; }
+    const T *data() const { return data_; }
+    T &operator[](std::size_t index) { return data_[index]; }
+    const T &operator[](std::size_t index) const { return data_[index]; }
+};
+
 class Model {
   private:
-    std::vector<Vec3f> vertices_ = {}; // 顶点
-    std::vector<int> faces_ = {};      // 每个面顶点在上面顶点数组中的索引
+    MeshArray<Vec3f> vertices_ = {};   // 顶点
+    MeshArray<Vec2f> tex_coords_ = {}; // 纹理坐标 (vt 的 u, v 分量)
+    MeshArray<Vec3f> normals_ = {};    // 法线
+    MeshArray<int> faces_ = {};      // 每个面顶点在上面顶点数组中的索引
+    // 每个面顶点的纹理坐标 / 法线索引, 与 faces_ 一一对应, 文件中没有给出时为 -1
+    MeshArray<int> face_tex_coords_ = {};
+    MeshArray<int> face_normals_ = {};
+    // 从网格缓存加载时, 上面的数组引用这里映射的文件
+    MappedFile cache_file_ = {};
+    std::uint32_t optimizations_ = 0;
+
+    bool load_obj(const std::string &filename);
+    bool load_cache(const std::string &filename, const std::string &source);
+
   public:
+    // filename 为 .obj 时, 如果同目录下存在未过期的同名 .smesh 网格缓存则直接映射缓存,
+    // 否则解析 OBJ; filename 为 .smesh 时直接映射, 缓存过期则回退到解析源 OBJ
     Model(const std::string &filename);
+    // 把模型写成网格缓存, source 为对应的 OBJ 文件, 用于之后判断缓存是否过期
+    bool write_cache(const std::string &filename, const std::string &source) const;
+
+    // 按 order 重排面, 新的第 k 个面为原来的第 order[k] 个面, 各项索引随面一起移动
+    // order 必须是 [0, num_faces()) 的一个排列
+    // 临时数组从 scratch 分配并在返回前复位 scratch, 为空时使用临时的 Arena
+    void reorder_faces(const std::vector<int> &order, Arena *scratch = nullptr);
+    // 顶点、纹理坐标与法线各自按在面中首次出现的顺序重新编号, 并重排对应的数组
+    // 没有被面引用的排在最后, 保持原来的相对顺序, 个数不变
+    // scratch 的含义同 reorder_faces
+    void renumber_vertices(Arena *scratch = nullptr);
+    // 做过的网格优化, 为 MeshOptimization (mesh_optimize.h) 的位组合, 随网格缓存保存
+    std::uint32_t get_optimizations() const { return optimizations_; }
+    void set_optimizations(std::uint32_t optimizations) { optimizations_ = optimizations; }
+
     int num_vertices() const { return vertices_.size(); } // 顶点个数
     int num_faces() const { return faces_.size() / 3; }   // 面的个数
+    int num_tex_coords() const { return tex_coords_.size(); }
+    int num_normals() const { return normals_.size(); }
     // 0 <= vertex_index < num_vertices()
     const Vec3f &vertex(int vertex_index) const { return vertices_[vertex_index]; }
     Vec3f &vertex(int vertex_index) { return vertices_[vertex_index]; }
+    // 连续存放的全部顶点, 供顶点阶段批量变换
+    const Vec3f *vertex_data() const { return vertices_.data(); }
     // 0 <= face_index < nums_faces, 0 <= vertex_nth_of_face < 3
     const Vec3f &vertex(int face_index, int vertex_nth_of_face) const {
         return vertices_[faces_[face_index * 3 + vertex_nth_of_face]];
@@ -21,4 +96,19 @@ class Model {
     Vec3f &vertex(int face_index, int vertex_nth_of_face) {
         return vertices_[faces_[face_index * 3 + vertex_nth_of_face]];
     }
+    // 0 <= tex_coord_index < num_tex_coords()
+    const Vec2f &tex_coord(int tex_coord_index) const { return tex_coords_[tex_coord_index]; }
+    // 0 <= normal_index < num_normals()
+    const Vec3f &normal(int normal_index) const { return normals_[normal_index]; }
+    // 面顶点的各项索引, 参数范围同 vertex(face_index, vertex_nth_of_face)
+    // 纹理坐标 / 法线索引在文件中没有给出时返回 -1
+    int vertex_index(int face_index, int vertex_nth_of_face) const {
+        return faces_[face_index * 3 + vertex_nth_of_face];
+    }
+    int tex_coord_index(int face_index, int vertex_nth_of_face) const {
+        return face_tex_coords_[face_index * 3 + vertex_nth_of_face];
+    }
+    int normal_index(int face_index, int vertex_nth_of_face) const {
+        return face_normals_[face_index * 3 + vertex_nth_of_face];
+    }
 };
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "depth_buffer.h"
+#include "edge_rasterizer.h"
+#include "framebuffer.h"
+#include "geometry.h"
+#include "stats.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 多重采样抗锯齿 (MSAA)
+// 每个像素有 4 或 8 个采样点, 位置为 D3D 的标准采样模式 (y 轴方向相反),
+// 以 1/16 像素为单位, 与 FixedPointTriangle 的 28.4 定点精度相同,
+// 采样点的覆盖判断仍是整数边函数加 top-left 规则, 共享边的两个三角形在每个采样点上恰好一个覆盖
+// 光栅化时逐像素求出覆盖掩码, 每个像素只取一次颜色 (着色一次), 写入被覆盖且通过深度测试的采样点
+// 深度逐采样点存放与测试, 最后 resolve 把各采样点的颜色取平均写入帧缓冲
+constexpr int max_msaa_samples = 8;
+
+// 采样点相对像素中心的偏移 (x, y), 单位为 1/16 像素, samples 必须是 4 或 8
+const std::int8_t (*msaa_sample_offsets(int samples))[2];
+inline bool is_valid_msaa_samples(int samples) { return samples == 4 || samples == 8; }
+
+// 多重采样的颜色与深度, 一个像素的所有采样点连续存放
+// 颜色为打包的 32 位像素, 深度的含义与 DepthBuffer 相同 (越大越近, 清空为 0)
+// 与 DepthBuffer 一样由调用方持有并每帧清空, 多次调用 rasterize 画入同一帧时采样点在调用之间保留
+class MsaaBuffer {
+  private:
+    int width_ = 0, height_ = 0, samples_ = 0;
+    std::vector<PackedPixel> colors_ = {};
+    std::vector<float> depth_ = {};
+
+  public:
+    MsaaBuffer() = default;
+    // samples 必须是 4 或 8
+    MsaaBuffer(const int width, const int height, const int samples);
+
+    int get_width() const { return width_; }
+    int get_height() const { return height_; }
+    int get_samples() const { return samples_; }
+
+    // 像素 (x, y) 的第一个采样点的下标, 不做边界检查
+    // 与采样点一一对应的其他数据 (如可见性缓冲模式下的面的编号) 使用相同的下标
+    std::size_t sample_index(int x, int y) const {
+        return (static_cast<std::size_t>(y) * width_ + x) * samples_;
+    }
+    PackedPixel *colors(int x, int y) { return colors_.data() + sample_index(x, y); }
+    const PackedPixel *colors(int x, int y) const { return colors_.data() + sample_index(x, y); }
+    float *depth(int x, int y) { return depth_.data() + sample_index(x, y); }
+    const float *depth(int x, int y) const { return depth_.data() + sample_index(x, y); }
+
+    void clear(PackedPixel color = 0, float depth = 0.f);
+
+    // 把 [x_min, x_max]x[y_min, y_max] 内的像素解析到帧缓冲与深度缓冲
+    // 颜色为各采样点每个通道的平均值 (四舍五入), 深度为最近的采样点的深度, 写入的 Hi-Z 块标记为脏
+    // path 为 AVX2 / SSE 时向量化, 各路径结果逐位一致
+    // 支持 PixelFormat 的全部三种格式, 在 msaa.cpp 中显式实例化
+    template <PixelFormat Format>
+    void resolve(Framebuffer<Format> &frame_buffer, DepthBuffer &depth_buffer, int x_min,
+                 int y_min, int x_max, int y_max, RasterPath path) const;
+};
+
+// 多重采样光栅化单个三角形, 只处理 [clip_x_min, clip_x_max]x[clip_y_min, clip_y_max] 内的像素
+// 裁剪矩形必须位于 buffer 内
+// 深度写入 buffer, pixel 写入被覆盖且通过深度测试的采样点:
+// target 为空时写入 buffer 的颜色, 否则写入 target 的第 sample_index 个元素
+// (可见性缓冲模式下 target 为逐采样点的面的编号)
+// path 必须是 select_raster_path 返回的 SCALAR / SSE / AVX2 之一, 采样点的深度测试按路径向量化
+// 不使用 Hi-Z, 也不做大小分类
+// stats 不为空时按像素累加: 至少一个采样点被覆盖的像素计为做了深度测试,
+// 至少一个采样点通过深度测试的像素计为通过
+// 返回至少一个采样点被覆盖的像素个数
+std::int64_t triangle_rasterize_msaa(const Vec3f &p0, const Vec3f &p1, const Vec3f &p2,
+                                     MsaaBuffer &buffer, PackedPixel *target,
+                                     PackedPixel pixel, int clip_x_min, int clip_y_min,
+                                     int clip_x_max, int clip_y_max, RasterPath path,
+                                     ThreadStats *stats = nullptr);
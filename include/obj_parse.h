@@ -0,0 +1,107 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+
+// OBJ 的逐行解析工具, 由 Model::load_obj 与流式读取 (mesh_stream) 共用
+// 所有函数只在 [p, end) 内读取, 不要求行以 '\0' 结尾
+namespace obj_parse {
+
+enum LineType { OTHER, VERTEX, TEX_COORD, NORMAL, FACE };
+
+inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char *skip_spaces(const char *p, const char *end) {
+    while (p < end && is_space(*p)) ++p;
+    return p;
+}
+
+inline const char *skip_token(const char *p, const char *end) {
+    while (p < end && !is_space(*p)) ++p;
+    return p;
+}
+
+inline const char *find_line_end(const char *p, const char *end) {
+    const void *eol = std::memchr(p, '\n', end - p);
+    return eol ? static_cast<const char *>(eol) : end;
+}
+
+// 行尾 eol 之后下一行的起始位置
+inline const char *next_line(const char *eol, const char *end) {
+    return eol < end ? eol + 1 : end;
+}
+
+// 识别行首关键字, p 移动到关键字之后
+inline LineType line_type(const char *&p, const char *end) {
+    p = skip_spaces(p, end);
+    const char *keyword = p;
+    p = skip_token(p, end);
+    switch (p - keyword) {
+    case 1:
+        if (keyword[0] == 'v') return VERTEX;
+        if (keyword[0] == 'f') return FACE;
+        break;
+    case 2:
+        if (keyword[0] != 'v') break;
+        if (keyword[1] == 't') return TEX_COORD;
+        if (keyword[1] == 'n') return NORMAL;
+        break;
+    }
+    return OTHER;
+}
+
+// 统计一行中剩余的空白分隔的记号个数
+inline std::size_t count_tokens(const char *p, const char *end) {
+    std::size_t count = 0;
+    for (p = skip_spaces(p, end); p < end; p = skip_spaces(p, end)) {
+        p = skip_token(p, end);
+        ++count;
+    }
+    return count;
+}
+
+inline bool parse_float(const char *&p, const char *end, float &value) {
+    p = skip_spaces(p, end);
+    if (p < end && *p == '+') ++p; // from_chars 不接受正号
+    auto [ptr, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc()) return false;
+    p = ptr;
+    return true;
+}
+
+// 解析 v, v/vt, v//vn, v/vt/vn 形式的面顶点, 缺省的分量记为 0
+// indices 为 OBJ 中从 1 开始 (负数表示相对) 的原始索引
+inline bool parse_face_vertex(const char *&p, const char *end, int indices[3]) {
+    indices[0] = indices[1] = indices[2] = 0;
+    const char *token_end = skip_token(p, end);
+    const char *q = p;
+    // 无论成功与否都跳过整个记号
+    p = token_end;
+    for (int k = 0; k < 3 && q < token_end; ++k) {
+        if (*q != '/') {
+            auto [ptr, ec] = std::from_chars(q, token_end, indices[k]);
+            if (ec != std::errc()) return false;
+            q = ptr;
+        }
+        if (q < token_end) {
+            if (*q != '/') return false;
+            ++q;
+        }
+    }
+    return q == token_end && indices[0] != 0;
+}
+
+// OBJ 索引转为从 0 开始的数组下标
+// defined 为该行之前已定义的元素个数 (用于相对索引), total 为元素总数
+// 缺省 (raw == 0) 返回 -1, 越界返回 -2
+inline int resolve_index(int raw, std::size_t defined, std::size_t total) {
+    long long index = raw > 0 ? raw - 1LL
+                    : raw < 0 ? static_cast<long long>(defined) + raw
+                              : -1;
+    if (raw != 0 && (index < 0 || index >= static_cast<long long>(total)))
+        return -2;
+    return static_cast<int>(index);
+}
+
+} // namespace obj_parse
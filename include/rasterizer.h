@@ -0,0 +1,162 @@
+#pragma once
+
+#include "depth_buffer.h"
+#include "edge_rasterizer.h"
+#include "frame_arena.h"
+#include "framebuffer.h"
+#include "geometry.h"
+#include "meshlet.h"
+#include "model.h"
+#include "msaa.h"
+#include "stats.h"
+#include "texture.h"
+#include "tga_image.h"
+#include "vertex_stage.h"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// 屏幕分块 (tile) 的边长, 单位为像素
+// 每个 tile 由一个线程独占光栅化, 所以同一像素只会被一个线程写入, 无需加锁
+constexpr int tile_size = 64;
+
+// 可见性缓冲: 每个像素为覆盖它的最近的面的编号 (面的索引 + 1), 0 表示没有面覆盖
+// 与 RGBA 帧缓冲的布局相同, 光栅化时把编号当作像素值写入, 与写颜色共用同一套内循环
+using VisibilityBuffer = Framebuffer<PixelFormat::RGBA>;
+
+// 视口变换、背面剔除之后的屏幕空间三角形
+struct TriangleSetup {
+    Vec3f p0, p1, p2;
+    // 包围盒, 已裁剪到屏幕范围内, x_min > x_max 表示三角形被剔除
+    int x_min = 0, y_min = 0, x_max = -1, y_max = -1;
+};
+
+// 三角形按包围盒分到各 tile 的结果, 数组来自帧的 Arena
+// 第 tile 个 tile 的三角形为 triangles[tile_begin[tile]] .. triangles[tile_begin[tile + 1] - 1],
+// 按三角形的下标升序排列; tile 按行优先编号
+struct TileBins {
+    int tiles_x = 0, tiles_y = 0;
+    ArenaArray<int> tile_begin, triangles;
+
+    int num_tiles() const { return tiles_x * tiles_y; }
+    bool empty(int tile) const { return tile_begin[tile] == tile_begin[tile + 1]; }
+    // 第 tile 个 tile 的像素范围 [x_min, x_max]x[y_min, y_max], 已裁剪到屏幕内
+    void tile_rect(int tile, int width, int height, int &x_min, int &y_min, int &x_max,
+                   int &y_max) const {
+        x_min = tile % tiles_x * tile_size;
+        y_min = tile / tiles_x * tile_size;
+        x_max = std::min(x_min + tile_size, width) - 1;
+        y_max = std::min(y_min + tile_size, height) - 1;
+    }
+};
+
+// rasterize 各阶段的中间结果
+// 每帧的数组都从 arena 分配, 每次调用 rasterize 开始时复位 (上一次调用的结果随之失效)
+// 多帧渲染时每帧传入同一个对象, arena 的容量足够后每帧不再分配内存
+struct RasterScratch {
+    FrameArena arena;
+    ArenaArray<TgaColor> colors;
+    TransformedVertices vertices;
+    ArenaArray<TriangleSetup> setups;
+    TileBins bins;
+    VisibilityBuffer visibility; // 跨帧保留, 大小与帧缓冲不同时重新分配
+    // 多重采样时的可见性缓冲, 每个采样点一个面的编号, 下标与 MsaaBuffer::sample_index 相同
+    ArenaArray<PackedPixel> sample_ids;
+};
+
+// 由屏幕空间的顶点求出 setup 的包围盒并裁剪到 width x height 的屏幕内
+// 完全位于屏幕外时标记为剔除 (x_min > x_max) 并返回 false
+bool triangle_bounds(TriangleSetup &setup, const int width, const int height);
+// 把 setups[0, count) 中未被剔除的三角形按包围盒分到各 tile, 按三角形的区间多线程并行
+// out 与中间结果从 arena 分配: 各区间的计数在处理该区间的线程的 Arena 中, 其余在 shared 中
+// arena 必须已经 reset 过 (线程的 Arena 已按线程数准备好)
+void bin_triangles(const TriangleSetup *setups, const int count, const int width,
+                   const int height, FrameArena &arena, TileBins &out);
+
+// 光栅化选项
+struct RasterOptions {
+    RasterPath path = RasterPath::AUTO; // 内循环实现
+    bool hierarchical_z = true;         // 是否使用 Hi-Z 提前剔除
+    FrameStats *stats = nullptr;        // 不为空时记录各阶段耗时与计数
+    std::uint32_t color_seed = 0;       // 面颜色的随机种子, 相同种子渲染结果相同
+    // 不为空时先对顶点做该变换再做视口变换, 只支持旋转、正的缩放与平移,
+    // 正交投影下屏幕空间的背面剔除仍然成立
+    const Affine3f *transform = nullptr;
+    RasterScratch *scratch = nullptr; // 为空时每次调用临时分配
+    // 不为空时先整簇剔除, 剔除以簇为单位分配给线程, 必须由 build_meshlets 从同一个模型生成
+    const Meshlets *meshlets = nullptr;
+    // 为 true 时使用可见性缓冲 (延迟着色): 光栅化只写深度与面的编号,
+    // 之后按 tile 并行对每个可见像素着色一次, 着色开销与 overdraw 无关
+    bool visibility_buffer = false;
+    // 不为空时用纹理着色, 总是使用可见性缓冲, 着色时由面的编号求出像素的纹理坐标
+    // 没有纹理坐标的面仍使用随机颜色
+    const Texture *texture = nullptr;
+    // 不为空时多重采样光栅化, 大小必须与帧缓冲相同, 与帧缓冲一样由调用方每帧清空 (颜色相同)
+    // 每个像素只着色一次, 写入覆盖的采样点; 光栅化完一个 tile 后立即解析到帧缓冲与深度缓冲
+    // path 为 BARYCENTRIC 时多重采样使用 SCALAR, 不使用 Hi-Z
+    MsaaBuffer *msaa = nullptr;
+};
+
+// 视口变换
+// NDC -> [0, width]x[0, height]x[0, 1]
+Vec3f viewport_trans(const Vec3f &point, const int width, const int height);
+
+// 光栅化单个三角形, 只处理落在 [clip_x_min, clip_x_max]x[clip_y_min,
+// clip_y_max] 内的像素, 返回被三角形覆盖的像素个数
+// 覆盖判断使用 FixedPointTriangle 的整数边函数与 top-left 规则, 深度用浮点重心坐标插值
+// pixel 的含义与 triangle_rasterize_edge 相同
+// stats 不为空时累加通过深度测试的像素个数和每个像素的覆盖次数
+template <PixelFormat Format>
+std::int64_t triangle_rasterize(const Vec3f &p0, const Vec3f &p1,
+                                const Vec3f &p2,
+                                Framebuffer<Format> &frame_buffer,
+                                DepthBuffer &depth_buffer,
+                                PackedPixel pixel, int clip_x_min,
+                                int clip_y_min, int clip_x_max, int clip_y_max,
+                                ThreadStats *stats = nullptr);
+// 光栅化单个三角形, 处理整个帧缓冲
+template <PixelFormat Format>
+std::int64_t triangle_rasterize(const Vec3f &p0, const Vec3f &p1,
+                                const Vec3f &p2,
+                                Framebuffer<Format> &frame_buffer,
+                                DepthBuffer &depth_buffer,
+                                const TgaColor &color);
+
+// 分块多线程光栅化
+// 1. 并行做三角形的视口变换、背面剔除和包围盒计算
+//    options.meshlets 不为空时先整簇剔除, 只对可见簇内的面逐面剔除, 渲染结果不变
+// 2. 按包围盒把三角形分到各个 tile, 每个 tile 内三角形保持模型中面的顺序
+// 3. 以 tile 为单位并行光栅化, 内循环由 options.path 选择
+// 4. options.visibility_buffer 为 true 或 options.texture 不为空时, 第 3 步写入 scratch 的可见性缓冲,
+//    再以 tile 为单位并行地按面的编号给可见像素着色; 不用纹理时渲染结果与直接写颜色逐像素一致
+//    可见性缓冲每次调用都会清空, 多次调用画入同一帧时, 之前画的像素在未被遮挡处保持不变
+// 5. options.msaa 不为空时第 3 步写入各采样点, 可见性缓冲也逐采样点存放,
+//    每个 tile 着色之后由 MsaaBuffer::resolve 解析, 没有三角形的 tile 不解析
+// path 为 BARYCENTRIC 时结果与 rasterize_serial 逐像素一致, 且不使用 Hi-Z
+// 返回做了深度测试的像素个数 (同一像素被多个三角形覆盖时重复计数)
+// 多重采样时每个三角形覆盖了至少一个采样点的像素计一次
+// 帧缓冲与深度缓冲不会被清除, 多帧渲染时由调用方每帧清除
+// 以上函数支持 PixelFormat 的全部三种格式, 在 rasterizer.cpp 中显式实例化
+template <PixelFormat Format>
+std::int64_t rasterize(const Model &model, Framebuffer<Format> &frame_buffer,
+                       DepthBuffer &depth_buffer,
+                       const RasterOptions &options = {});
+// 光栅化一批已做过顶点阶段的三角形, 用于逐块渲染不在内存中的网格 (见 mesh_stream.h)
+// indices 为 3 * count 个 vertices 的下标, 第 i 个三角形的颜色与 rasterize 中编号为
+// first_face + i 的面相同; 顶点位置与 rasterize 所用的完全相同时, 按面的顺序逐块调用的结果
+// 与一次 rasterize 整个网格逐像素一致. render_stream 的位置经过量化, 不满足这一条件,
+// 与 rasterize 相比三角形边缘有个别像素不同
+// 剔除、分块与光栅化同 rasterize 直接写颜色的路径; 忽略 meshlets、visibility_buffer、
+// texture、msaa 与 scratch, 中间结果从 arena 分配, arena 必须已经 reset 过
+// 返回做了深度测试的像素个数
+template <PixelFormat Format>
+std::int64_t rasterize_indexed(const TransformedVertices &vertices, const int *indices,
+                               int count, int first_face, Framebuffer<Format> &frame_buffer,
+                               DepthBuffer &depth_buffer, FrameArena &arena,
+                               const RasterOptions &options = {});
+// 串行逐面光栅化, 作为参考实现
+template <PixelFormat Format>
+std::int64_t rasterize_serial(const Model &model,
+                              Framebuffer<Format> &frame_buffer,
+                              DepthBuffer &depth_buffer,
+                              std::uint32_t color_seed = 0);
@@ -0,0 +1,305 @@
+#pragma once
+
+#include "depth_buffer.h"
+#include "edge_rasterizer.h"
+#include "frame_arena.h"
+#include "framebuffer.h"
+#include "geometry.h"
+#include "model.h"
+#include "rasterizer.h"
+#include "stats.h"
+#include <algorithm>
+#include <cstdint>
+#include <omp.h>
+
+// 可编程着色管线
+// 着色器以模板参数传入, 每个着色器类型实例化一份管线, 片元着色内联进光栅化内循环,
+// 没有虚函数调用, 也不经过 std::function
+// 着色器类型 Shader 需要提供:
+//   static constexpr int varyings;  // 每个顶点输出、在三角形内插值的浮点数个数, 编译期常量
+//   // 第 face 个面的第 nth 个顶点, 返回裁剪空间的齐次坐标, varyings 写入 out
+//   Vec4f vertex(int face, int nth, Varyings<Shader::varyings> &out) const;
+//   // 片元着色, in 为透视校正插值后的 varyings, 返回写入帧缓冲的像素
+//   PackedPixel fragment(int face, const Varyings<Shader::varyings> &in) const;
+// 两个函数在多个线程中同时调用, 不能修改着色器的状态
+//
+// 管线的各阶段:
+// 1. 几何: 按面并行调用顶点着色器, 用近平面 (z <= w) 裁剪, 透视除法与视口变换后做背面剔除,
+//    裁剪后的多边形最多拆成两个三角形
+// 2. 分块: 与 rasterize 相同, 三角形按包围盒分到各 tile
+// 3. 光栅化: 以 tile 为单位并行, 覆盖判断使用 FixedPointTriangle 的整数边函数与 top-left 规则,
+//    深度在屏幕空间线性插值, 先做深度测试, 通过后才插值 varyings 并调用片元着色器
+//    (着色器不能修改深度, 所以提前深度测试不改变结果)
+// 模型、视图、投影都为单位矩阵时覆盖的像素与 rasterize 完全相同
+template <int N> using Varyings = Vec<N, float>;
+
+// 几何阶段输出的一个三角形
+// 透视校正: varyings / w 与 1 / w 在屏幕空间是线性的, 插值后相除得到透视校正的值
+template <int N> struct ShadedTriangle {
+    int face = 0;
+    float inv_w[3];
+    float varyings[3][N > 0 ? N : 1];
+};
+
+// 管线各阶段的中间结果, 数组从 arena 分配, 每帧在几何阶段开始时复位
+// 多帧渲染时复用, arena 的容量足够后每帧不再分配内存
+// 第 face 个面裁剪后的三角形存放在下标 2 * face 与 2 * face + 1, 保持面的顺序
+template <int N> struct PipelineScratch {
+    FrameArena arena;
+    ArenaArray<TriangleSetup> setups;
+    ArenaArray<ShadedTriangle<N>> triangles;
+    TileBins bins;
+};
+
+namespace pipeline_detail {
+
+// 裁剪空间的一个顶点
+template <int N> struct ClipVertex {
+    Vec4f position;
+    Varyings<N> varyings;
+};
+
+template <int N>
+ClipVertex<N> lerp(const ClipVertex<N> &a, const ClipVertex<N> &b, float t) {
+    ClipVertex<N> result;
+    for (int i = 0; i < 4; ++i)
+        result.position[i] = a.position[i] + (b.position[i] - a.position[i]) * t;
+    for (int k = 0; k < N; ++k)
+        result.varyings[k] = a.varyings[k] + (b.varyings[k] - a.varyings[k]) * t;
+    return result;
+}
+
+// 透视除法、视口变换与背面剔除, 结果写入 setup / triangle
+// 屏幕坐标由 viewport_trans 求出, w = 1 时与 rasterize 的顶点阶段逐位一致
+template <int N>
+void setup_triangle(const ClipVertex<N> *v[3], int face, const int width, const int height,
+                    TriangleSetup &setup, ShadedTriangle<N> &triangle,
+                    ThreadStats *stats) {
+    Vec3f *screen[3] = {&setup.p0, &setup.p1, &setup.p2};
+    for (int j = 0; j < 3; ++j) {
+        const Vec4f &p = v[j]->position;
+        const float inv_w = 1.f / p[3];
+        *screen[j] = viewport_trans(Vec3f{p[0] * inv_w, p[1] * inv_w, p[2] * inv_w}, width,
+                                    height);
+        triangle.inv_w[j] = inv_w;
+        for (int k = 0; k < N; ++k) triangle.varyings[j][k] = v[j]->varyings[k] * inv_w;
+    }
+    triangle.face = face;
+    // 与 rasterize 相同的屏幕空间背面剔除, 逆时针为正面
+    const float area = (setup.p1.x - setup.p0.x) * (setup.p2.y - setup.p0.y) -
+                       (setup.p1.y - setup.p0.y) * (setup.p2.x - setup.p0.x);
+    constexpr float epsilon = 1e-6f;
+    if (area < epsilon) {
+        setup.x_min = 0, setup.x_max = -1;
+        if (area > -epsilon) {
+            RENDERER_STATS_ADD(stats, degenerate, 1);
+        } else {
+            RENDERER_STATS_ADD(stats, backface, 1);
+        }
+        return;
+    }
+    if (!triangle_bounds(setup, width, height)) RENDERER_STATS_ADD(stats, offscreen, 1);
+}
+
+} // namespace pipeline_detail
+
+// 几何阶段: 对每个面调用顶点着色器, 裁剪、剔除并求出包围盒
+// 开始时复位 scratch.arena, 之前的中间结果全部失效
+template <typename Shader>
+void pipeline_geometry(const Model &model, const Shader &shader, const int width,
+                       const int height, PipelineScratch<Shader::varyings> &scratch,
+                       FrameStats *stats = nullptr) {
+    constexpr int N = Shader::varyings;
+    using pipeline_detail::ClipVertex;
+    const int num_faces = model.num_faces();
+    scratch.arena.reset();
+    scratch.setups.allocate(scratch.arena.shared(), num_faces * 2);
+    scratch.triangles.allocate(scratch.arena.shared(), num_faces * 2);
+    RENDERER_STATS_ONLY(if (stats) stats->add_triangles(num_faces);)
+#pragma omp parallel
+    {
+        ThreadStats *thread_stats = nullptr;
+        RENDERER_STATS_ONLY(if (stats) thread_stats = stats->thread(omp_get_thread_num());)
+#pragma omp for schedule(static)
+        for (int face = 0; face < num_faces; ++face) {
+            TriangleSetup *setups = scratch.setups.data() + face * 2;
+            ShadedTriangle<N> *triangles = scratch.triangles.data() + face * 2;
+            setups[0].x_min = setups[1].x_min = 0;
+            setups[0].x_max = setups[1].x_max = -1;
+
+            ClipVertex<N> in[3];
+            float distance[3]; // 到近平面的有向距离, 非负时在内侧
+            int inside = 0;
+            for (int j = 0; j < 3; ++j) {
+                in[j].position = shader.vertex(face, j, in[j].varyings);
+                distance[j] = in[j].position[3] - in[j].position[2];
+                inside += distance[j] >= 0;
+            }
+            if (inside == 3) {
+                const ClipVertex<N> *v[3] = {&in[0], &in[1], &in[2]};
+                pipeline_detail::setup_triangle(v, face, width, height, setups[0],
+                                                triangles[0], thread_stats);
+                continue;
+            }
+            if (!inside) {
+                RENDERER_STATS_ADD(thread_stats, offscreen, 1);
+                continue;
+            }
+            // 近平面裁剪, 保持绕序, 得到 3 或 4 个顶点的凸多边形
+            ClipVertex<N> out[4];
+            int count = 0;
+            for (int j = 0; j < 3; ++j) {
+                const int k = (j + 1) % 3;
+                if (distance[j] >= 0) out[count++] = in[j];
+                if ((distance[j] >= 0) != (distance[k] >= 0))
+                    out[count++] = pipeline_detail::lerp(
+                        in[j], in[k], distance[j] / (distance[j] - distance[k]));
+            }
+            for (int t = 0; t + 2 < count; ++t) {
+                const ClipVertex<N> *v[3] = {&out[0], &out[t + 1], &out[t + 2]};
+                pipeline_detail::setup_triangle(v, face, width, height, setups[t],
+                                                triangles[t], thread_stats);
+            }
+        }
+    }
+}
+
+// 光栅化并着色单个三角形, 只处理 [clip_x_min, clip_x_max]x[clip_y_min, clip_y_max] 内的像素
+// 裁剪矩形必须位于帧缓冲内, hierarchical_z 为 true 时先用 Hi-Z 剔除整个三角形
+// 重心坐标为整数边函数除以面积, 深度、1 / w 与 varyings / w 在每行行首由双精度求出,
+// 行内按 q_row + dqdx * dx 求值, 不随像素累积误差
+// 返回做了深度测试的像素个数, stats 不为空时累加通过深度测试的像素个数与每个像素的覆盖次数
+template <typename Shader, PixelFormat Format>
+std::int64_t triangle_rasterize_shaded(const Shader &shader, const TriangleSetup &setup,
+                                       const ShadedTriangle<Shader::varyings> &triangle,
+                                       Framebuffer<Format> &frame_buffer,
+                                       DepthBuffer &depth_buffer, int clip_x_min,
+                                       int clip_y_min, int clip_x_max, int clip_y_max,
+                                       bool hierarchical_z = true,
+                                       ThreadStats *stats = nullptr) {
+    constexpr int N = Shader::varyings;
+    // 插值量: 深度, 1 / w, varyings / w; 没有 varyings 时只插值深度
+    constexpr int M = N > 0 ? N + 2 : 1;
+    FixedPointTriangle fixed;
+    if (!fixed.setup(setup.p0, setup.p1, setup.p2)) return 0;
+    const int x_min = std::max(fixed.x_min, clip_x_min);
+    const int x_max = std::min(fixed.x_max, clip_x_max);
+    const int y_min = std::max(fixed.y_min, clip_y_min);
+    const int y_max = std::min(fixed.y_max, clip_y_max);
+    if (x_min > x_max || y_min > y_max) return 0;
+
+    // 插值得到的深度截断到顶点深度的范围内, Hi-Z 剔除是保守的
+    const float z_lo = std::min(std::min(setup.p0.z, setup.p1.z), setup.p2.z);
+    const float z_hi = std::max(std::max(setup.p0.z, setup.p1.z), setup.p2.z);
+    if (hierarchical_z && depth_buffer.is_occluded(x_min, y_min, x_max, y_max, z_hi))
+        return 0;
+
+    double q[3][M];
+    const float z[3] = {setup.p0.z, setup.p1.z, setup.p2.z};
+    for (int j = 0; j < 3; ++j) {
+        q[j][0] = z[j];
+        if constexpr (N > 0) {
+            q[j][1] = triangle.inv_w[j];
+            for (int k = 0; k < N; ++k) q[j][k + 2] = triangle.varyings[j][k];
+        }
+    }
+    const double inv_area = 1.0 / static_cast<double>(fixed.area);
+    float dqdx[M];
+    for (int m = 0; m < M; ++m) {
+        dqdx[m] = static_cast<float>(
+            (fixed.a[0] * q[0][m] + fixed.a[1] * q[1][m] + fixed.a[2] * q[2][m]) * inv_area);
+    }
+
+    std::int64_t tested = 0;
+    RENDERER_STATS_ONLY(std::int64_t passed = 0;)
+    std::int64_t edge_row[3];
+    for (int i = 0; i < 3; ++i) edge_row[i] = fixed.edge(i, x_min, y_min);
+    for (int y = y_min; y <= y_max; ++y) {
+        float q_row[M];
+        for (int m = 0; m < M; ++m) {
+            q_row[m] = static_cast<float>(
+                (edge_row[0] * q[0][m] + edge_row[1] * q[1][m] + edge_row[2] * q[2][m]) *
+                inv_area);
+        }
+        float *z_row = depth_buffer.row(y);
+        std::uint8_t *color_row = frame_buffer.row(y);
+        RENDERER_STATS_ONLY(std::uint16_t *overdraw_row =
+                                stats && stats->overdraw
+                                    ? stats->overdraw + y * stats->overdraw_width
+                                    : nullptr;)
+        std::int64_t e0 = edge_row[0], e1 = edge_row[1], e2 = edge_row[2];
+        for (int x = x_min; x <= x_max;
+             ++x, e0 += fixed.a[0], e1 += fixed.a[1], e2 += fixed.a[2]) {
+            if ((e0 | e1 | e2) < 0) continue;
+            ++tested;
+            RENDERER_STATS_ONLY(if (overdraw_row) {
+                std::uint16_t &count = overdraw_row[x];
+                count += count != 0xffff;
+            })
+            const float dx = static_cast<float>(x - x_min);
+            const float depth = std::min(z_hi, std::max(z_lo, q_row[0] + dqdx[0] * dx));
+            if (!(depth > z_row[x])) continue;
+            RENDERER_STATS_ONLY(++passed;)
+            z_row[x] = depth;
+            depth_buffer.mark_dirty(x, y);
+            Varyings<N> in;
+            if constexpr (N > 0) {
+                const float w = 1.f / (q_row[1] + dqdx[1] * dx);
+                for (int k = 0; k < N; ++k) in[k] = (q_row[k + 2] + dqdx[k + 2] * dx) * w;
+            }
+            Framebuffer<Format>::store(color_row + x * Framebuffer<Format>::bytespp,
+                                       shader.fragment(triangle.face, in));
+        }
+        for (int i = 0; i < 3; ++i) edge_row[i] += fixed.b[i];
+    }
+    RENDERER_STATS_ADD(stats, pixels_passed, passed);
+    RENDERER_STATS_ADD(stats, pixels_shaded, passed);
+    return tested;
+}
+
+// 用着色器 shader 渲染整个模型: 几何、分块、按 tile 并行光栅化与着色
+// scratch 为空时每次调用临时分配, stats 不为空时记录各阶段耗时与计数
+// hierarchical_z 的含义同 RasterOptions::hierarchical_z
+// 几何阶段的耗时计入 VERTEX, 剔除的计数与 rasterize 相同; 片元着色计入 RASTER
+// 返回做了深度测试的像素个数; 帧缓冲与深度缓冲不会被清除
+template <typename Shader, PixelFormat Format>
+std::int64_t render_pipeline(const Model &model, const Shader &shader,
+                             Framebuffer<Format> &frame_buffer, DepthBuffer &depth_buffer,
+                             PipelineScratch<Shader::varyings> *scratch = nullptr,
+                             FrameStats *stats = nullptr, bool hierarchical_z = true) {
+    const int width = frame_buffer.get_width();
+    const int height = frame_buffer.get_height();
+    PipelineScratch<Shader::varyings> local_scratch;
+    PipelineScratch<Shader::varyings> &s = scratch ? *scratch : local_scratch;
+    {
+        RENDERER_STAGE_TIMER(stats, Stage::VERTEX);
+        pipeline_geometry(model, shader, width, height, s, stats);
+    }
+    {
+        RENDERER_STAGE_TIMER(stats, Stage::SETUP);
+        bin_triangles(s.setups.data(), s.setups.size(), width, height, s.arena, s.bins);
+    }
+
+    const TileBins &bins = s.bins;
+    std::int64_t tested = 0;
+    RENDERER_STAGE_TIMER(stats, Stage::RASTER);
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : tested)
+    for (int tile = 0; tile < bins.num_tiles(); ++tile) {
+        if (bins.empty(tile)) continue;
+        int x_min, y_min, x_max, y_max;
+        bins.tile_rect(tile, width, height, x_min, y_min, x_max, y_max);
+        ThreadStats *thread_stats = nullptr;
+        RENDERER_STATS_ONLY(if (stats) thread_stats = stats->thread(omp_get_thread_num());)
+        std::int64_t tile_tested = 0;
+        for (int k = bins.tile_begin[tile]; k < bins.tile_begin[tile + 1]; ++k) {
+            const int i = bins.triangles[k];
+            tile_tested += triangle_rasterize_shaded(shader, s.setups[i], s.triangles[i],
+                                                     frame_buffer, depth_buffer, x_min, y_min,
+                                                     x_max, y_max, hierarchical_z,
+                                                     thread_stats);
+        }
+        RENDERER_STATS_ADD(thread_stats, pixels_tested, tile_tested);
+        tested += tile_tested;
+    }
+    return tested;
+}
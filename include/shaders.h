@@ -0,0 +1,169 @@
+#pragma once
+
+#include "depth_buffer.h"
+#include "framebuffer.h"
+#include "geometry.h"
+#include "model.h"
+#include "shader_pipeline.h"
+#include "stats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 可编程管线的内置着色器: 平面 (flat)、Gouraud 与 Phong 着色
+// 三者都使用 Blinn-Phong 光照模型, 区别在于光照的求值频率:
+// flat 每个面一次 (面的法线), Gouraud 每个顶点一次再插值, Phong 插值法线后每个像素一次
+
+// 内置着色器的 uniform, 方向与位置都在世界空间
+struct ShaderUniforms {
+    Mat4f model; // 模型变换, 只含旋转、均匀缩放与平移, 法线直接用其 3x3 部分变换
+    Mat4f mvp;   // 投影 * 视图 * 模型
+    Vec3f light = {0.f, 0.f, 1.f};  // 指向光源的单位向量 (平行光)
+    Vec3f eye = {0.f, 0.f, 3.f};    // 相机位置, 用于求高光
+    Vec3f albedo = {1.f, 1.f, 1.f}; // 漫反射颜色, r g b, 范围 [0, 1]
+    float ambient = 0.1f;
+    float specular = 0.4f;
+    float shininess = 32.f;
+};
+
+// Blinn-Phong 光照, normal 为单位法线, position 为世界空间的位置
+inline void blinn_phong(const ShaderUniforms &u, const Vec3f &normal, const Vec3f &position,
+                        float &diffuse, float &specular) {
+    diffuse = u.ambient + std::max(normal * u.light, 0.f);
+    const Vec3f view = (u.eye - position).normalized();
+    const Vec3f half = Vec3f{u.light.x + view.x, u.light.y + view.y, u.light.z + view.z}
+                           .normalized();
+    specular = u.specular * std::pow(std::max(normal * half, 0.f), u.shininess);
+}
+
+// 漫反射颜色乘 diffuse 再加上白色的高光, 各通道截断到 [0, 1] 后打包
+inline PackedPixel shade_color(const Vec3f &albedo, float diffuse, float specular) {
+    auto channel = [&](float c) {
+        return static_cast<std::uint8_t>(std::min(c * diffuse + specular, 1.f) * 255.f + 0.5f);
+    };
+    return pack_pixel(channel(albedo.z), channel(albedo.y), channel(albedo.x));
+}
+
+// 模型空间中面的法线 (未归一化), 逆时针绕序
+inline Vec3f face_normal(const Model &model, int face) {
+    const Vec3f &a = model.vertex(face, 0);
+    return (model.vertex(face, 1) - a).cross(model.vertex(face, 2) - a);
+}
+
+// 面顶点的模型空间法线, 文件中没有给出时使用面的法线
+inline Vec3f vertex_normal(const Model &model, int face, int nth) {
+    const int index = model.normal_index(face, nth);
+    return index >= 0 ? model.normal(index) : face_normal(model, face);
+}
+
+// 平面着色: 每个面的颜色在几何阶段之前由 shade_faces 求出, 片元只按面取颜色, 没有 varyings
+class FlatShader {
+  private:
+    const Model &model_;
+    const ShaderUniforms &uniforms_;
+    const PackedPixel *face_pixels_;
+
+  public:
+    static constexpr int varyings = 0;
+
+    // face_pixels 为 shade_faces 的结果
+    FlatShader(const Model &model, const ShaderUniforms &uniforms,
+               const std::vector<PackedPixel> &face_pixels)
+        : model_(model), uniforms_(uniforms), face_pixels_(face_pixels.data()) {}
+
+    // 在面的重心处用面的法线求光照, 按面并行
+    static void shade_faces(const Model &model, const ShaderUniforms &uniforms,
+                            std::vector<PackedPixel> &out);
+
+    Vec4f vertex(int face, int nth, Varyings<varyings> &) const {
+        return uniforms_.mvp.apply_point(model_.vertex(face, nth));
+    }
+    PackedPixel fragment(int face, const Varyings<varyings> &) const {
+        return face_pixels_[face];
+    }
+};
+
+// Gouraud 着色: 每个顶点求光照, 插值漫反射与高光两项
+class GouraudShader {
+  private:
+    const Model &model_;
+    const ShaderUniforms &uniforms_;
+
+  public:
+    static constexpr int varyings = 2;
+
+    GouraudShader(const Model &model, const ShaderUniforms &uniforms)
+        : model_(model), uniforms_(uniforms) {}
+
+    Vec4f vertex(int face, int nth, Varyings<varyings> &out) const {
+        const Vec3f &p = model_.vertex(face, nth);
+        const Vec4f world = uniforms_.model.apply_point(p);
+        const Vec3f normal =
+            uniforms_.model.apply_direction(vertex_normal(model_, face, nth)).normalized();
+        blinn_phong(uniforms_, normal, Vec3f{world[0], world[1], world[2]}, out[0], out[1]);
+        return uniforms_.mvp.apply_point(p);
+    }
+    PackedPixel fragment(int, const Varyings<varyings> &in) const {
+        return shade_color(uniforms_.albedo, in[0], in[1]);
+    }
+};
+
+// Phong 着色: 插值世界空间的法线与位置, 每个像素求光照
+class PhongShader {
+  private:
+    const Model &model_;
+    const ShaderUniforms &uniforms_;
+
+  public:
+    static constexpr int varyings = 6; // 法线 xyz, 位置 xyz
+
+    PhongShader(const Model &model, const ShaderUniforms &uniforms)
+        : model_(model), uniforms_(uniforms) {}
+
+    Vec4f vertex(int face, int nth, Varyings<varyings> &out) const {
+        const Vec3f &p = model_.vertex(face, nth);
+        const Vec4f world = uniforms_.model.apply_point(p);
+        const Vec3f normal = uniforms_.model.apply_direction(vertex_normal(model_, face, nth));
+        for (int i = 0; i < 3; ++i) {
+            out[i] = normal[i];
+            out[i + 3] = world[i];
+        }
+        return uniforms_.mvp.apply_point(p);
+    }
+    PackedPixel fragment(int, const Varyings<varyings> &in) const {
+        const Vec3f normal = Vec3f{in[0], in[1], in[2]}.normalized();
+        float diffuse, specular;
+        blinn_phong(uniforms_, normal, Vec3f{in[3], in[4], in[5]}, diffuse, specular);
+        return shade_color(uniforms_.albedo, diffuse, specular);
+    }
+};
+
+enum class ShaderKind { FLAT, GOURAUD, PHONG };
+const char *shader_name(ShaderKind shader);
+// 解析 "flat" / "gouraud" / "phong", 失败返回 false
+bool parse_shader(const std::string &name, ShaderKind &shader);
+
+// render_shaded 的中间结果, 每种着色器一份, 多帧渲染时复用
+struct ShadedScratch {
+    PipelineScratch<FlatShader::varyings> flat;
+    PipelineScratch<GouraudShader::varyings> gouraud;
+    PipelineScratch<PhongShader::varyings> phong;
+    std::vector<PackedPixel> face_pixels;
+
+    // shader 所用的 Arena
+    const FrameArena &arena(ShaderKind shader) const {
+        return shader == ShaderKind::FLAT      ? flat.arena
+               : shader == ShaderKind::GOURAUD ? gouraud.arena
+                                               : phong.arena;
+    }
+};
+
+// 用内置着色器渲染整个模型, 按 shader 选择 render_pipeline 的实例
+// 参数与返回值的含义同 render_pipeline, 支持 PixelFormat 的全部三种格式, 在 shaders.cpp 中显式实例化
+template <PixelFormat Format>
+std::int64_t render_shaded(const Model &model, ShaderKind shader,
+                           const ShaderUniforms &uniforms, Framebuffer<Format> &frame_buffer,
+                           DepthBuffer &depth_buffer, ShadedScratch *scratch = nullptr,
+                           FrameStats *stats = nullptr, bool hierarchical_z = true);
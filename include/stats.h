@@ -0,0 +1,118 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// 流水线统计: 各阶段耗时、三角形与像素计数、overdraw 直方图, 以 JSON 输出
+// 计数先累加到每个线程自己的 ThreadStats, 帧结束时再合并, 线程之间不共享缓存行
+// CMake 选项 RENDERER_STATS 关闭时不定义 RENDERER_ENABLE_STATS,
+// 下面的宏展开为空, 光栅化内循环中不留下任何统计代码
+#ifdef RENDERER_ENABLE_STATS
+constexpr bool stats_compiled = true;
+#define RENDERER_STATS_CONCAT_(a, b) a##b
+#define RENDERER_STATS_CONCAT(a, b) RENDERER_STATS_CONCAT_(a, b)
+// stats 为空指针时不统计
+#define RENDERER_STATS_ADD(stats, counter, n)                                 \
+    do {                                                                       \
+        if (stats) (stats)->counter += (n);                                    \
+    } while (0)
+// 统计从此处到所在作用域结束的耗时
+#define RENDERER_STAGE_TIMER(stats, stage)                                     \
+    StageTimer RENDERER_STATS_CONCAT(stage_timer_, __LINE__)(stats, stage)
+#define RENDERER_STATS_ONLY(...) __VA_ARGS__
+#else
+constexpr bool stats_compiled = false;
+#define RENDERER_STATS_ADD(stats, counter, n) ((void)0)
+#define RENDERER_STAGE_TIMER(stats, stage) ((void)0)
+#define RENDERER_STATS_ONLY(...)
+#endif
+
+// 流水线阶段
+// CULL 为簇剔除与逐面的背面 / 退化 / 屏幕外剔除, SETUP 为把三角形分到各 tile
+// 深度测试与覆盖测试在同一个内循环中完成, 其耗时计入 RASTER;
+// SHADE 为可见性缓冲模式下按面的编号给可见像素着色, 直接写颜色时着色计入 RASTER
+// DEPTH 只统计深度缓冲的清空
+enum class Stage { LOAD, VERTEX, CULL, SETUP, RASTER, SHADE, DEPTH, WRITE, COUNT };
+const char *stage_name(Stage stage);
+
+// 三角形按屏幕大小的分类, 各类的含义与遍历方式见 edge_rasterizer.h
+enum class TriangleClass { EMPTY, TINY, MEDIUM, LARGE, COUNT };
+constexpr int triangle_classes = static_cast<int>(TriangleClass::COUNT);
+const char *triangle_class_name(TriangleClass triangle_class);
+
+// overdraw 直方图的桶数, 第 i 个桶为被 i 个片元覆盖的像素个数, 最后一个桶包含更多的
+constexpr int overdraw_buckets = 16;
+
+// 单个线程的计数, 对齐到缓存行避免伪共享
+struct alignas(64) ThreadStats {
+    std::int64_t backface = 0;      // 背面剔除的三角形
+    std::int64_t degenerate = 0;    // 面积接近 0 的三角形
+    std::int64_t offscreen = 0;     // 完全位于屏幕外的三角形
+    // 随所在的簇整簇剔除的三角形, 不再计入上面三项
+    std::int64_t cluster_backface = 0;
+    std::int64_t cluster_offscreen = 0;
+    std::int64_t pixels_tested = 0; // 做了深度测试的片元
+    std::int64_t pixels_passed = 0; // 通过深度测试的片元
+    // 着色的片元: 直接写颜色时等于 pixels_passed, 可见性缓冲模式下为可见像素个数
+    std::int64_t pixels_shaded = 0;
+    // 各大小分类的三角形个数与做了深度测试的片元个数, 下标为 TriangleClass
+    // 分类在每个 tile 内进行, 跨多个 tile 的三角形在每个 tile 中各计一次
+    std::int64_t class_triangles[triangle_classes] = {};
+    std::int64_t class_pixels[triangle_classes] = {};
+    // 每个像素被覆盖的次数, 宽度为 overdraw_width, 所有线程共用
+    // 每个 tile 只由一个线程光栅化, 所以写入不会冲突
+    std::uint16_t *overdraw = nullptr;
+    int overdraw_width = 0;
+};
+
+class FrameStats {
+  private:
+    int width_ = 0, height_ = 0;
+    double stage_ms_[static_cast<int>(Stage::COUNT)] = {};
+    std::int64_t triangles_ = 0;
+    std::vector<ThreadStats> threads_ = {};
+    std::vector<std::uint16_t> overdraw_ = {};
+
+  public:
+    // 开始新的一帧, 清空所有计数, 按当前 OpenMP 线程数准备线程计数
+    void begin_frame(const int width, const int height);
+
+    void add_stage_time(Stage stage, double ms) {
+        stage_ms_[static_cast<int>(stage)] += ms;
+    }
+    void add_triangles(std::int64_t count) { triangles_ += count; }
+    // 第 thread 个 OpenMP 线程的计数
+    ThreadStats *thread(int thread) { return &threads_[thread]; }
+
+    // 合并所有线程的计数
+    ThreadStats total() const;
+    void write_json(std::ostream &out) const;
+};
+
+// 作用域计时器, 析构时把耗时累加到对应的阶段
+class StageTimer {
+  private:
+    FrameStats *stats_;
+    Stage stage_;
+    std::chrono::steady_clock::time_point start_;
+
+  public:
+    StageTimer(FrameStats *stats, Stage stage)
+        : stats_(stats), stage_(stage),
+          start_(stats ? std::chrono::steady_clock::now()
+                       : std::chrono::steady_clock::time_point{}) {}
+    ~StageTimer() {
+        if (!stats_) return;
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start_;
+        stats_->add_stage_time(stage_, elapsed.count());
+    }
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+};
+
+// 进程的峰值常驻内存 (字节), 无论是否编译统计都可用; 平台不支持时返回 0
+// 用于对比流式渲染与整个模型加载到内存的内存占用
+std::int64_t peak_resident_bytes();
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "edge_rasterizer.h"
+#include "framebuffer.h"
+#include "tga_image.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 纹理: 加载时转换为 32 位 BGRA, 并预先生成完整的 mip 链
+// 每一级按 4x4 纹素的块存放, 块按行优先排列, 块内 16 个纹素按 Morton (Z) 顺序排列
+// 一个块正好 64 字节 (一条缓存行), 双线性采样的 2x2 纹素大多落在同一条缓存行内,
+// 三角形以任意角度遍历纹理时, 相邻像素取到的纹素也集中在少数几条缓存行中
+// 宽高必须是 2 的幂, 纹理坐标超出 [0, 1] 时重复 (wrap) 只需按位与
+// 纹理坐标 (u, v) 的原点在图像左下角, 与 OBJ 的 vt 一致
+class Texture {
+  public:
+    static constexpr int tile_size = 4;
+
+    // 一级 mip, offset 为第一个纹素在纹素数组中的下标
+    struct Level {
+        int width = 0, height = 0;
+        int tile_shift = 0; // 每行块数的以 2 为底的对数
+        std::size_t offset = 0;
+    };
+
+  private:
+    std::vector<Level> levels_ = {};
+    // 按级连续存放, 多分配 15 个纹素, 使 base_ 开始的纹素 64 字节对齐
+    std::vector<PackedPixel> storage_ = {};
+    std::size_t base_ = 0;
+
+    const PackedPixel *texels(const Level &level) const {
+        return storage_.data() + base_ + level.offset;
+    }
+
+  public:
+    Texture() = default;
+
+    // 由图像生成, 接受灰度 / 24 位 / 32 位图像, 灰度图展开为 r = g = b
+    // 宽高不是 2 的幂时输出错误信息并返回 false, 原有内容清空
+    bool build(const TgaImage &image);
+    // 用 TgaImage::read_tga_file 读入后调用 build
+    bool load(const std::string &filename);
+
+    bool empty() const { return levels_.empty(); }
+    int get_width() const { return empty() ? 0 : levels_[0].width; }
+    int get_height() const { return empty() ? 0 : levels_[0].height; }
+    int num_levels() const { return levels_.size(); }
+    const Level &level(int level) const { return levels_[level]; }
+
+    // 第 level 级的纹素 (x, y), 不做边界检查, y = 0 为最下方一行
+    PackedPixel texel(int level, int x, int y) const;
+
+    // 由纹理坐标对屏幕 x / y 的导数选择 mip 级别
+    // 取两个方向上覆盖的纹素个数较大者, 对数四舍五入后截断到 [0, num_levels() - 1]
+    int select_level(float dudx, float dvdx, float dudy, float dvdy) const;
+
+    // 第 level 级的双线性采样
+    PackedPixel sample(float u, float v, int level) const;
+    // 对 count 个坐标在同一级采样, 结果写入 out
+    // path 为 AVX2 / SSE 时每次处理 8 / 4 个坐标, 其余 (以及 SCALAR / BARYCENTRIC) 逐个处理
+    // 各路径的计算顺序相同, 结果逐位一致
+    void sample(const float *u, const float *v, int count, int level, PackedPixel *out,
+                RasterPath path) const;
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "framebuffer.h"
+#include <cstddef>
 #include <cstdint>
 #include <string>
 #include <vector>
@@ -53,34 +55,81 @@ inline bool operator!=(const TgaColor &lhs, const TgaColor &rhs) {
     return !(lhs == rhs);
 }
 
+// 转换为帧缓冲使用的打包像素
+inline PackedPixel pack_color(const TgaColor &color) {
+    return pack_pixel(color[0], color[1], color[2], color[3]);
+}
+
+// TGA 图像的读写
+// 像素可以由自身持有, 也可以引用外部的像素 (例如用 wrap 包装的帧缓冲),
+// 引用外部像素时不做拷贝, 复制 TgaImage 也只复制引用, 调用方保证外部像素的生命周期
+//
+// 像素按内存中的行存取, get_pixel / set_pixel 的 y 即内存中的第 y 行
+// 行序记录第 0 行是图像的最下方还是最上方一行, 读写文件时与文件头的
+// image_descriptor 第 5 位 (0x20) 相互转换, 不移动像素
+// 新建与包装的图像默认自下而上, 与 TGA 默认的原点 (左下角) 和光栅化的 y 轴方向一致
 class TgaImage {
   private:
     int width_ = 0, height_ = 0;
     std::uint8_t bytespp_ = 0;
     std::vector<std::uint8_t> data_ = {};
-
-    bool load_rle_data(std::ifstream &in);
-    bool save_rle_data(std::ofstream &out) const;
+    std::uint8_t *view_ = nullptr; // 不为空时像素位于外部内存
+    bool bottom_up_ = true;        // 第 0 行是否为最下方一行
 
   public:
     enum Format { GRAYSCALE = 1, RGB = 3, RGBA = 4 };
 
     TgaImage() = default;
     TgaImage(const int width, const int height, const int bytespp);
+    // 引用外部的 width * height * bytespp 字节像素, 不拷贝
+    TgaImage(std::uint8_t *data, const int width, const int height,
+             const int bytespp);
+    // 包装帧缓冲, 不拷贝像素
+    template <PixelFormat Format>
+    static TgaImage wrap(Framebuffer<Format> &frame_buffer) {
+        return TgaImage(frame_buffer.data(), frame_buffer.get_width(),
+                        frame_buffer.get_height(), Framebuffer<Format>::bytespp);
+    }
 
     int get_width() const { return width_; }
     int get_height() const { return height_; }
+    int get_bytespp() const { return bytespp_; }
+    // 像素数据, 行优先, 每行 width * bytespp 字节
+    std::uint8_t *data() { return view_ ? view_ : data_.data(); }
+    const std::uint8_t *data() const { return view_ ? view_ : data_.data(); }
+    // 第 y 行的起始地址
+    std::uint8_t *row(int y) {
+        return data() + static_cast<std::size_t>(y) * width_ * bytespp_;
+    }
+    const std::uint8_t *row(int y) const {
+        return data() + static_cast<std::size_t>(y) * width_ * bytespp_;
+    }
+
+    bool is_bottom_up() const { return bottom_up_; }
+    // 只修改行序的标记, 不移动像素
+    void set_bottom_up(bool bottom_up) { bottom_up_ = bottom_up; }
 
     TgaColor get_pixel(const int x, const int y) const;
     bool set_pixel(int x, int y, const TgaColor &tga_color);
 
+    // 文件整体映射到内存后解析, 行程编码的数据直接从映射的内存解码
+    // 像素按文件中的行序存放, 行序由 image_descriptor 决定, 不做上下翻转
+    // 原点在右侧的文件 (很少见) 读入后左右翻转
     bool read_tga_file(const std::string &filename);
+    // 文件头与像素先写到内存缓冲区, 再一次写入文件
+    // image_descriptor 按行序写出, 像素按内存中的顺序写出
+    // 行程编码时各扫描线分别编码, 包不跨越扫描线
+    // is_v_flip 已废弃, 不起作用, 行序由 set_bottom_up 决定; 保留在原来的位置,
+    // 旧代码按位置传入的 is_v_flip 不会被当作 is_rle
     bool write_tga_file(const std::string &filename,
                         const bool is_v_flip = true,
                         const bool is_rle = true) const;
+    // 同上, 行程编码使用调用方的缓冲区, 连续写出多帧时复用, 容量足够时不分配内存
+    bool write_tga_file(const std::string &filename, const bool is_rle,
+                        std::vector<std::uint8_t> &buffer) const;
 
-    // flip horizontally image data
+    // 左右翻转像素, 参见 image_transform.h
     bool flip_horizontally();
-    // flip vertically image data
+    // 上下翻转像素, 行序的标记不变
     bool flip_vertically();
 };
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// TGA 行程编码 (RLE) 的编解码, 只支持 1 / 3 / 4 字节的像素
+// 包头最高位为 1 时是重复包: 低 7 位 + 1 个相同像素, 后跟 1 个像素
+// 最高位为 0 时是原始包: 低 7 位 + 1 个像素原样跟在包头后
+//
+// 编码时包不跨越扫描线 (TGA 2.0 规范的要求), 因此各行可以独立编码:
+// 大图按行带并行编码到预先分配的缓冲区, 再按顺序拼接
+// 查找重复 / 不重复的像素时每次用 SSE2 比较 16 个字节 (16 / 5 / 4 个像素)
+// 解码兼容跨越扫描线的包 (旧版编码器写出的文件)
+
+// 编码 width x height 的图像最多需要的字节数
+std::size_t tga_rle_bound(int width, int height, int bytespp);
+
+// 编码行优先存放的像素到 out, out 至少有 tga_rle_bound 个字节
+// 返回写入的字节数, bytespp 不支持时返回 0
+std::size_t tga_rle_encode(const std::uint8_t *pixels, int width, int height,
+                           int bytespp, std::uint8_t *out);
+
+// 从 [in, in + size) 解码 npixels 个像素到 pixels
+// 返回读取的字节数, 数据不完整、像素过多或 bytespp 不支持时返回 0
+std::size_t tga_rle_decode(const std::uint8_t *in, std::size_t size,
+                           std::size_t npixels, int bytespp,
+                           std::uint8_t *pixels);
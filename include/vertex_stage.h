@@ -0,0 +1,31 @@
+#pragma once
+
+#include "frame_arena.h"
+#include "geometry.h"
+#include "model.h"
+
+// 顶点阶段的输出: 变换到屏幕空间的顶点, SoA 布局, 内存来自帧的 Arena
+// 每个顶点每帧只变换一次, 三角形阶段按面的顶点索引直接取用
+struct TransformedVertices {
+    ArenaArray<float> x, y, z;
+
+    int size() const { return x.size(); }
+    void allocate(Arena &arena, int n) {
+        x.allocate(arena, n);
+        y.allocate(arena, n);
+        z.allocate(arena, n);
+    }
+    Vec3f operator[](int index) const { return {x[index], y[index], z[index]}; }
+};
+
+// 对模型的全部顶点做视口变换, 结果与逐个调用 viewport_trans 逐位一致
+// transform 不为空时先做该仿射变换, 结果与 viewport_trans(transform->apply(v)) 逐位一致
+// 以 SSE 每次处理 4 个顶点, 顶点多时按区间多线程并行
+// out 从 arena 分配, 之前的内容失效
+void transform_vertices(const Model &model, const int width, const int height, Arena &arena,
+                        TransformedVertices &out,
+                        const Affine3f *transform = nullptr);
+// 同上, 变换 positions 中的 count 个顶点, 用于不在 Model 中的顶点 (例如流式读取的网格块)
+void transform_vertices(const Vec3f *positions, int count, const int width, const int height,
+                        Arena &arena, TransformedVertices &out,
+                        const Affine3f *transform = nullptr);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "frame_arena.h"
+#include "framebuffer.h"
+#include "geometry.h"
+#include "model.h"
+#include "vertex_stage.h"
+#include <cstdint>
+#include <vector>
+
+// 线框渲染
+// 1. 从面列表中取出去重后的边, 相邻面共享的边只画一次 (每个模型只需取一次)
+// 2. 顶点阶段与 rasterize 相同, 屏幕坐标四舍五入为像素坐标
+// 3. 屏幕按行分带, 边按 y 范围分到各带, 各带并行画线, 每条线只画带内的行
+// 画线使用 line_draw 的裁剪版本, 结果与逐条边调用 line_draw 逐像素一致
+
+// 边的两个顶点索引, a < b
+struct Edge {
+    int a, b;
+};
+
+// 取出模型中去重后的边, 按 (a, b) 排序
+void extract_edges(const Model &model, std::vector<Edge> &edges);
+
+// 线框渲染的中间结果, 多帧渲染时复用
+// 数组都从 arena 分配, 每次调用 wireframe_rasterize 开始时复位, 用量稳定后不再分配内存
+struct WireframeScratch {
+    Arena arena;
+    TransformedVertices vertices;
+    ArenaArray<int> x, y; // 顶点的像素坐标
+    ArenaArray<int> band_begin, bins;
+};
+
+// 用 color 画出全部边, 返回画出的像素个数 (重叠的像素重复计数)
+// transform 的含义与 RasterOptions::transform 相同, 帧缓冲不会被清除
+template <PixelFormat Format>
+std::int64_t wireframe_rasterize(const Model &model, const std::vector<Edge> &edges,
+                                 Framebuffer<Format> &frame_buffer, PackedPixel color,
+                                 const Affine3f *transform = nullptr,
+                                 WireframeScratch *scratch = nullptr);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 常驻的工作线程池, 任务调度使用工作窃取 (work stealing)
+// 每个工作线程有自己的任务队列, 从队首取任务; 自己的队列空了就从其他线程的队尾窃取,
+// 大小差别很大的任务也能在各线程间保持均衡
+// 线程在构造时创建, 在多次 run 之间保持, 析构时退出
+class WorkPool {
+  public:
+    // 参数为任务编号与执行它的工作线程编号 [0, size())
+    using Task = std::function<void(int task, int worker)>;
+
+  private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> threads_;
+    const Task *task_ = nullptr;
+    unsigned generation_ = 0; // 每提交一批加 1, 用于唤醒工作线程
+    int idle_workers_ = 0;    // 本批中已取不到任务的线程数, 等于线程数时本批完成
+    bool stopping_ = false;
+    std::mutex mutex_;
+    std::condition_variable batch_started_;
+    std::condition_variable batch_finished_;
+
+    void work(int worker);
+    // 先取自己队列的队首, 再依次窃取其他队列的队尾, 都为空时返回 false
+    bool next_task(int worker, int &task);
+
+  public:
+    // threads 不大于 0 时使用硬件线程数
+    // init 在每个工作线程启动时调用一次, 例如设置线程内的 OpenMP 线程数
+    explicit WorkPool(int threads = 0, const std::function<void(int worker)> &init = {});
+    ~WorkPool();
+    WorkPool(const WorkPool &) = delete;
+    WorkPool &operator=(const WorkPool &) = delete;
+
+    int size() const { return threads_.size(); }
+
+    // 执行任务 [0, count) 并等待全部完成
+    // 任务按顺序轮流分给各线程的队列, 调用方可以把耗时长的任务排在前面
+    // 不能从工作线程内调用
+    void run(int count, const Task &task);
+};
@@ -0,0 +1,74 @@
+#include "animation.h"
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+constexpr float pi = 3.14159265358979f;
+constexpr float degree = pi / 180.f;
+} // namespace
+
+void turntable(int frames, float scale, std::vector<Affine3f> &out) {
+    out.resize(frames);
+    for (int i = 0; i < frames; ++i) {
+        out[i] = Affine3f::scale(scale) * Affine3f::rotation_y(2.f * pi * i / frames);
+    }
+}
+
+bool read_camera_path(const std::string &filename, std::vector<Affine3f> &out) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open " << filename << ".\n";
+        return false;
+    }
+
+    out.clear();
+    std::string line;
+    for (int line_number = 1; std::getline(in, line); ++line_number) {
+        std::istringstream iss(line);
+        char first = 0;
+        if (!(iss >> first) || first == '#') continue;
+        iss.putback(first);
+
+        float yaw = 0, pitch = 0, roll = 0, scale = 1;
+        // scale 可以省略, 但给出时必须是数, 之后不能再有其它内容
+        if (!(iss >> yaw >> pitch >> roll) ||
+            (!(iss >> std::ws).eof() && !(iss >> scale)) || !(iss >> std::ws).eof()) {
+            std::cerr << filename << ":" << line_number
+                      << ": expected \"yaw pitch roll [scale]\"\n";
+            return false;
+        }
+        // 相机的朝向为 Ry(yaw) * Rx(pitch) * Rz(roll), 模型的变换为其逆
+        out.push_back(Affine3f::scale(scale) * Affine3f::rotation_z(-roll * degree) *
+                      Affine3f::rotation_x(-pitch * degree) *
+                      Affine3f::rotation_y(-yaw * degree));
+    }
+    if (out.empty()) {
+        std::cerr << filename << " contains no frames.\n";
+        return false;
+    }
+    return true;
+}
+
+bool is_frame_pattern(const std::string &pattern) {
+    int conversions = 0;
+    for (std::size_t i = 0; i < pattern.size(); ++i) {
+        if (pattern[i] != '%') continue;
+        if (++i < pattern.size() && pattern[i] == '%') continue;
+        // 只允许标志 0 与宽度
+        while (i < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[i])))
+            ++i;
+        if (i == pattern.size() || pattern[i] != 'd') return false;
+        ++conversions;
+    }
+    return conversions == 1;
+}
+
+void format_frame_name(const std::string &pattern, int index, std::string &out) {
+    char name[4096];
+    std::snprintf(name, sizeof(name), pattern.c_str(), index);
+    out.assign(name);
+}
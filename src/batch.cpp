@@ -0,0 +1,121 @@
+#include "batch.h"
+#include "model.h"
+#include "tga_image.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <omp.h>
+#include <sstream>
+
+bool read_batch_manifest(const std::string &filename, std::vector<BatchJob> &jobs) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open " << filename << ".\n";
+        return false;
+    }
+
+    jobs.clear();
+    std::string line;
+    for (int line_number = 1; std::getline(in, line); ++line_number) {
+        std::istringstream iss(line);
+        std::string size;
+        BatchJob job;
+        if (!(iss >> job.model) || job.model[0] == '#') continue;
+        if (!(iss >> size >> job.output) ||
+            std::sscanf(size.c_str(), "%dx%d", &job.width, &job.height) != 2 ||
+            !valid_frame_size(job.width, job.height)) {
+            std::cerr << filename << ":" << line_number
+                      << ": expected \"model WxH output.tga\"\n";
+            return false;
+        }
+        jobs.push_back(std::move(job));
+    }
+    return true;
+}
+
+std::unique_ptr<RenderBuffers> BufferPool::acquire(int width, int height) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &free = free_[{width, height}];
+        if (!free.empty()) {
+            auto buffers = std::move(free.back());
+            free.pop_back();
+            return buffers;
+        }
+    }
+    auto buffers = std::make_unique<RenderBuffers>();
+    buffers->frame = Framebuffer<PixelFormat::RGB>(width, height);
+    buffers->depth = DepthBuffer(width, height);
+    return buffers;
+}
+
+void BufferPool::release(std::unique_ptr<RenderBuffers> buffers) {
+    const std::pair<int, int> size = {buffers->frame.get_width(),
+                                      buffers->frame.get_height()};
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_[size].push_back(std::move(buffers));
+}
+
+BatchRenderer::BatchRenderer(int threads)
+    : pool_(threads, [](int) { omp_set_num_threads(1); }) {}
+
+BatchResult BatchRenderer::render(const std::vector<BatchJob> &jobs,
+                                  const RasterOptions &options) {
+    const auto start = std::chrono::steady_clock::now();
+
+    // 以模型文件大小估计耗时, 大的排在前面先开始, 小的留到最后填补空闲
+    const int n = jobs.size();
+    std::vector<std::uintmax_t> cost(n, 0);
+    for (int i = 0; i < n; ++i) {
+        std::error_code ec;
+        const std::uintmax_t size = std::filesystem::file_size(jobs[i].model, ec);
+        cost[i] = ec ? 0 : size;
+    }
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](int a, int b) { return cost[a] > cost[b]; });
+
+    RasterOptions job_options = options;
+    job_options.stats = nullptr;
+    job_options.transform = nullptr;
+    job_options.meshlets = nullptr;
+    job_options.texture = nullptr;
+    job_options.msaa = nullptr;
+    job_options.path = select_raster_path(options.path);
+
+    std::atomic<int> failed{0};
+    pool_.run(n, [&](int task, int) {
+        const BatchJob &job = jobs[order[task]];
+        Model model(job.model);
+        if (!model.num_faces()) {
+            std::cerr << "Skipping " << job.model << ": no faces loaded\n";
+            ++failed;
+            return;
+        }
+
+        auto buffers = buffers_.acquire(job.width, job.height);
+        buffers->frame.clear();
+        buffers->depth.clear();
+        RasterOptions raster_options = job_options;
+        raster_options.scratch = &buffers->scratch;
+        rasterize(model, buffers->frame, buffers->depth, raster_options);
+        if (!TgaImage::wrap(buffers->frame)
+                 .write_tga_file(job.output, true, buffers->encode_buffer))
+            ++failed;
+        buffers_.release(std::move(buffers));
+    });
+
+    BatchResult result;
+    result.failed = failed;
+    result.succeeded = n - result.failed;
+    result.ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    return result;
+}
@@ -0,0 +1,101 @@
+#include "depth_buffer.h"
+#include <algorithm>
+
+DepthBuffer::DepthBuffer(const int width, const int height)
+    : width_(width), height_(height),
+      blocks_x_((width + block_size - 1) / block_size),
+      blocks_y_((height + block_size - 1) / block_size),
+      coarse_x_((width + coarse_size - 1) / coarse_size),
+      coarse_y_((height + coarse_size - 1) / coarse_size),
+      data_(static_cast<std::size_t>(width) * height, 0.f), block_min_(blocks_x_ * blocks_y_, 0.f),
+      coarse_min_(coarse_x_ * coarse_y_, 0.f),
+      block_dirty_(blocks_x_ * blocks_y_, 0),
+      coarse_dirty_(coarse_x_ * coarse_y_, 0) {}
+
+void DepthBuffer::clear(float depth) {
+    std::fill(data_.begin(), data_.end(), depth);
+    std::fill(block_min_.begin(), block_min_.end(), depth);
+    std::fill(coarse_min_.begin(), coarse_min_.end(), depth);
+    std::fill(block_dirty_.begin(), block_dirty_.end(), 0);
+    std::fill(coarse_dirty_.begin(), coarse_dirty_.end(), 0);
+}
+
+void DepthBuffer::mark_dirty(int x, int y) {
+    block_dirty_[y / block_size * blocks_x_ + x / block_size] = 1;
+    coarse_dirty_[y / coarse_size * coarse_x_ + x / coarse_size] = 1;
+}
+
+void DepthBuffer::refresh_block(int block_index) {
+    const int x0 = block_index % blocks_x_ * block_size;
+    const int y0 = block_index / blocks_x_ * block_size;
+    const int x1 = std::min(x0 + block_size, width_);
+    const int y1 = std::min(y0 + block_size, height_);
+
+    float result = row(y0)[x0];
+    for (int y = y0; y < y1; ++y) {
+        const float *r = row(y);
+        for (int x = x0; x < x1; ++x) result = std::min(result, r[x]);
+    }
+    block_min_[block_index] = result;
+    block_dirty_[block_index] = 0;
+}
+
+void DepthBuffer::refresh_coarse(int coarse_index) {
+    const int bx0 = coarse_index % coarse_x_ * block_size;
+    const int by0 = coarse_index / coarse_x_ * block_size;
+    const int bx1 = std::min(bx0 + block_size, blocks_x_);
+    const int by1 = std::min(by0 + block_size, blocks_y_);
+
+    float result = block_min(bx0, by0);
+    for (int by = by0; by < by1; ++by) {
+        for (int bx = bx0; bx < bx1; ++bx)
+            result = std::min(result, block_min(bx, by));
+    }
+    coarse_min_[coarse_index] = result;
+    coarse_dirty_[coarse_index] = 0;
+}
+
+float DepthBuffer::block_min(int block_x, int block_y) {
+    const int index = block_y * blocks_x_ + block_x;
+    if (block_dirty_[index]) refresh_block(index);
+    return block_min_[index];
+}
+
+bool DepthBuffer::is_occluded(int x_min, int y_min, int x_max, int y_max,
+                              float z_max) {
+    bool occluded = true;
+    for (int cy = y_min / coarse_size; occluded && cy <= y_max / coarse_size;
+         ++cy) {
+        for (int cx = x_min / coarse_size; occluded && cx <= x_max / coarse_size;
+             ++cx) {
+            const int index = cy * coarse_x_ + cx;
+            if (coarse_dirty_[index]) refresh_coarse(index);
+            occluded = z_max <= coarse_min_[index];
+        }
+    }
+    if (occluded) return true;
+
+    for (int by = y_min / block_size; by <= y_max / block_size; ++by) {
+        for (int bx = x_min / block_size; bx <= x_max / block_size; ++bx) {
+            if (z_max > block_min(bx, by)) return false;
+        }
+    }
+    return true;
+}
+
+void DepthBuffer::to_grayscale(std::uint8_t *pixels) const {
+    for (std::size_t i = 0; i < data_.size(); ++i) {
+        float z = std::min(std::max(data_[i], 0.f), 1.f);
+        pixels[i] = static_cast<std::uint8_t>(z * 255.f);
+    }
+}
+
+TgaImage DepthBuffer::to_tga_image() const {
+    TgaImage image(width_, height_, TgaImage::GRAYSCALE);
+    to_grayscale(image.data());
+    return image;
+}
+
+bool DepthBuffer::write_tga_file(const std::string &filename) const {
+    return to_tga_image().write_tga_file(filename);
+}
@@ -0,0 +1,595 @@
+#include "edge_rasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RENDERER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 顶点坐标的截断范围, 单位为像素
+// 保证边函数的 x 方向步进不超过 2^26, 一个 Hi-Z 块宽的 span 内整数边函数用 32 位表示不会溢出
+constexpr float coordinate_limit = 1 << 17;
+// 传给 span 的整数边函数截断到 [-edge_limit, edge_limit]
+// span 不超过 block_size 个像素, 截断前后边函数在 span 内的符号不变
+constexpr std::int64_t edge_limit = std::int64_t(1) << 30;
+static_assert((std::int64_t(2) << (17 + subpixel_bits)) * subpixel_scale *
+                          DepthBuffer::block_size + edge_limit <
+                  (std::int64_t(1) << 31),
+              "span edge functions must fit in 32 bits");
+
+// 四舍五入到 1/16 像素, NaN 按下界处理
+std::int64_t to_fixed(float v) {
+    if (!(v >= -coordinate_limit)) v = -coordinate_limit;
+    v = std::min(v, coordinate_limit);
+    return static_cast<std::int64_t>(std::floor(v * subpixel_scale + 0.5f));
+}
+
+// 一个三角形的光栅化参数
+// 覆盖判断使用 FixedPointTriangle 的整数边函数, 每向右一个像素加 edge_step_i
+// 深度按平面方程 z_start + dzdx * dx 插值, 再截断到顶点深度的范围 [z_lo, z_hi]
+struct SpanSetup {
+    std::int32_t edge_step[3];
+    // edge_step_i * k, k = 0..7, SIMD 路径中各通道相对 span 起点的偏移
+    alignas(32) std::int32_t edge_lanes[3][8];
+    float dzdx;
+    float z_lo, z_hi;
+    PackedPixel color;
+};
+
+// 一个 Hi-Z 块内连续 rows 行的 span, 每行都处理 [begin, end) 范围内的像素
+// 第 r 行: 行首像素的深度为 z_start[r], 像素 begin 的整数边函数为 edge[r],
+// 深度与颜色的行首指针为 z_row + r * z_stride 与 color_row + r * color_stride
+struct SpanRows {
+    int rows, begin, end;
+    const float *z_start;
+    const std::int32_t (*edge)[3];
+    float *z_row;
+    std::uint8_t *color_row;
+    int z_stride, color_stride;
+};
+
+// span 的统计输出, 只在编译了统计时更新
+// overdraw_row 指向第一行行首像素的覆盖次数, 为空时不统计
+struct SpanStats {
+    std::int64_t passed = 0;
+    std::uint16_t *overdraw_row = nullptr;
+    int overdraw_stride = 0;
+};
+
+// 覆盖次数加 1, 达到上限后不再增加
+inline void count_overdraw(std::uint16_t &count) { count += count != 0xffff; }
+
+// 覆盖判断: 三个整数边函数均非负 (符号位的或为 0) 时覆盖
+// 为保证各路径逐像素一致, 所有路径对每个覆盖的像素都按相同的顺序计算深度:
+// z = min(max(z_start + dzdx * dx, z_lo), z_hi)
+// 其中 z_start 为该行第一个像素的深度, dx 为像素相对行首的偏移
+// 每像素字节数 Bytespp 为模板参数, 写颜色编译为定长存储
+// Full 为 true 时调用方已确认 [begin, end) 内的像素全部被覆盖, 不再计算边函数
+// 一次处理整个块, 每个三角形的常量只在块开始时载入一次
+// 返回做了深度测试的像素个数
+using SpanFunction = std::int64_t (*)(const SpanSetup &setup,
+                                      const SpanRows &rows, SpanStats &stats);
+
+template <int Bytespp, bool Full>
+std::int64_t span_scalar(const SpanSetup &setup, const SpanRows &rows,
+                         SpanStats &stats) {
+    std::int64_t tested = 0;
+    for (int r = 0; r < rows.rows; ++r) {
+        float *z_row = rows.z_row + r * rows.z_stride;
+        std::uint8_t *color_row = rows.color_row + r * rows.color_stride;
+        std::int32_t c0 = rows.edge[r][0], c1 = rows.edge[r][1],
+                     c2 = rows.edge[r][2];
+        for (int i = rows.begin; i < rows.end; ++i, c0 += setup.edge_step[0],
+                 c1 += setup.edge_step[1], c2 += setup.edge_step[2]) {
+            if (!Full && (c0 | c1 | c2) < 0) continue;
+
+            ++tested;
+            RENDERER_STATS_ONLY(if (stats.overdraw_row) count_overdraw(
+                                    stats.overdraw_row[r * stats.overdraw_stride + i]);)
+            const float dx = static_cast<float>(i);
+            // 参数顺序与 _mm_max_ps / _mm_min_ps 的语义一致
+            const float z = std::min(
+                setup.z_hi,
+                std::max(setup.z_lo, rows.z_start[r] + setup.dzdx * dx));
+            if (z > z_row[i]) {
+                RENDERER_STATS_ONLY(++stats.passed;)
+                z_row[i] = z;
+                std::memcpy(color_row + i * Bytespp, &setup.color, Bytespp);
+            }
+        }
+    }
+    return tested;
+}
+
+#ifdef RENDERER_X86
+
+// 把 mask 中置位的像素写入帧缓冲
+template <int Bytespp>
+inline void write_colors(PackedPixel color, int mask, std::uint8_t *color_row) {
+    while (mask) {
+        int lane = __builtin_ctz(mask);
+        mask &= mask - 1;
+        std::memcpy(color_row + lane * Bytespp, &color, Bytespp);
+    }
+}
+
+// mask 中置位的像素覆盖次数加 1
+inline void count_overdraw(int mask, std::uint16_t *overdraw) {
+    while (mask) {
+        count_overdraw(overdraw[__builtin_ctz(mask)]);
+        mask &= mask - 1;
+    }
+}
+
+// 行尾之后的通道不参与判断, 其整数边函数可能回绕, 结果被屏蔽
+template <int Bytespp, bool Full>
+std::int64_t span_sse(const SpanSetup &setup, const SpanRows &rows,
+                      SpanStats &stats) {
+    const __m128 dzdx = _mm_set1_ps(setup.dzdx);
+    const __m128 z_lo = _mm_set1_ps(setup.z_lo);
+    const __m128 z_hi = _mm_set1_ps(setup.z_hi);
+    const __m128i lane_index = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i minus_one = _mm_set1_epi32(-1);
+    const __m128i end = _mm_set1_epi32(rows.end);
+    // edge_lanes 每行 8 个整数, 取前 4 个
+    const __m128i *lanes = reinterpret_cast<const __m128i *>(setup.edge_lanes);
+    const __m128i lanes0 = _mm_load_si128(lanes);
+    const __m128i lanes1 = _mm_load_si128(lanes + 2);
+    const __m128i lanes2 = _mm_load_si128(lanes + 4);
+    const __m128i step0 = _mm_set1_epi32(setup.edge_lanes[0][4]);
+    const __m128i step1 = _mm_set1_epi32(setup.edge_lanes[1][4]);
+    const __m128i step2 = _mm_set1_epi32(setup.edge_lanes[2][4]);
+
+    std::int64_t tested = 0;
+    alignas(16) float z[4];
+    for (int r = 0; r < rows.rows; ++r) {
+        float *z_row = rows.z_row + r * rows.z_stride;
+        std::uint8_t *color_row = rows.color_row + r * rows.color_stride;
+        const __m128 z0 = _mm_set1_ps(rows.z_start[r]);
+        // 每个通道的整数边函数, 每次前进 4 个像素
+        __m128i c0 = _mm_add_epi32(_mm_set1_epi32(rows.edge[r][0]), lanes0);
+        __m128i c1 = _mm_add_epi32(_mm_set1_epi32(rows.edge[r][1]), lanes1);
+        __m128i c2 = _mm_add_epi32(_mm_set1_epi32(rows.edge[r][2]), lanes2);
+        for (int i = rows.begin; i < rows.end; i += 4,
+                 c0 = _mm_add_epi32(c0, step0), c1 = _mm_add_epi32(c1, step1),
+                 c2 = _mm_add_epi32(c2, step2)) {
+            const __m128i index = _mm_add_epi32(_mm_set1_epi32(i), lane_index);
+            // 行尾不足 4 个像素时屏蔽多余的通道
+            const int lanes_left = std::min(rows.end - i, 4);
+            const __m128i valid = _mm_cmplt_epi32(index, end);
+            __m128 inside = _mm_castsi128_ps(valid);
+            if constexpr (!Full) {
+                inside = _mm_castsi128_ps(_mm_and_si128(
+                    _mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(c0, c1), c2), minus_one),
+                    valid));
+            }
+            int inside_mask = _mm_movemask_ps(inside);
+            if (!inside_mask) continue;
+            tested += __builtin_popcount(inside_mask);
+            RENDERER_STATS_ONLY(
+                if (stats.overdraw_row) count_overdraw(
+                    inside_mask,
+                    stats.overdraw_row + r * stats.overdraw_stride + i);)
+
+            const __m128 dx = _mm_cvtepi32_ps(index);
+            const __m128 new_z = _mm_min_ps(
+                _mm_max_ps(_mm_add_ps(z0, _mm_mul_ps(dzdx, dx)), z_lo), z_hi);
+
+            std::memcpy(z, z_row + i, lanes_left * sizeof(float));
+            __m128 old_z = _mm_load_ps(z);
+            int pass_mask = _mm_movemask_ps(
+                _mm_and_ps(inside, _mm_cmpgt_ps(new_z, old_z)));
+            if (!pass_mask) continue;
+            RENDERER_STATS_ONLY(stats.passed += __builtin_popcount(pass_mask);)
+            _mm_store_ps(z, new_z);
+            for (int k = 0; k < lanes_left; ++k) {
+                if (pass_mask >> k & 1) z_row[i + k] = z[k];
+            }
+            write_colors<Bytespp>(setup.color, pass_mask,
+                                  color_row + i * Bytespp);
+        }
+    }
+    return tested;
+}
+
+template <int Bytespp, bool Full>
+__attribute__((target("avx2"))) std::int64_t
+span_avx2(const SpanSetup &setup, const SpanRows &rows, SpanStats &stats) {
+    const __m256 dzdx = _mm256_set1_ps(setup.dzdx);
+    const __m256 z_lo = _mm256_set1_ps(setup.z_lo);
+    const __m256 z_hi = _mm256_set1_ps(setup.z_hi);
+    const __m256i lane_index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i minus_one = _mm256_set1_epi32(-1);
+    const __m256i end = _mm256_set1_epi32(rows.end);
+    const __m256i *lanes = reinterpret_cast<const __m256i *>(setup.edge_lanes);
+    const __m256i lanes0 = _mm256_load_si256(lanes);
+    const __m256i lanes1 = _mm256_load_si256(lanes + 1);
+    const __m256i lanes2 = _mm256_load_si256(lanes + 2);
+    const __m256i step0 = _mm256_set1_epi32(setup.edge_step[0] * 8);
+    const __m256i step1 = _mm256_set1_epi32(setup.edge_step[1] * 8);
+    const __m256i step2 = _mm256_set1_epi32(setup.edge_step[2] * 8);
+    const __m256i color = _mm256_set1_epi32(setup.color);
+
+    std::int64_t tested = 0;
+    for (int r = 0; r < rows.rows; ++r) {
+        float *z_row = rows.z_row + r * rows.z_stride;
+        std::uint8_t *color_row = rows.color_row + r * rows.color_stride;
+        const __m256 z0 = _mm256_set1_ps(rows.z_start[r]);
+        // 每个通道的整数边函数, 每次前进 8 个像素
+        __m256i c0 = _mm256_add_epi32(_mm256_set1_epi32(rows.edge[r][0]), lanes0);
+        __m256i c1 = _mm256_add_epi32(_mm256_set1_epi32(rows.edge[r][1]), lanes1);
+        __m256i c2 = _mm256_add_epi32(_mm256_set1_epi32(rows.edge[r][2]), lanes2);
+        for (int i = rows.begin; i < rows.end; i += 8,
+                 c0 = _mm256_add_epi32(c0, step0),
+                 c1 = _mm256_add_epi32(c1, step1),
+                 c2 = _mm256_add_epi32(c2, step2)) {
+            const __m256i index =
+                _mm256_add_epi32(_mm256_set1_epi32(i), lane_index);
+            // 行尾不足 8 个像素时屏蔽多余的通道, 并且不读写行尾之外的深度
+            const __m256i valid = _mm256_cmpgt_epi32(end, index);
+            __m256 inside = _mm256_castsi256_ps(valid);
+            if constexpr (!Full) {
+                inside = _mm256_castsi256_ps(_mm256_and_si256(
+                    _mm256_cmpgt_epi32(_mm256_or_si256(_mm256_or_si256(c0, c1), c2),
+                                       minus_one),
+                    valid));
+            }
+            int inside_mask = _mm256_movemask_ps(inside);
+            if (!inside_mask) continue;
+            tested += __builtin_popcount(inside_mask);
+            RENDERER_STATS_ONLY(
+                if (stats.overdraw_row) count_overdraw(
+                    inside_mask,
+                    stats.overdraw_row + r * stats.overdraw_stride + i);)
+
+            const __m256 dx = _mm256_cvtepi32_ps(index);
+            const __m256 new_z = _mm256_min_ps(
+                _mm256_max_ps(_mm256_add_ps(z0, _mm256_mul_ps(dzdx, dx)), z_lo),
+                z_hi);
+
+            __m256 old_z = _mm256_maskload_ps(z_row + i, valid);
+            __m256 pass =
+                _mm256_and_ps(inside, _mm256_cmp_ps(new_z, old_z, _CMP_GT_OQ));
+            int pass_mask = _mm256_movemask_ps(pass);
+            if (!pass_mask) continue;
+            RENDERER_STATS_ONLY(stats.passed += __builtin_popcount(pass_mask);)
+            _mm256_maskstore_ps(z_row + i, _mm256_castps_si256(pass), new_z);
+            if constexpr (Bytespp == 4) {
+                // 32 位像素与深度一样整组按掩码写入
+                _mm256_maskstore_epi32(
+                    reinterpret_cast<int *>(color_row + i * 4),
+                    _mm256_castps_si256(pass), color);
+            } else {
+                write_colors<Bytespp>(setup.color, pass_mask,
+                                      color_row + i * Bytespp);
+            }
+        }
+    }
+    return tested;
+}
+
+#endif
+
+template <int Bytespp, bool Full = false> SpanFunction span_function(RasterPath path) {
+#ifdef RENDERER_X86
+    if (path == RasterPath::AVX2) return span_avx2<Bytespp, Full>;
+    if (path == RasterPath::SSE) return span_sse<Bytespp, Full>;
+#endif
+    return span_scalar<Bytespp, Full>;
+}
+
+bool cpu_supports(RasterPath path) {
+    switch (path) {
+    case RasterPath::BARYCENTRIC:
+    case RasterPath::SCALAR:
+        return true;
+#ifdef RENDERER_X86
+    case RasterPath::SSE:
+        return true; // x86-64 基线包含 SSE2
+    case RasterPath::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+// TINY 类三角形: 先用 64 位边函数求出包围盒内的覆盖掩码, 不覆盖任何像素时不求深度平面
+// 不查询 Hi-Z: 几十个像素的深度测试比查询更快, 且查询会触发刚被写过的粗粒度层重新计算
+// Hi-Z 剔除是保守的, 跳过查询不改变结果; 写入的块照常 mark_dirty
+// 深度与 span 内循环按相同的顺序计算, 结果逐像素一致
+template <PixelFormat Format>
+std::int64_t rasterize_tiny(const FixedPointTriangle &triangle, const Vec3f &p0,
+                            const Vec3f &p1, const Vec3f &p2, int x_min, int y_min,
+                            int x_max, int y_max, Framebuffer<Format> &frame_buffer,
+                            DepthBuffer &depth_buffer, PackedPixel pixel,
+                            ThreadStats *stats) {
+    static_assert(tiny_triangle_size * tiny_triangle_size <= 64, "mask must fit in 64 bits");
+    constexpr int bytespp = Framebuffer<Format>::bytespp;
+    std::uint64_t mask = 0;
+    std::int64_t edge_rows[tiny_triangle_size][3];
+    for (int y = y_min; y <= y_max; ++y) {
+        std::int64_t *edge = edge_rows[y - y_min];
+        for (int i = 0; i < 3; ++i) edge[i] = triangle.edge(i, x_min, y);
+        std::int64_t e0 = edge[0], e1 = edge[1], e2 = edge[2];
+        for (int x = x_min; x <= x_max;
+             ++x, e0 += triangle.a[0], e1 += triangle.a[1], e2 += triangle.a[2]) {
+            if ((e0 | e1 | e2) >= 0)
+                mask |= std::uint64_t(1) << ((y - y_min) * tiny_triangle_size + x - x_min);
+        }
+    }
+    if (!mask) {
+        RENDERER_STATS_ADD(stats, class_triangles[static_cast<int>(TriangleClass::EMPTY)], 1);
+        return 0;
+    }
+    RENDERER_STATS_ADD(stats, class_triangles[static_cast<int>(TriangleClass::TINY)], 1);
+
+    const float z_hi = std::max(std::max(p0.z, p1.z), p2.z);
+    const float z_lo = std::min(std::min(p0.z, p1.z), p2.z);
+    const DepthPlane plane(triangle, p0, p1, p2);
+    const float dzdx = static_cast<float>(plane.at(triangle.a));
+    RENDERER_STATS_ONLY(std::int64_t passed = 0;)
+    for (int y = y_min; y <= y_max; ++y) {
+        std::uint32_t row_mask = mask >> ((y - y_min) * tiny_triangle_size) &
+                                 ((1u << tiny_triangle_size) - 1);
+        if (!row_mask) continue;
+        // 宽度不超过块大小, 一行覆盖的像素最多落在两个块中
+        depth_buffer.mark_dirty(x_min + __builtin_ctz(row_mask), y);
+        depth_buffer.mark_dirty(x_min + 31 - __builtin_clz(row_mask), y);
+        const float z_start = static_cast<float>(plane.at(edge_rows[y - y_min]));
+        float *z_row = depth_buffer.row(y) + x_min;
+        std::uint8_t *color_row = frame_buffer.pixel(x_min, y);
+        while (row_mask) {
+            const int i = __builtin_ctz(row_mask);
+            row_mask &= row_mask - 1;
+            RENDERER_STATS_ONLY(if (stats && stats->overdraw) count_overdraw(
+                                    stats->overdraw[y * stats->overdraw_width + x_min + i]);)
+            const float z = std::min(
+                z_hi, std::max(z_lo, z_start + dzdx * static_cast<float>(i)));
+            if (z > z_row[i]) {
+                RENDERER_STATS_ONLY(++passed;)
+                z_row[i] = z;
+                std::memcpy(color_row + i * bytespp, &pixel, bytespp);
+            }
+        }
+    }
+    const int tested = __builtin_popcountll(mask);
+    RENDERER_STATS_ADD(stats, class_pixels[static_cast<int>(TriangleClass::TINY)], tested);
+    RENDERER_STATS_ADD(stats, pixels_passed, passed);
+    return tested;
+}
+
+} // namespace
+
+RasterPath select_raster_path(RasterPath requested) {
+    if (requested != RasterPath::AUTO && cpu_supports(requested))
+        return requested;
+    if (cpu_supports(RasterPath::AVX2)) return RasterPath::AVX2;
+    if (cpu_supports(RasterPath::SSE)) return RasterPath::SSE;
+    return RasterPath::SCALAR;
+}
+
+const char *raster_path_name(RasterPath path) {
+    switch (path) {
+    case RasterPath::AUTO: return "auto";
+    case RasterPath::BARYCENTRIC: return "barycentric";
+    case RasterPath::SCALAR: return "scalar";
+    case RasterPath::SSE: return "sse";
+    case RasterPath::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+bool parse_raster_path(const std::string &name, RasterPath &path) {
+    for (RasterPath candidate :
+         {RasterPath::AUTO, RasterPath::BARYCENTRIC, RasterPath::SCALAR,
+          RasterPath::SSE, RasterPath::AVX2}) {
+        if (name == raster_path_name(candidate)) {
+            path = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FixedPointTriangle::setup(const Vec3f &p0, const Vec3f &p1,
+                               const Vec3f &p2) {
+    const std::int64_t x[3] = {to_fixed(p0.x), to_fixed(p1.x), to_fixed(p2.x)};
+    const std::int64_t y[3] = {to_fixed(p0.y), to_fixed(p1.y), to_fixed(p2.y)};
+    area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+    if (area <= 0) return false;
+
+    // 边 (u, v) 的边函数 E(P) = (v.x - u.x) * (P.y - u.y) - (v.y - u.y) * (P.x - u.x)
+    // 像素 (x, y) 的中心为 (16x + 8, 16y + 8)
+    constexpr std::int64_t half = subpixel_scale / 2;
+    for (int i = 0; i < 3; ++i) {
+        const int u = (i + 1) % 3, v = (i + 2) % 3;
+        const std::int64_t dx = x[v] - x[u], dy = y[v] - y[u];
+        a[i] = -dy * subpixel_scale;
+        b[i] = dx * subpixel_scale;
+        c[i] = dx * (half - y[u]) - dy * (half - x[u]);
+        // y 轴向上, 逆时针绕序时内部在边的左侧:
+        // 左边自上而下 (dy < 0), 上边水平向左 (dy == 0, dx < 0)
+        // 其余的边不包含恰好落在边上的像素中心, 即要求 E > 0, 也就是 E - 1 >= 0
+        const bool top_left = dy < 0 || (dy == 0 && dx < 0);
+        if (!top_left) c[i] -= 1;
+    }
+
+    // 中心落在顶点包围盒内的像素, 即 min <= 16x + 8 <= max, y 同理
+    x_min = static_cast<int>((std::min(std::min(x[0], x[1]), x[2]) + half - 1) >>
+                             subpixel_bits);
+    x_max = static_cast<int>((std::max(std::max(x[0], x[1]), x[2]) - half) >>
+                             subpixel_bits);
+    y_min = static_cast<int>((std::min(std::min(y[0], y[1]), y[2]) + half - 1) >>
+                             subpixel_bits);
+    y_max = static_cast<int>((std::max(std::max(y[0], y[1]), y[2]) - half) >>
+                             subpixel_bits);
+    return true;
+}
+
+template <PixelFormat Format>
+std::int64_t triangle_rasterize_edge(const Vec3f &p0, const Vec3f &p1,
+                                     const Vec3f &p2,
+                                     Framebuffer<Format> &frame_buffer,
+                                     DepthBuffer &depth_buffer,
+                                     PackedPixel pixel, int clip_x_min,
+                                     int clip_y_min, int clip_x_max,
+                                     int clip_y_max, RasterPath path,
+                                     bool hierarchical_z, ThreadStats *stats) {
+    FixedPointTriangle triangle;
+    if (!triangle.setup(p0, p1, p2)) return 0;
+    // 包围盒内没有像素中心
+    if (triangle.x_min > triangle.x_max || triangle.y_min > triangle.y_max) {
+        RENDERER_STATS_ADD(stats, class_triangles[static_cast<int>(TriangleClass::EMPTY)], 1);
+        return 0;
+    }
+    const int x_min = std::max(triangle.x_min, clip_x_min);
+    const int x_max = std::min(triangle.x_max, clip_x_max);
+    const int y_min = std::max(triangle.y_min, clip_y_min);
+    const int y_max = std::min(triangle.y_max, clip_y_max);
+    if (x_min > x_max || y_min > y_max) return 0;
+
+    // 按未裁剪的包围盒与面积分类, 同一个三角形在各 tile 中的分类相同
+    if (triangle.x_max - triangle.x_min < tiny_triangle_size &&
+        triangle.y_max - triangle.y_min < tiny_triangle_size)
+        return rasterize_tiny(triangle, p0, p1, p2, x_min, y_min, x_max, y_max, frame_buffer,
+                              depth_buffer, pixel, stats);
+    // area 为三角形面积的 2 倍, 单位为 1/16 像素的平方
+    constexpr std::int64_t large_area =
+        std::int64_t(2) * large_triangle_pixels * subpixel_scale * subpixel_scale;
+    const bool large = triangle.area >= large_area;
+    const int size_class = static_cast<int>(large ? TriangleClass::LARGE : TriangleClass::MEDIUM);
+    RENDERER_STATS_ADD(stats, class_triangles[size_class], 1);
+
+    // 插值得到的深度截断到顶点深度的范围内, 不超过 z_max, Hi-Z 剔除是保守的
+    const float z_max = std::max(std::max(p0.z, p1.z), p2.z);
+    if (hierarchical_z &&
+        depth_buffer.is_occluded(x_min, y_min, x_max, y_max, z_max))
+        return 0;
+
+    SpanSetup setup;
+    for (int i = 0; i < 3; ++i) {
+        setup.edge_step[i] = static_cast<std::int32_t>(triangle.a[i]);
+        setup.edge_lanes[i][0] = 0;
+        for (int k = 1; k < 8; ++k)
+            setup.edge_lanes[i][k] = setup.edge_lanes[i][k - 1] + setup.edge_step[i];
+    }
+    const DepthPlane plane(triangle, p0, p1, p2);
+    setup.dzdx = static_cast<float>(plane.at(triangle.a));
+    setup.z_lo = std::min(std::min(p0.z, p1.z), p2.z);
+    setup.z_hi = z_max;
+    setup.color = pixel;
+
+    // 包围盒内边函数的绝对值都不超过 edge_limit 时 (除了很大的三角形都是如此),
+    // span 起点的边函数不需要截断
+    bool fits_32bit = true;
+    for (int i = 0; i < 3; ++i) {
+        const std::int64_t bound = std::abs(triangle.edge(i, x_min, y_min)) +
+                                   std::abs(triangle.a[i]) * (x_max - x_min) +
+                                   std::abs(triangle.b[i]) * (y_max - y_min);
+        fits_32bit &= bound <= edge_limit;
+    }
+
+    // 按 Hi-Z 的块遍历包围盒: 每次处理一条 block_size 行高的带,
+    // 带内逐块检查块的最小深度, 被完全遮挡的块跳过
+    constexpr int block_size = DepthBuffer::block_size;
+    SpanFunction span = span_function<Framebuffer<Format>::bytespp>(path);
+    SpanFunction span_full = span_function<Framebuffer<Format>::bytespp, true>(path);
+    std::int64_t tested = 0;
+    SpanStats span_stats;
+    RENDERER_STATS_ONLY(if (stats) span_stats.overdraw_stride = stats->overdraw_width;)
+    std::int64_t edge_band[block_size][3];
+    std::int32_t edge_block[block_size][3];
+    float z_band[block_size];
+    SpanRows rows;
+    rows.z_start = z_band;
+    rows.edge = edge_block;
+    rows.z_stride = depth_buffer.get_width();
+    rows.color_stride = frame_buffer.get_width() * Framebuffer<Format>::bytespp;
+    for (int band_y = y_min; band_y <= y_max;) {
+        const int band_rows =
+            std::min((band_y / block_size + 1) * block_size, y_max + 1) - band_y;
+        // 每行行首的整数边函数按行增量步进
+        std::int64_t edge_row[3];
+        for (int i = 0; i < 3; ++i) edge_row[i] = triangle.edge(i, x_min, band_y);
+        for (int r = 0; r < band_rows; ++r) {
+            for (int i = 0; i < 3; ++i) {
+                edge_band[r][i] = edge_row[i];
+                edge_row[i] += triangle.b[i];
+            }
+            z_band[r] = static_cast<float>(plane.at(edge_band[r]));
+        }
+        rows.rows = band_rows;
+        rows.z_row = depth_buffer.row(band_y) + x_min;
+        rows.color_row = frame_buffer.pixel(x_min, band_y);
+        RENDERER_STATS_ONLY(
+            span_stats.overdraw_row =
+                stats && stats->overdraw
+                    ? stats->overdraw + band_y * stats->overdraw_width + x_min
+                    : nullptr;)
+
+        for (int block_x = x_min / block_size; block_x <= x_max / block_size;
+             ++block_x) {
+            if (hierarchical_z &&
+                z_max <= depth_buffer.block_min(block_x, band_y / block_size))
+                continue;
+
+            rows.begin = std::max(block_x * block_size, x_min) - x_min;
+            rows.end = std::min((block_x + 1) * block_size, x_max + 1) - x_min;
+            // LARGE: 边函数是线性的, 块内像素中心的最小值与最大值在四个角上取得
+            // 某条边在四个角都为负时整块不被覆盖, 三条边在四个角都非负时整块被覆盖
+            bool full = large;
+            if (large) {
+                bool outside = false;
+                for (int i = 0; i < 3; ++i) {
+                    const std::int64_t left = triangle.a[i] * rows.begin;
+                    const std::int64_t right = triangle.a[i] * (rows.end - 1);
+                    const std::int64_t top[2] = {edge_band[0][i] + left,
+                                                 edge_band[0][i] + right};
+                    const std::int64_t bottom[2] = {edge_band[band_rows - 1][i] + left,
+                                                    edge_band[band_rows - 1][i] + right};
+                    const std::int64_t lo = std::min(std::min(top[0], top[1]),
+                                                     std::min(bottom[0], bottom[1]));
+                    const std::int64_t hi = std::max(std::max(top[0], top[1]),
+                                                     std::max(bottom[0], bottom[1]));
+                    outside |= hi < 0;
+                    full &= lo >= 0;
+                }
+                if (outside) continue;
+            }
+            // 块内各行像素 begin 的整数边函数
+            for (int r = 0; r < band_rows; ++r) {
+                for (int i = 0; i < 3; ++i) {
+                    std::int64_t value = edge_band[r][i] + triangle.a[i] * rows.begin;
+                    if (!fits_32bit)
+                        value = std::min(std::max(value, -edge_limit), edge_limit);
+                    edge_block[r][i] = static_cast<std::int32_t>(value);
+                }
+            }
+            const std::int64_t block_tested =
+                (full ? span_full : span)(setup, rows, span_stats);
+            if (block_tested)
+                depth_buffer.mark_dirty(block_x * block_size, band_y);
+            tested += block_tested;
+        }
+        band_y += band_rows;
+    }
+    RENDERER_STATS_ADD(stats, pixels_passed, span_stats.passed);
+    RENDERER_STATS_ADD(stats, class_pixels[size_class], tested);
+    return tested;
+}
+
+#define INSTANTIATE_TRIANGLE_RASTERIZE_EDGE(Format)                            \
+    template std::int64_t triangle_rasterize_edge<Format>(                     \
+        const Vec3f &, const Vec3f &, const Vec3f &, Framebuffer<Format> &,    \
+        DepthBuffer &, PackedPixel, int, int, int, int, RasterPath, bool,      \
+        ThreadStats *);
+INSTANTIATE_TRIANGLE_RASTERIZE_EDGE(PixelFormat::GRAYSCALE)
+INSTANTIATE_TRIANGLE_RASTERIZE_EDGE(PixelFormat::RGB)
+INSTANTIATE_TRIANGLE_RASTERIZE_EDGE(PixelFormat::RGBA)
+#undef INSTANTIATE_TRIANGLE_RASTERIZE_EDGE
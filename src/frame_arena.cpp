@@ -0,0 +1,93 @@
+#include "frame_arena.h"
+#include <cstring>
+#include <new>
+#include <omp.h>
+#include <utility>
+
+std::byte *Arena::allocate_block(std::size_t capacity) {
+    return static_cast<std::byte *>(::operator new(capacity, std::align_val_t(block_align)));
+}
+
+void Arena::free_block(std::byte *block) {
+    if (block) ::operator delete(block, std::align_val_t(block_align));
+}
+
+Arena::Arena(std::size_t capacity) {
+    block_ = allocate_block(capacity);
+    capacity_ = capacity;
+    ++blocks_allocated_;
+}
+
+Arena::~Arena() {
+    for (std::byte *block : retired_) free_block(block);
+    free_block(block_);
+}
+
+Arena::Arena(Arena &&other) noexcept
+    : block_(std::exchange(other.block_, nullptr)),
+      capacity_(std::exchange(other.capacity_, 0)), offset_(std::exchange(other.offset_, 0)),
+      retired_(std::move(other.retired_)),
+      retired_bytes_(std::exchange(other.retired_bytes_, 0)), peak_(other.peak_),
+      blocks_allocated_(other.blocks_allocated_) {}
+
+void *Arena::grow(std::size_t bytes, std::size_t align) {
+    // 新块至少容纳这一次分配, 并且按倍数增长, 一帧内只需分配 O(log 用量) 次
+    const std::size_t capacity = std::max({bytes + align, capacity_ * 2, min_block});
+    if (block_) {
+        retired_.push_back(block_);
+        retired_bytes_ += offset_;
+    }
+    block_ = allocate_block(capacity);
+    capacity_ = capacity;
+    ++blocks_allocated_;
+    offset_ = bytes;
+    return block_;
+}
+
+void Arena::reset() {
+    peak_ = peak();
+#ifdef RENDERER_ARENA_DEBUG
+    if (block_) std::memset(block_, 0xcd, offset_);
+#endif
+    if (!retired_.empty()) {
+        // 这一帧用了多个块: 换成一个能容纳这一帧全部用量的块, 留出一半的余量,
+        // 之后各帧的用量略有波动 (例如可见的三角形个数变化) 时不再分配
+        const std::size_t capacity = std::max(capacity_, used() + used() / 2 + block_align);
+        for (std::byte *block : retired_) free_block(block);
+        retired_.clear();
+        retired_bytes_ = 0;
+        free_block(block_);
+        block_ = allocate_block(capacity);
+        capacity_ = capacity;
+        ++blocks_allocated_;
+    }
+    offset_ = 0;
+}
+
+void FrameArena::reset() {
+    shared_.reset();
+    const int threads = omp_get_max_threads();
+    if (static_cast<int>(threads_.size()) != threads) threads_.resize(threads);
+    for (ThreadArena &thread : threads_) thread.arena.reset();
+}
+
+std::size_t FrameArena::peak() const {
+    std::size_t peak = shared_.peak();
+    for (const ThreadArena &thread : threads_) peak += thread.arena.peak();
+    return peak;
+}
+
+std::size_t FrameArena::blocks_allocated() const {
+    std::size_t blocks = shared_.blocks_allocated();
+    for (const ThreadArena &thread : threads_) blocks += thread.arena.blocks_allocated();
+    return blocks;
+}
+
+void FrameArena::write_report(std::ostream &out, const char *name) const {
+    std::size_t thread_peak = 0;
+    for (const ThreadArena &thread : threads_)
+        thread_peak = std::max(thread_peak, thread.arena.peak());
+    out << name << " arena: peak " << peak() << " bytes (shared " << shared_.peak()
+        << ", max per thread " << thread_peak << " x " << threads_.size() << " threads), "
+        << blocks_allocated() << " block allocations\n";
+}
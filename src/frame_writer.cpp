@@ -0,0 +1,122 @@
+#include "frame_writer.h"
+#include "tga_image.h"
+#include <algorithm>
+
+template <PixelFormat Format>
+FrameWriter<Format>::FrameWriter(int width, int height,
+                                 const FrameWriterOptions &options)
+    : options_(options) {
+    const int slots = std::max(1, options.slots);
+    for (int i = 0; i < slots; ++i) {
+        auto frame = std::make_unique<Frame>();
+        frame->color = Framebuffer<Format>(width, height);
+        if (options.depth != DepthDump::NONE)
+            frame->depth = Framebuffer<PixelFormat::GRAYSCALE>(width, height);
+        free_.push_back(frame.get());
+        slots_.push_back(std::move(frame));
+    }
+    thread_ = std::thread(&FrameWriter::run, this);
+}
+
+template <PixelFormat Format> FrameWriter<Format>::~FrameWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    frame_pending_.notify_one();
+    thread_.join();
+}
+
+template <PixelFormat Format> void FrameWriter<Format>::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        frame_pending_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+        // 停止前先写完排队的帧
+        if (pending_.empty()) return;
+        Frame *frame = pending_.front();
+        pending_.pop_front();
+        ++writing_;
+        lock.unlock();
+
+        bool ok = TgaImage::wrap(frame->color).write_tga_file(frame->filename, true,
+                                                              encode_buffer_);
+        if (!frame->depth_filename.empty()) {
+            ok = TgaImage::wrap(frame->depth).write_tga_file(frame->depth_filename,
+                                                             true, encode_buffer_) &&
+                 ok;
+        }
+
+        lock.lock();
+        --writing_;
+        if (ok) {
+            ++written_;
+        } else {
+            ++failed_;
+        }
+        free_.push_back(frame);
+        frame_freed_.notify_all();
+    }
+}
+
+template <PixelFormat Format>
+typename FrameWriter<Format>::Frame &FrameWriter<Format>::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    frame_freed_.wait(lock, [this] { return !free_.empty(); });
+    Frame *frame = free_.front();
+    free_.pop_front();
+    // 只清空内容, 保留字符串的容量
+    frame->filename.clear();
+    frame->depth_filename.clear();
+    return *frame;
+}
+
+template <PixelFormat Format> bool FrameWriter<Format>::wants_depth() const {
+    switch (options_.depth) {
+    case DepthDump::ALWAYS: return true;
+    case DepthDump::IF_IDLE: {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pending_.empty() && !writing_;
+    }
+    default: return false;
+    }
+}
+
+template <PixelFormat Format> void FrameWriter<Format>::submit(Frame &frame) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (frame.filename.empty()) {
+            free_.push_back(&frame);
+            frame_freed_.notify_all();
+            return;
+        }
+        if (options_.depth == DepthDump::IF_IDLE && frame.depth_filename.empty())
+            ++dropped_depth_;
+        pending_.push_back(&frame);
+    }
+    frame_pending_.notify_one();
+}
+
+template <PixelFormat Format> void FrameWriter<Format>::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    frame_freed_.wait(lock, [this] { return pending_.empty() && !writing_; });
+}
+
+template <PixelFormat Format> std::int64_t FrameWriter<Format>::get_written() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return written_;
+}
+
+template <PixelFormat Format> std::int64_t FrameWriter<Format>::get_failed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+}
+
+template <PixelFormat Format>
+std::int64_t FrameWriter<Format>::get_dropped_depth() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_depth_;
+}
+
+template class FrameWriter<PixelFormat::GRAYSCALE>;
+template class FrameWriter<PixelFormat::RGB>;
+template class FrameWriter<PixelFormat::RGBA>;
@@ -0,0 +1,143 @@
+#include "image_transform.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RENDERER_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 转置与旋转的分块边长 (像素), 4 字节像素时一块为 4 KB
+constexpr int tile_size = 32;
+// 超过该字节数时按块行并行
+constexpr std::size_t parallel_bytes = 1 << 20;
+
+template <int Bytespp> inline void swap_pixel(std::uint8_t *a, std::uint8_t *b) {
+    std::uint8_t tmp[Bytespp];
+    std::memcpy(tmp, a, Bytespp);
+    std::memcpy(a, b, Bytespp);
+    std::memcpy(b, tmp, Bytespp);
+}
+
+#ifdef RENDERER_SSE
+// 反转 16 个字节中的像素顺序
+template <int Bytespp> inline __m128i reverse_pixels(__m128i v) {
+    // 先反转 4 个 32 位字
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+    if constexpr (Bytespp == 1) {
+        // 再反转字内的 16 位字与字节
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    }
+    return v;
+}
+#endif
+
+// 反转一行中的像素, 从两端向中间交换
+template <int Bytespp> void reverse_row(std::uint8_t *row, int width) {
+    int left = 0, right = width;
+#ifdef RENDERER_SSE
+    if constexpr (Bytespp == 1 || Bytespp == 4) {
+        constexpr int n = 16 / Bytespp;
+        while (right - left >= 2 * n) {
+            std::uint8_t *l = row + left * Bytespp;
+            std::uint8_t *r = row + (right - n) * Bytespp;
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(l));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(r));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(l), reverse_pixels<Bytespp>(b));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(r), reverse_pixels<Bytespp>(a));
+            left += n, right -= n;
+        }
+    }
+#endif
+    for (--right; left < right; ++left, --right)
+        swap_pixel<Bytespp>(row + left * Bytespp, row + right * Bytespp);
+}
+
+template <int Bytespp> void flip_columns(std::uint8_t *pixels, int width, int height) {
+    const std::size_t row_bytes = static_cast<std::size_t>(width) * Bytespp;
+#pragma omp parallel for if (row_bytes * height > parallel_bytes)
+    for (int y = 0; y < height; ++y) reverse_row<Bytespp>(pixels + y * row_bytes, width);
+}
+
+enum class Rotation { TRANSPOSE, CW, CCW };
+
+// 按块把 src 的 (x, y) 写到 dst, dst 的宽为 height
+// 转置: (y, x), 顺时针: (height - 1 - y, x), 逆时针: (y, width - 1 - x)
+// 块内逐行读 src, 写入 dst 的 tile_size 行, 这些行在处理该块期间一直在缓存中
+template <int Bytespp, Rotation Mode>
+void rotate(const std::uint8_t *src, int width, int height, std::uint8_t *dst) {
+    const std::size_t src_row = static_cast<std::size_t>(width) * Bytespp;
+    const std::size_t dst_row = static_cast<std::size_t>(height) * Bytespp;
+    const int tiles_y = (height + tile_size - 1) / tile_size;
+#pragma omp parallel for schedule(dynamic) if (src_row * height > parallel_bytes)
+    for (int tile_y = 0; tile_y < tiles_y; ++tile_y) {
+        const int y0 = tile_y * tile_size, y1 = std::min(height, y0 + tile_size);
+        for (int x0 = 0; x0 < width; x0 += tile_size) {
+            const int x1 = std::min(width, x0 + tile_size);
+            for (int y = y0; y < y1; ++y) {
+                const std::uint8_t *s = src + y * src_row + x0 * Bytespp;
+                const int dx = Mode == Rotation::CW ? height - 1 - y : y;
+                for (int x = x0; x < x1; ++x, s += Bytespp) {
+                    const int dy = Mode == Rotation::CCW ? width - 1 - x : x;
+                    std::memcpy(dst + dy * dst_row + dx * Bytespp, s, Bytespp);
+                }
+            }
+        }
+    }
+}
+
+template <Rotation Mode>
+void rotate(const std::uint8_t *src, int width, int height, int bytespp,
+            std::uint8_t *dst) {
+    switch (bytespp) {
+    case 1: rotate<1, Mode>(src, width, height, dst); break;
+    case 3: rotate<3, Mode>(src, width, height, dst); break;
+    case 4: rotate<4, Mode>(src, width, height, dst); break;
+    default: break;
+    }
+}
+
+} // namespace
+
+void flip_rows(std::uint8_t *pixels, int width, int height, int bytespp) {
+    const std::size_t row_bytes = static_cast<std::size_t>(width) * bytespp;
+    for (int y = 0; y < height / 2; ++y) {
+        std::uint8_t *top = pixels + y * row_bytes;
+        std::swap_ranges(top, top + row_bytes,
+                         pixels + (height - 1 - y) * row_bytes);
+    }
+}
+
+void flip_columns(std::uint8_t *pixels, int width, int height, int bytespp) {
+    switch (bytespp) {
+    case 1: flip_columns<1>(pixels, width, height); break;
+    case 3: flip_columns<3>(pixels, width, height); break;
+    case 4: flip_columns<4>(pixels, width, height); break;
+    default: break;
+    }
+}
+
+void rotate_180(std::uint8_t *pixels, int width, int height, int bytespp) {
+    flip_rows(pixels, width, height, bytespp);
+    flip_columns(pixels, width, height, bytespp);
+}
+
+void transpose(const std::uint8_t *src, int width, int height, int bytespp,
+               std::uint8_t *dst) {
+    rotate<Rotation::TRANSPOSE>(src, width, height, bytespp, dst);
+}
+
+void rotate_90_cw(const std::uint8_t *src, int width, int height, int bytespp,
+                  std::uint8_t *dst) {
+    rotate<Rotation::CW>(src, width, height, bytespp, dst);
+}
+
+void rotate_90_ccw(const std::uint8_t *src, int width, int height, int bytespp,
+                   std::uint8_t *dst) {
+    rotate<Rotation::CCW>(src, width, height, bytespp, dst);
+}
@@ -0,0 +1,171 @@
+#include "line_draw.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+// 原始方案
+// t = (x - ax) / (bx - ax)
+// y = ay + t * (by - ay) = ay + (x - ax) * (by - ay) / (bx - ax)
+// 递增 x, 每次 y 递增 (by - ay) / (bx - ax) 即可
+// 优化 1
+// 为了图像平滑, 对 y 进行四舍五入而不是直接截断来获得坐标
+// 为了性能, 使用整数计算代替浮点数计算, 使用乘上分支值的乘法代替条件分支
+// 使用浮点数 error 存储 y 小数部分来四舍五入, 使用整数 y 作为坐标
+// error += std::abs(by - ay) / static_cast<float>(bx - ax)
+// y += (by > ay ? : 1 : -1) * (error > 0.5)
+// error -= 1
+// 优化 2
+// 为了性能, 进一步使用整数计算代替浮点数计算
+// 设置整数 ierror = 2 * error * (bx - ax)
+// ierror += 2 * std::abs(by - ay)
+// y += (by > ay ? 1 : -1) * (ierror > bx - ax)
+// ierror -= 2 * (bx - ax) * (ierror > bx - ax)
+// 性能测试:
+// 测试目的 对比 Bresenham 算法与浮点算法的性能
+// 处理器	13th Gen Intel(R) Core(TM) i9-13900HX，2200 Mhz，24 个内核，32
+// 个逻辑处理器 操作系统 Windows 11 编译环境 (MSYS2) GNU 15.1.0, -std=c++17 -O3
+// 测试数据 1 << 24 条线段, 坐标范围在 [0, 64)
+// 计时方式:
+// auto start = std::chrono::high_resolution_clock::now();
+// // 测试代码
+// auto end = std::chrono::high_resolution_clock::now();
+// auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end -
+// start).count(); 测试结果 Bresenham's Line Draw Algorithm
+// 比浮点数增量的四舍五入要快 100000 微秒
+// 可复现的测试见 renderer_bench 中的 line_draw 基准
+// 优化 3
+// 先裁剪再步进, 完全在裁剪矩形外的线段不走一步
+// 设主方向长度 dx, 次方向长度 dy, 第 k 步时次方向已经走了
+// m_k = floor((2 * k * dy + dx - 1) / (2 * dx)) 步, ierror = 2 * k * dy - 2 * dx * m_k
+// 所以可以直接算出任意一步的状态; 由主方向的裁剪范围得到 k 的范围,
+// 再由 m_k 的单调性反解次方向的裁剪范围 (整数的 Liang-Barsky 裁剪)
+// 裁剪后画出的像素与不裁剪逐像素判断边界完全相同, 分带并行画同一条线时带与带之间也不会错开
+// 优化 4
+// 内循环不再判断 steep, 也不做边界检查: 陡峭与平缓只是主 / 次方向的地址步长不同,
+// 每步地址加上主方向步长, 次方向走一步时再加上次方向步长 (乘以 0 或 1), 直接写入行内存
+
+namespace {
+
+// 第 k 步时次方向已经走的步数, dx > 0
+inline std::int64_t minor_steps(std::int64_t k, std::int64_t dx, std::int64_t dy) {
+    return (2 * k * dy + dx - 1) / (2 * dx);
+}
+
+// 使 m_k >= m 的最小的 k, 不存在时返回 int64 的最大值
+inline std::int64_t first_step(std::int64_t m, std::int64_t dx, std::int64_t dy) {
+    if (m <= 0) return 0;
+    if (!dy) return std::numeric_limits<std::int64_t>::max();
+    // 2 * k * dy >= 2 * dx * m - dx + 1
+    return (2 * dx * m - dx + 1 + 2 * dy - 1) / (2 * dy);
+}
+
+template <int Bytespp>
+std::int64_t draw_line(std::uint8_t *pixels, std::ptrdiff_t row_bytes, int width,
+                       int height, int ax, int ay, int bx, int by,
+                       PackedPixel color, int clip_y_min, int clip_y_max) {
+    // 主方向为 x, 陡峭时交换 x 与 y, 再使主方向递增
+    const bool steep = std::abs(ax - bx) < std::abs(ay - by);
+    if (steep) {
+        std::swap(ax, ay);
+        std::swap(bx, by);
+    }
+    if (ax > bx) {
+        std::swap(ax, bx);
+        std::swap(ay, by);
+    }
+    const std::int64_t dx = bx - ax, dy = std::abs(by - ay);
+    const int sign = by > ay ? 1 : -1;
+
+    // 裁剪矩形在 (主方向, 次方向) 坐标下的范围
+    clip_y_min = std::max(clip_y_min, 0);
+    clip_y_max = std::min(clip_y_max, height - 1);
+    const int major_min = steep ? clip_y_min : 0;
+    const int major_max = steep ? clip_y_max : width - 1;
+    const int minor_min = steep ? 0 : clip_y_min;
+    const int minor_max = steep ? width - 1 : clip_y_max;
+
+    // 主方向的裁剪
+    std::int64_t k_begin = std::max<std::int64_t>(0, major_min - ax);
+    std::int64_t k_end = std::min<std::int64_t>(dx, major_max - ax);
+    // 次方向的裁剪: ay + sign * m_k 位于 [minor_min, minor_max] 内
+    const std::int64_t m_min = sign > 0 ? minor_min - ay : ay - minor_max;
+    const std::int64_t m_max = sign > 0 ? minor_max - ay : ay - minor_min;
+    if (m_max < 0) return 0;
+    if (dx) {
+        k_begin = std::max(k_begin, first_step(m_min, dx, dy));
+        const std::int64_t k_next = first_step(m_max + 1, dx, dy);
+        if (k_next != std::numeric_limits<std::int64_t>::max())
+            k_end = std::min(k_end, k_next - 1);
+    } else if (m_min > 0) {
+        return 0;
+    }
+    if (k_begin > k_end) return 0;
+
+    // 第 k_begin 步的状态
+    const std::int64_t m = dx ? minor_steps(k_begin, dx, dy) : 0;
+    std::int64_t ierror = 2 * k_begin * dy - 2 * dx * m;
+    const std::int64_t major = ax + k_begin, minor = ay + sign * m;
+    const std::int64_t x = steep ? minor : major, y = steep ? major : minor;
+    std::ptrdiff_t offset = y * row_bytes + x * Bytespp;
+    const std::ptrdiff_t major_step = steep ? row_bytes : Bytespp;
+    const std::ptrdiff_t minor_step = sign * (steep ? Bytespp : row_bytes);
+
+    for (std::int64_t k = k_begin; k <= k_end; ++k) {
+        std::memcpy(pixels + offset, &color, Bytespp);
+        ierror += 2 * dy;
+        const int step = ierror > dx;
+        offset += major_step + step * minor_step;
+        ierror -= 2 * dx * step;
+    }
+    return k_end - k_begin + 1;
+}
+
+std::int64_t draw_line(std::uint8_t *pixels, int bytespp, int width, int height,
+                       int ax, int ay, int bx, int by, PackedPixel color,
+                       int clip_y_min, int clip_y_max) {
+    const std::ptrdiff_t row_bytes = static_cast<std::ptrdiff_t>(width) * bytespp;
+    switch (bytespp) {
+    case 1:
+        return draw_line<1>(pixels, row_bytes, width, height, ax, ay, bx, by,
+                            color, clip_y_min, clip_y_max);
+    case 3:
+        return draw_line<3>(pixels, row_bytes, width, height, ax, ay, bx, by,
+                            color, clip_y_min, clip_y_max);
+    case 4:
+        return draw_line<4>(pixels, row_bytes, width, height, ax, ay, bx, by,
+                            color, clip_y_min, clip_y_max);
+    default: return 0;
+    }
+}
+
+} // namespace
+
+void line_draw(int ax, int ay, int bx, int by, TgaImage &frame_buffer,
+               const TgaColor &color) {
+    if (!frame_buffer.data()) return;
+    draw_line(frame_buffer.data(), frame_buffer.get_bytespp(),
+              frame_buffer.get_width(), frame_buffer.get_height(), ax, ay, bx,
+              by, pack_color(color), 0, frame_buffer.get_height() - 1);
+}
+
+template <PixelFormat Format>
+std::int64_t line_draw(int ax, int ay, int bx, int by,
+                       Framebuffer<Format> &frame_buffer, PackedPixel color,
+                       int clip_y_min, int clip_y_max) {
+    return draw_line<Framebuffer<Format>::bytespp>(
+        frame_buffer.data(),
+        static_cast<std::ptrdiff_t>(frame_buffer.get_width()) *
+            Framebuffer<Format>::bytespp,
+        frame_buffer.get_width(), frame_buffer.get_height(), ax, ay, bx, by,
+        color, clip_y_min, clip_y_max);
+}
+
+template std::int64_t line_draw<PixelFormat::GRAYSCALE>(
+    int, int, int, int, Framebuffer<PixelFormat::GRAYSCALE> &, PackedPixel, int, int);
+template std::int64_t line_draw<PixelFormat::RGB>(
+    int, int, int, int, Framebuffer<PixelFormat::RGB> &, PackedPixel, int, int);
+template std::int64_t line_draw<PixelFormat::RGBA>(
+    int, int, int, int, Framebuffer<PixelFormat::RGBA> &, PackedPixel, int, int);
@@ -1,81 +1,42 @@
+#include "animation.h"
+#include "batch.h"
+#include "depth_buffer.h"
+#include "frame_writer.h"
+#include "framebuffer.h"
+#include "line_draw.h"
+#include "mesh_cache.h"
+#include "mesh_optimize.h"
+#include "mesh_stream.h"
+#include "meshlet.h"
 #include "model.h"
+#include "msaa.h"
+#include "rasterizer.h"
+#include "shaders.h"
+#include "stats.h"
+#include "texture.h"
 #include "tga_image.h"
+#include "wireframe.h"
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
+#include <iostream>
 #include <ratio>
 #include <string>
 #include <ctime>
+#include <vector>
 
-constexpr int width = 1024;
-constexpr int height = 1024;
+constexpr int default_width = 1024;
+constexpr int default_height = 1024;
 
 constexpr TgaColor white = {255, 255, 255, 255};
 constexpr TgaColor blue = {255, 0, 0, 255};
 constexpr TgaColor green = {0, 255, 0, 255};
 constexpr TgaColor red = {0, 0, 255, 255};
 
-// 原始方案
-// t = (x - ax) / (bx - ax)
-// y = ay + t * (by - ay) = ay + (x - ax) * (by - ay) / (bx - ax)
-// 递增 x, 每次 y 递增 (by - ay) / (bx - ax) 即可
-// 优化 1
-// 为了图像平滑, 对 y 进行四舍五入而不是直接截断来获得坐标
-// 为了性能, 使用整数计算代替浮点数计算, 使用乘上分支值的乘法代替条件分支
-// 使用浮点数 error 存储 y 小数部分来四舍五入, 使用整数 y 作为坐标
-// error += std::abs(by - ay) / static_cast<float>(bx - ax)
-// y += (by > ay ? : 1 : -1) * (error > 0.5)
-// error -= 1
-// 优化 2
-// 为了性能, 进一步使用整数计算代替浮点数计算
-// 设置整数 ierror = 2 * error * (bx - ax)
-// ierror += 2 * std::abs(by - ay)
-// y += (by > ay ? 1 : -1) * (ierror > bx - ax)
-// ierror -= 2 * (bx - ax) * (ierror > bx - ax)
-// 性能测试:
-// 测试目的 对比 Bresenham 算法与浮点算法的性能
-// 处理器	13th Gen Intel(R) Core(TM) i9-13900HX，2200 Mhz，24 个内核，32
-// 个逻辑处理器 操作系统 Windows 11 编译环境 (MSYS2) GNU 15.1.0, -std=c++17 -O3
-// 测试数据 1 << 24 条线段, 坐标范围在 [0, 64)
-// 计时方式:
-// auto start = std::chrono::high_resolution_clock::now();
-// // 测试代码
-// auto end = std::chrono::high_resolution_clock::now();
-// auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end -
-// start).count(); 测试结果 Bresenham's Line Draw Algorithm
-// 比浮点数增量的四舍五入要快 100000 微秒
-void line_draw(int ax, int ay, int bx, int by, TgaImage &frame_buffer,
-               const TgaColor &color) {
-    // std::cerr << __PRETTY_FUNCTION__ << ": " << ax << " " << ay << " " << bx
-    // << " " << by << '\n';
-
-    bool steep =
-        std::abs(ax - bx) < std::abs(ay - by); // x and y are changed when true
-    if (steep) {
-        std::swap(ax, ay);
-        std::swap(bx, by);
-    }
-
-    if (ax > bx) { // make it left to right
-        std::swap(ax, bx);
-        std::swap(ay, by);
-    }
-
-    int y = ay;
-    int ierror = 0; // 2 * error * (bx - ax)
-    for (int x = ax; x <= bx; ++x) {
-        if (steep) {
-            frame_buffer.set_pixel(y, x, color);
-        } else {
-            frame_buffer.set_pixel(x, y, color);
-        }
-        ierror += 2 * std::abs(by - ay);
-        y += (by > ay ? 1 : -1) * (ierror > bx - ax);
-        ierror -= 2 * (bx - ax) * (ierror > bx - ax);
-    }
-}
-
 float linear_interpolate(float value, float old_min_value, float old_max_value,
                          float new_min_value, float new_max_value) {
     return new_min_value + (value - old_min_value) *
@@ -83,107 +44,579 @@ float linear_interpolate(float value, float old_min_value, float old_max_value,
                                (old_max_value - old_min_value);
 }
 
-// 视口变换
-// NDC -> [0, width]x[0, height]x[0, 255]
-// NDC z 的变换用于可视化深度
-Vec3f viewport_trans(const Vec3f &point, const int width,
-                                    const int height) {
-    return {(point.x + 1.f) * (width - 1) / 2, (point.y + 1.f) * (height - 1) / 2, (point.z + 1.f) * 255.f / 2};
+// 可编程管线的渲染参数
+// 相机固定, 模型变换为单位矩阵或多帧模式下该帧的变换
+struct ShadingSetup {
+    ShaderKind shader = ShaderKind::PHONG;
+    Mat4f view, projection;
+    ShaderUniforms uniforms;
+    ShadedScratch scratch;
+};
+
+// 正交模式的视图与投影都为单位矩阵, 与 rasterize 的视口相同;
+// 透视模式的相机位于 (0, 0, 3) 看向原点, fovy 为竖直视角 (度)
+void setup_camera(ShadingSetup &setup, bool perspective, float fovy, int width, int height) {
+    if (!perspective) return;
+    const Vec3f eye = {0.f, 0.f, 3.f};
+    setup.view = Mat4f::look_at(eye, {0.f, 0.f, 0.f}, {0.f, 1.f, 0.f});
+    setup.projection = Mat4f::perspective(fovy * 3.14159265f / 180.f,
+                                          static_cast<float>(width) / height, 0.1f, 10.f);
+    setup.uniforms.eye = eye;
 }
 
-void triangle_rasterize(const Vec3f &p0, const Vec3f &p1, const Vec3f &p2, TgaImage &frame_buffer, TgaImage &z_buffer, const TgaColor &color) {
-    float ax = p0[0], ay = p0[1], az = p0[2];
-    float bx = p1[0], by = p1[1], bz = p1[2];
-    float cx = p2[0], cy = p2[1], cz = p2[2];
-
-    // 包围盒
-    int x_min = std::min(std::min(ax, bx), cx);
-    int x_max = std::max(std::max(ax, bx), cx);
-    x_max = std::min(x_max, frame_buffer.get_width() - 1); // x 坐标为 width 的点位于第 width - 1 列像素的右侧边界上
-    int y_min = std::min(std::min(ay, by), cy);
-    int y_max = std::max(std::max(ay, by), cy);
-    y_max = std::min(y_max, frame_buffer.get_height() - 1); // 同上
-
-// #pragma omp parallel for
-    // 遍历包围盒内像素
-    for (int x = x_min; x <= x_max; ++x) {
-        for (int y = y_min; y <= y_max; ++y) {
-            // 计算重心坐标
-            auto [alpha, beta, gamma] = barycentric_coordinates(Vec2f{x + 0.5f, y + 0.5f}, Vec2f{ax, ay}, Vec2f{bx, by}, Vec2f{cx, cy});
-
-            if (beta >= 0 && gamma >= 0 && beta + gamma <= 1) {
-                // 正交投影 可以使用屏幕空间的重心坐标插值 z
-                std::uint8_t z = static_cast<std::uint8_t>(alpha * az + beta * bz + gamma * cz);
-                if (z > z_buffer.get_pixel(x, y)[0]) {
-                    z_buffer.set_pixel(x, y, {z});
-                    frame_buffer.set_pixel(x, y, color);
-                }
-            }
+std::int64_t render_shaded_frame(const Model &model, ShadingSetup &setup,
+                                 const Affine3f *transform,
+                                 Framebuffer<PixelFormat::RGB> &frame_buffer,
+                                 DepthBuffer &depth_buffer, bool hierarchical_z,
+                                 FrameStats *stats) {
+    MatrixStack matrices;
+    matrices.load(setup.projection);
+    matrices.multiply(setup.view);
+    setup.uniforms.model = transform ? Mat4f::from_affine(*transform) : Mat4f{};
+    matrices.push();
+    matrices.multiply(setup.uniforms.model);
+    setup.uniforms.mvp = matrices.top();
+    matrices.pop();
+    return render_shaded(model, setup.shader, setup.uniforms, frame_buffer, depth_buffer,
+                         &setup.scratch, stats, hierarchical_z);
+}
+
+// 调试模式下输出本次渲染所用 Arena 的峰值用量: 线框、可编程管线、rasterize 三者之一
+void report_arenas([[maybe_unused]] const RasterScratch &raster,
+                   [[maybe_unused]] const WireframeScratch &wireframe,
+                   [[maybe_unused]] bool use_wireframe,
+                   [[maybe_unused]] const ShadingSetup *shading) {
+#ifdef RENDERER_ARENA_DEBUG
+    if (use_wireframe) {
+        std::cerr << "wireframe arena: peak " << wireframe.arena.peak() << " bytes, "
+                  << wireframe.arena.blocks_allocated() << " block allocations\n";
+    } else if (shading) {
+        shading->scratch.arena(shading->shader).write_report(std::cerr,
+                                                             shader_name(shading->shader));
+    } else {
+        raster.arena.write_report(std::cerr, "raster");
+    }
+#endif
+}
+
+// 多帧模式: 第 i 帧用 transforms[i] 变换模型后渲染
+// 帧缓冲 (写线程的帧槽)、深度缓冲与光栅化的中间结果在各帧间复用, 第一帧之后渲染线程不再分配内存
+// 输出吞吐 (帧/秒) 与单帧延迟的 p50 / p99, 单帧延迟为从取帧槽到提交给写线程的时间,
+// 包括写线程积压时等待空闲帧槽的时间
+// frame_stats 不为空时只保留最后一帧的统计
+// edges 不为空时画线框, 深度缓冲保持清空的状态; shading 不为空时用可编程管线渲染
+bool render_sequence(const Model &model, const std::vector<Affine3f> &transforms,
+                     RasterOptions options, const std::vector<Edge> *edges,
+                     ShadingSetup *shading,
+                     FrameWriter<PixelFormat::RGB> &writer, DepthBuffer &depth_buffer,
+                     const std::string &output, const std::string &depth_output) {
+    using clock = std::chrono::steady_clock;
+    const int frames = transforms.size();
+    FrameStats *frame_stats = options.stats;
+    RasterScratch scratch;
+    WireframeScratch wireframe_scratch;
+    options.scratch = &scratch;
+    std::vector<double> latency_ms(frames);
+
+    const auto sequence_start = clock::now();
+    for (int i = 0; i < frames; ++i) {
+        const auto frame_start = clock::now();
+        if (frame_stats)
+            frame_stats->begin_frame(depth_buffer.get_width(), depth_buffer.get_height());
+        auto &frame = writer.acquire();
+        frame.color.clear();
+        depth_buffer.clear();
+        if (options.msaa && !edges) options.msaa->clear();
+
+        options.transform = &transforms[i];
+        if (edges) {
+            wireframe_rasterize(model, *edges, frame.color, pack_color(white),
+                                options.transform, &wireframe_scratch);
+        } else if (shading) {
+            render_shaded_frame(model, *shading, options.transform, frame.color, depth_buffer,
+                                options.hierarchical_z, frame_stats);
+        } else {
+            rasterize(model, frame.color, depth_buffer, options);
+        }
+
+        format_frame_name(output, i, frame.filename);
+        if (writer.wants_depth()) {
+            depth_buffer.to_grayscale(frame.depth.data());
+            format_frame_name(depth_output, i, frame.depth_filename);
         }
+        writer.submit(frame);
+        latency_ms[i] =
+            std::chrono::duration<double, std::milli>(clock::now() - frame_start).count();
     }
+    writer.flush();
+    const double total_ms =
+        std::chrono::duration<double, std::milli>(clock::now() - sequence_start).count();
+
+    // 最近秩法求百分位数
+    std::sort(latency_ms.begin(), latency_ms.end());
+    auto percentile = [&](int p) {
+        const int rank = (static_cast<long long>(p) * frames + 99) / 100;
+        return latency_ms[std::max(rank, 1) - 1];
+    };
+    std::cerr << "rendered " << frames << " frames (" << depth_buffer.get_width() << "x"
+              << depth_buffer.get_height() << ", "
+              << (edges     ? "wireframe"
+                  : shading ? shader_name(shading->shader)
+                            : raster_path_name(options.path))
+              << ") in " << total_ms << " ms: " << frames * 1000.0 / total_ms
+              << " fps, frame latency p50 " << percentile(50) << " ms, p99 "
+              << percentile(99) << " ms\n";
+    if (writer.get_dropped_depth())
+        std::cerr << "dropped " << writer.get_dropped_depth()
+                  << " depth dumps while the writer was busy\n";
+    report_arenas(scratch, wireframe_scratch, edges, shading);
+    return !writer.get_failed();
+}
+
+// 流式模式: 不把模型读入内存, 读线程逐块读取, 渲染线程逐块光栅化到同一帧后写出
+// 输出端到端时间 (含读取与解码)、三角形吞吐、等待读线程的时间与进程的峰值常驻内存,
+// 用于与先加载整个模型再渲染的路径对比
+bool render_streamed(const std::string &model_path, const MeshStreamOptions &stream_options,
+                     RasterOptions options, FrameWriter<PixelFormat::RGB> &writer,
+                     DepthBuffer &depth_buffer, const std::string &output,
+                     const std::string &depth_output) {
+    RasterScratch scratch;
+    options.scratch = &scratch;
+    auto &frame = writer.acquire();
+    frame.color.clear();
+    const auto start = std::chrono::steady_clock::now();
+    MeshStream stream(model_path, stream_options);
+    const StreamRenderResult result = render_stream(stream, frame.color, depth_buffer, options);
+    const double ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+    constexpr double mb = 1 << 20;
+    std::cerr << "stream: " << result.triangles << " triangles in " << result.chunks
+              << " chunks (" << stream.bytes_read() / mb << " MB read, "
+              << (result.triangles ? static_cast<double>(stream.encoded_bytes()) /
+                                         result.triangles
+                                   : 0.0)
+              << " encoded bytes per triangle) in " << ms << " ms: "
+              << (ms > 0 ? result.triangles / ms / 1000 : 0.0) << " Mtriangles/s, waited "
+              << stream.wait_ms() << " ms for the reader\n";
+    std::cerr << "raster path: " << raster_path_name(options.path)
+              << ", depth-tested pixels: " << result.tested << '\n';
+    std::cerr << "peak RSS: " << peak_resident_bytes() / mb << " MB\n";
+#ifdef RENDERER_ARENA_DEBUG
+    scratch.arena.write_report(std::cerr, "stream");
+#endif
+    if (!result.ok) {
+        writer.submit(frame); // 文件名为空, 直接回收
+        return false;
+    }
+    frame.filename = output;
+    if (writer.wants_depth()) {
+        depth_buffer.to_grayscale(frame.depth.data());
+        frame.depth_filename = depth_output;
+    }
+    writer.submit(frame);
+    writer.flush();
+    return !writer.get_failed();
 }
 
-void rasterize(const Model &model, TgaImage &frame_buffer, TgaImage &z_buffer) {
-    std::srand(std::time({}));
-    for (int i = 0; i < model.num_faces(); ++i) {
-        TgaColor color;
-        for (int j = 0; j < 3; ++j) color[j] = rand() % 255;
-
-        auto p0 = model.vertex(i, 0);
-        auto p1 = model.vertex(i, 1);
-        auto p2 = model.vertex(i, 2);
-
-        // 视口变换
-        // NDC -> 屏幕空间坐标
-        auto [ax, ay, az] = viewport_trans(p0, width, height);
-        auto [bx, by, bz] = viewport_trans(p1, width, height);
-        auto [cx, cy, cz] = viewport_trans(p2, width, height);
-
-        // 背面剔除
-        // 背面剔除应该使用世界坐标来做
-        // 但是目前渲染条件为: 右手坐标系, 使用的模型局部坐标均在 [-1, 1]^3, 直接拿来当作 NDC 坐标
-        // 右手坐标系, 如果使用的模型的局部坐标在 [-1, 1]^3, 那么将其直接拿来当作 NDC 坐标，这相当于自动进行了下面操作
-        // 1. 不进行模型变换，局部坐标就是世界坐标
-        // 2. 接着进行了相机在 z 轴某个能看清出模型全貌(就是和模型不重合)的位置, 
-        // x, y, z 轴与世界坐标的 x, y, z 轴相同方向的视图变换
-        // 3. 然后进行了选取合适的长方体进行正交投影变换得到 NDC, 
-        // 并且这个合适的长方体使得模型各点的 NDC 坐标与模型局部坐标相同的正交投影变换。
-        // 所以在目前相机看向 z 轴负方向且使用正交投影的特定条件下，
-        // 视口变换后的屏幕空间背面剔除是可行的，结果与世界坐标剔除等价。
-        // 这是因为正交投影保留了三维空间中 z 轴方向的朝向关系，
-        // 屏幕空间的顶点顺序和法向量分量可直接用于背面判定。
-        // 但需注意，当投影方式或观察方向改变时，仍需在三维坐标空间中执行标准背面剔除。
-        Vec3f AB{bx - ax, by - ay, 0};
-        Vec3f AC{cx - ax, cy - ay, 0};
-        float z = AB.cross(AC).z;
-        constexpr float epsilon = 1e-6f;
-        // 当前使用的模型按照右手坐标系, 逆时针绕序为正面
-        // 叉积法判断三角形退化 |z| < epsilon 和背面剔除 z < 0 一起做
-        if (z < epsilon) continue;
-
-        triangle_rasterize(Vec3f{ax, ay, az}, Vec3f{bx, by, bz}, Vec3f{cx, cy, cz}, frame_buffer, z_buffer, color);
+// 输出统计, path 为空时输出到标准输出
+bool write_stats(const FrameStats &stats, const std::string &path) {
+    if (path.empty()) {
+        stats.write_json(std::cout);
+        return true;
+    }
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open file " << path << ".\n";
+        return false;
     }
+    stats.write_json(out);
+    return true;
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " Path/to/filename.obj\n";
+    RasterOptions options;
+    int width = default_width, height = default_height;
+    int frames = 0;          // 大于 0 时为转台模式
+    float scale = 1.f;       // 转台模式的缩放
+    std::string camera_path; // 不为空时按相机路径渲染多帧
+    std::string output, depth_output;
+    std::string batch_path; // 不为空时为批量模式
+    int batch_threads = 0;
+    int msaa_samples = 0; // 4 或 8 时多重采样抗锯齿
+    bool use_shader = false; // 使用可编程管线
+    ShaderKind shader = ShaderKind::PHONG;
+    bool perspective = false;
+    float fovy = 45.f;
+    DepthDump dump_depth = DepthDump::NONE;
+    bool wireframe = false;
+    bool use_meshlets = false;
+    bool optimize = false; // 加载后重排面与顶点
+    MeshOptimizeOptions optimize_options;
+    bool bake_cache = false;
+    bool stream = false;      // 流式渲染, 不把整个模型读入内存
+    bool bake_chunks = false; // 把 OBJ 转换为 .cmesh 分块网格
+    MeshStreamOptions stream_options;
+    bool collect_stats = false;
+    std::string stats_path; // 为空时统计输出到标准输出
+    std::string texture_path; // 不为空时用该漫反射纹理着色
+    std::string model_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--raster=", 0) == 0) {
+            if (!parse_raster_path(arg.substr(9), options.path)) {
+                std::cerr << "Unknown raster path " << arg.substr(9) << '\n';
+                return 1;
+            }
+        } else if (arg == "--wireframe") {
+            wireframe = true;
+        } else if (arg == "--optimize" || arg == "--optimize=overdraw") {
+            optimize = true;
+            optimize_options.overdraw = arg.size() > 10;
+        } else if (arg == "--meshlets") {
+            use_meshlets = true;
+        } else if (arg == "--visibility") {
+            options.visibility_buffer = true;
+        } else if (arg.rfind("--msaa=", 0) == 0) {
+            msaa_samples = std::atoi(arg.c_str() + 7);
+            if (!is_valid_msaa_samples(msaa_samples)) {
+                std::cerr << "Invalid sample count " << arg.substr(7) << ", expected 4 or 8\n";
+                return 1;
+            }
+        } else if (arg.rfind("--shader=", 0) == 0) {
+            use_shader = true;
+            if (!parse_shader(arg.substr(9), shader)) {
+                std::cerr << "Unknown shader " << arg.substr(9) << '\n';
+                return 1;
+            }
+        } else if (arg == "--perspective" || arg.rfind("--perspective=", 0) == 0) {
+            perspective = true;
+            if (arg.size() > 14) fovy = std::strtof(arg.c_str() + 14, nullptr);
+            if (!(fovy > 0.f && fovy < 180.f)) {
+                std::cerr << "Invalid field of view " << arg.substr(14) << '\n';
+                return 1;
+            }
+        } else if (arg.rfind("--texture=", 0) == 0) {
+            texture_path = arg.substr(10);
+        } else if (arg == "--no-hiz") {
+            options.hierarchical_z = false;
+        } else if (arg == "--dump-depth") {
+            dump_depth = DepthDump::ALWAYS;
+        } else if (arg == "--dump-depth=if-idle") {
+            dump_depth = DepthDump::IF_IDLE;
+        } else if (arg == "--bake-cache") {
+            bake_cache = true;
+        } else if (arg == "--stream") {
+            stream = true;
+        } else if (arg == "--bake-chunks") {
+            bake_chunks = true;
+        } else if (arg.rfind("--chunk-triangles=", 0) == 0) {
+            stream_options.chunk_triangles = std::atoi(arg.c_str() + 18);
+            if (stream_options.chunk_triangles <= 0 ||
+                stream_options.chunk_triangles > max_chunk_triangles / 2) {
+                std::cerr << "Invalid chunk size " << arg.substr(18) << '\n';
+                return 1;
+            }
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            options.color_seed = std::strtoul(arg.c_str() + 7, nullptr, 10);
+        } else if (arg == "--stats" || arg.rfind("--stats=", 0) == 0) {
+            collect_stats = true;
+            if (arg.size() > 8) stats_path = arg.substr(8);
+        } else if (arg.rfind("--size=", 0) == 0) {
+            if (std::sscanf(arg.c_str() + 7, "%dx%d", &width, &height) != 2 ||
+                !valid_frame_size(width, height)) {
+                std::cerr << "Invalid size " << arg.substr(7) << ", expected WxH\n";
+                return 1;
+            }
+        } else if (arg.rfind("--frames=", 0) == 0) {
+            frames = std::atoi(arg.c_str() + 9);
+            if (frames <= 0) {
+                std::cerr << "Invalid frame count " << arg.substr(9) << '\n';
+                return 1;
+            }
+        } else if (arg.rfind("--scale=", 0) == 0) {
+            scale = std::strtof(arg.c_str() + 8, nullptr);
+        } else if (arg.rfind("--camera-path=", 0) == 0) {
+            camera_path = arg.substr(14);
+        } else if (arg.rfind("--output=", 0) == 0) {
+            output = arg.substr(9);
+        } else if (arg.rfind("--depth-output=", 0) == 0) {
+            depth_output = arg.substr(15);
+        } else if (arg.rfind("--batch=", 0) == 0) {
+            batch_path = arg.substr(8);
+        } else if (arg.rfind("--jobs=", 0) == 0) {
+            batch_threads = std::atoi(arg.c_str() + 7);
+        } else if (model_path.empty()) {
+            model_path = arg;
+        } else {
+            model_path.clear();
+            break;
+        }
+    }
+    // 批量模式: 按任务清单渲染多个模型, 各任务的分辨率与输出文件由清单给出
+    if (!batch_path.empty()) {
+        if (!model_path.empty()) {
+            std::cerr << "--batch takes its models from the manifest\n";
+            return 1;
+        }
+        std::vector<BatchJob> jobs;
+        if (!read_batch_manifest(batch_path, jobs)) return 1;
+        BatchRenderer renderer(batch_threads);
+        const BatchResult result = renderer.render(jobs, options);
+        std::cerr << "batch: " << jobs.size() << " jobs (" << result.failed
+                  << " failed) on " << renderer.get_threads() << " threads in "
+                  << result.ms << " ms: "
+                  << (result.ms > 0 ? jobs.size() * 1000.0 / result.ms : 0.0)
+                  << " jobs/s\n";
+        return result.failed ? 1 : 0;
+    }
+
+    if (model_path.empty()) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--raster=auto|barycentric|scalar|sse|avx2] [--no-hiz] [--wireframe]"
+                     " [--optimize[=overdraw]] [--meshlets] [--visibility] [--texture=diffuse.tga]"
+                     " [--msaa=4|8] [--shader=flat|gouraud|phong [--perspective[=fovy]]]"
+                     " [--dump-depth[=if-idle]]"
+                     " [--seed=N] [--stats[=file.json]]"
+                     " [--size=WxH] [--output=file.tga] [--depth-output=file.tga]"
+                     " Path/to/filename.obj|.smesh\n"
+                  << "       " << argv[0]
+                  << " --frames=N [--scale=F] | --camera-path=file.txt"
+                     " [--output=frame_%04d.tga] [--depth-output=z_%04d.tga]"
+                     " [options] Path/to/filename.obj|.smesh\n"
+                  << "       " << argv[0]
+                  << " --batch=manifest.txt [--jobs=N] [--raster=...] [--no-hiz]"
+                     " [--visibility] [--seed=N]\n"
+                  << "       " << argv[0]
+                  << " --bake-cache [--optimize[=overdraw]] Path/to/filename.obj\n"
+                  << "       " << argv[0]
+                  << " --stream [--chunk-triangles=N] [--raster=...] [--no-hiz] [--seed=N]"
+                     " [--stats[=file.json]] [--size=WxH] [--output=file.tga]"
+                     " [--depth-output=file.tga] Path/to/filename.obj|.cmesh\n"
+                  << "       " << argv[0]
+                  << " --bake-chunks [--chunk-triangles=N] Path/to/filename.obj\n";
         return 1;
     }
 
-    TgaImage frame_buffer(width, height, TgaImage::RGB);
-    TgaImage z_buffer(width, height, TgaImage::GRAYSCALE);
+    // 多帧模式: 转台或相机路径, 渲染前生成全部帧的变换
+    const bool sequence = frames > 0 || !camera_path.empty();
+    std::vector<Affine3f> transforms;
+    if (!camera_path.empty()) {
+        if (!read_camera_path(camera_path, transforms)) return 1;
+    } else if (frames > 0) {
+        turntable(frames, scale, transforms);
+    }
+    if (output.empty()) output = sequence ? "frame_%04d.tga" : "frame_buffer.tga";
+    if (depth_output.empty()) depth_output = sequence ? "z_%04d.tga" : "z_buffer.tga";
+    if (sequence && (!is_frame_pattern(output) || !is_frame_pattern(depth_output))) {
+        std::cerr << "Output patterns must contain exactly one integer conversion, "
+                     "e.g. frame_%04d.tga\n";
+        return 1;
+    }
+
+    if (collect_stats && !stats_compiled) {
+        std::cerr << "Statistics were disabled at build time (RENDERER_STATS=OFF), "
+                     "ignoring --stats\n";
+        collect_stats = false;
+    }
+    FrameStats stats;
+    FrameStats *frame_stats = collect_stats ? &stats : nullptr;
+    if (frame_stats) frame_stats->begin_frame(width, height);
+    options.stats = frame_stats;
 
-    Model model(argv[1]);
+    // 帧缓冲由写线程的帧槽持有, 编码与写盘在后台进行
+    FrameWriterOptions writer_options;
+    writer_options.depth = dump_depth;
+    FrameWriter<PixelFormat::RGB> writer(width, height, writer_options);
+    DepthBuffer depth_buffer = [&] {
+        RENDERER_STAGE_TIMER(frame_stats, Stage::DEPTH);
+        return DepthBuffer(width, height);
+    }();
 
-    auto start = std::chrono::high_resolution_clock::now();
-    rasterize(model, frame_buffer, z_buffer);
-    auto end = std::chrono::high_resolution_clock::now();
-    float duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    std::cerr << "rasterization time cost: " << duration / 1000 << " ms\n";
+    // 转换模式: 把 OBJ 流式写成同名的 .cmesh 分块网格后退出, 不加载整个模型
+    if (bake_chunks) {
+        if (is_chunked_mesh_path(model_path) || is_mesh_cache_path(model_path)) {
+            std::cerr << "--bake-chunks converts an OBJ file\n";
+            return 1;
+        }
+        const std::string chunked = chunked_mesh_path(model_path);
+        if (!write_chunked_mesh(model_path, chunked, stream_options)) return 1;
+        std::cerr << "Wrote chunked mesh " << chunked << '\n';
+        return 0;
+    }
+    // 流式模式只渲染一帧, 只支持直接写颜色的 rasterize 路径
+    if (stream) {
+        if (sequence) {
+            std::cerr << "--stream renders a single frame\n";
+            return 1;
+        }
+        if (wireframe || use_shader || use_meshlets || optimize ||
+            options.visibility_buffer || !texture_path.empty() || msaa_samples)
+            std::cerr << "--stream ignores --wireframe, --shader, --meshlets, --optimize, "
+                         "--visibility, --texture and --msaa\n";
+        if (is_mesh_cache_path(model_path)) {
+            std::cerr << "--stream reads .obj or .cmesh files\n";
+            return 1;
+        }
+        options.path = select_raster_path(options.path);
+        if (!render_streamed(model_path, stream_options, options, writer, depth_buffer, output,
+                             depth_output))
+            return 1;
+        return frame_stats && !write_stats(*frame_stats, stats_path) ? 1 : 0;
+    }
+
+    const auto load_start = std::chrono::steady_clock::now();
+    Model model = [&] {
+        RENDERER_STAGE_TIMER(frame_stats, Stage::LOAD);
+        return Model(model_path);
+    }();
+    const double load_ms = std::chrono::duration<double, std::milli>(
+                               std::chrono::steady_clock::now() - load_start)
+                               .count();
+
+    // 网格优化: 打印优化前后的顶点缓存未命中率, 优化结果可以随 --bake-cache 写入缓存
+    if (optimize) {
+        RENDERER_STAGE_TIMER(frame_stats, Stage::LOAD);
+        const VertexCacheStats before = vertex_cache_stats(model);
+        auto start = std::chrono::steady_clock::now();
+        if (optimize_mesh(model, optimize_options)) {
+            auto end = std::chrono::steady_clock::now();
+            const VertexCacheStats after = vertex_cache_stats(model);
+            std::cerr << "optimize" << (optimize_options.overdraw ? " (overdraw)" : "")
+                      << ": ACMR " << before.acmr << " -> " << after.acmr << ", ATVR "
+                      << before.atvr << " -> " << after.atvr << " in "
+                      << std::chrono::duration<double, std::milli>(end - start).count()
+                      << " ms\n";
+        } else {
+            std::cerr << "optimize: mesh is already optimized, ACMR " << before.acmr << '\n';
+        }
+    }
+
+    // 转换模式: 把 OBJ 写成同名的 .smesh 网格缓存后退出
+    if (bake_cache) {
+        if (is_mesh_cache_path(model_path) || !model.num_faces()) {
+            std::cerr << "Nothing to bake from " << model_path << '\n';
+            return 1;
+        }
+        const std::string cache = mesh_cache_path(model_path);
+        if (!model.write_cache(cache, model_path)) return 1;
+        std::cerr << "Wrote mesh cache " << cache << '\n';
+        return 0;
+    }
+
+    options.path = select_raster_path(options.path);
+    // 纹理: 加载时转换为分块存放并生成 mip 链, 各帧共用
+    Texture texture;
+    if (!texture_path.empty() && !wireframe) {
+        auto start = std::chrono::steady_clock::now();
+        if (!texture.load(texture_path)) return 1;
+        auto end = std::chrono::steady_clock::now();
+        std::cerr << "texture: " << texture.get_width() << "x" << texture.get_height() << ", "
+                  << texture.num_levels() << " levels, built in "
+                  << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+        if (!model.num_tex_coords())
+            std::cerr << "Model has no texture coordinates, ignoring --texture\n";
+        options.texture = &texture;
+    }
+    // 簇剔除: 划分一次, 各帧共用
+    Meshlets meshlets;
+    if (use_meshlets && !wireframe) {
+        auto start = std::chrono::steady_clock::now();
+        build_meshlets(model, meshlets);
+        auto end = std::chrono::steady_clock::now();
+        std::cerr << "meshlets: " << meshlets.meshlets.size() << " clusters, "
+                  << (meshlets.meshlets.empty()
+                          ? 0.0
+                          : static_cast<double>(meshlets.faces.size()) / meshlets.meshlets.size())
+                  << " faces per cluster, built in "
+                  << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+        options.meshlets = &meshlets;
+    }
+    // 多重采样缓冲: 各帧共用, 每帧与帧缓冲一起清空
+    MsaaBuffer msaa;
+    if (msaa_samples && !wireframe) {
+        msaa = MsaaBuffer(width, height, msaa_samples);
+        options.msaa = &msaa;
+    }
+    // 可编程管线: 相机与中间结果各帧共用, 不支持 --meshlets / --visibility / --texture / --msaa
+    ShadingSetup shading;
+    shading.shader = shader;
+    setup_camera(shading, perspective, fovy, width, height);
+    ShadingSetup *shading_setup = use_shader && !wireframe ? &shading : nullptr;
+    if (shading_setup && (options.meshlets || options.visibility_buffer || options.texture ||
+                          options.msaa))
+        std::cerr << "--shader ignores --meshlets, --visibility, --texture and --msaa\n";
+    // 线框模式: 边只取一次, 各帧共用
+    std::vector<Edge> edges;
+    if (wireframe) extract_edges(model, edges);
+    if (sequence) {
+        if (!render_sequence(model, transforms, options, wireframe ? &edges : nullptr,
+                             shading_setup, writer, depth_buffer, output, depth_output))
+            return 1;
+    } else {
+        RasterScratch scratch;
+        WireframeScratch wireframe_scratch;
+        options.scratch = &scratch;
+        auto &frame = writer.acquire();
+        Framebuffer<PixelFormat::RGB> &frame_buffer = frame.color;
+        frame_buffer.clear();
+        auto start = std::chrono::high_resolution_clock::now();
+        std::int64_t tested =
+            wireframe       ? wireframe_rasterize(model, edges, frame_buffer, pack_color(white),
+                                                  nullptr, &wireframe_scratch)
+            : shading_setup ? render_shaded_frame(model, *shading_setup, nullptr, frame_buffer,
+                                                  depth_buffer, options.hierarchical_z,
+                                                  frame_stats)
+                            : rasterize(model, frame_buffer, depth_buffer, options);
+        auto end = std::chrono::high_resolution_clock::now();
+        float duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        std::cerr << "rasterization time cost: " << duration / 1000 << " ms\n";
+        if (wireframe) {
+            std::cerr << "wireframe: " << edges.size() << " edges, " << tested
+                      << " pixels drawn\n";
+        } else {
+            // 每秒做深度测试的像素数, 用于对比不同内循环实现的吞吐
+            if (shading_setup) {
+                std::cerr << "shader: " << shader_name(shading_setup->shader)
+                          << (perspective ? ", perspective" : ", orthographic");
+            } else {
+                std::cerr << "raster path: " << raster_path_name(options.path);
+            }
+            if (options.msaa) std::cerr << ", msaa " << options.msaa->get_samples() << "x";
+            std::cerr << ", depth-tested pixels: " << tested << " ("
+                      << (duration > 0 ? tested / duration : 0.f)
+                      << " Mpixels/s)\n";
+            // 着色的片元与做了深度测试的片元, 可见性缓冲模式下每个可见像素只着色一次
+            if (frame_stats) {
+                const ThreadStats sum = frame_stats->total();
+                std::cerr << (options.visibility_buffer ? "visibility buffer" : "forward")
+                          << ": shaded " << sum.pixels_shaded << " of " << sum.pixels_tested
+                          << " rasterized fragments ("
+                          << (sum.pixels_shaded ? static_cast<double>(sum.pixels_tested) /
+                                                      sum.pixels_shaded
+                                                : 0.0)
+                          << "x)\n";
+            }
+        }
+
+        // 与 --stream 对比内存占用: 整个模型在内存中
+        std::cerr << "load time: " << load_ms << " ms, peak RSS: "
+                  << peak_resident_bytes() / static_cast<double>(1 << 20) << " MB\n";
+        report_arenas(scratch, wireframe_scratch, wireframe, shading_setup);
+
+        RENDERER_STAGE_TIMER(frame_stats, Stage::WRITE);
+        frame.filename = output;
+        // 深度缓冲只在调试时导出
+        if (writer.wants_depth()) {
+            depth_buffer.to_grayscale(frame.depth.data());
+            frame.depth_filename = depth_output;
+        }
+        writer.submit(frame);
+        writer.flush();
+        if (writer.get_failed()) return 1;
+    }
 
-    frame_buffer.write_tga_file("frame_buffer.tga");
-    z_buffer.write_tga_file("z_buffer.tga");
+    if (frame_stats && !write_stats(*frame_stats, stats_path)) return 1;
 
     return 0;
 }
\ No newline at end of file
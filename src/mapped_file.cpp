@@ -0,0 +1,129 @@
+#include "mapped_file.h"
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// 空文件无法映射, 用一个空字符串代替, 使 is_open() 仍为 true
+const char empty_file[1] = {0};
+} // namespace
+
+MappedFile::MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+#ifdef _WIN32
+        std::swap(file_handle_, other.file_handle_);
+        std::swap(mapping_handle_, other.mapping_handle_);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &filename, bool copy_on_write) {
+    close();
+
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                              nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    if (size.QuadPart == 0) {
+        CloseHandle(file);
+        data_ = empty_file;
+        return true;
+    }
+
+    HANDLE mapping =
+        CreateFileMappingA(file, nullptr,
+                           copy_on_write ? PAGE_WRITECOPY : PAGE_READONLY, 0,
+                           0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    const void *view = MapViewOfFile(
+        mapping, copy_on_write ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_handle_ = file;
+    mapping_handle_ = mapping;
+    data_ = static_cast<const char *>(view);
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_ && data_ != empty_file) UnmapViewOfFile(data_);
+    if (mapping_handle_) CloseHandle(mapping_handle_);
+    if (file_handle_) CloseHandle(file_handle_);
+    data_ = nullptr;
+    size_ = 0;
+    file_handle_ = nullptr;
+    mapping_handle_ = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string &filename, bool copy_on_write) {
+    close();
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        ::close(fd);
+        data_ = empty_file;
+        return true;
+    }
+
+    const int protection = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+    void *view = mmap(nullptr, st.st_size, protection, MAP_PRIVATE, fd, 0);
+    // 映射建立后文件描述符可以关闭
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    // 解析是顺序扫描, 提示内核预读
+    madvise(view, st.st_size, MADV_SEQUENTIAL);
+
+    data_ = static_cast<const char *>(view);
+    size_ = static_cast<std::size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_ && data_ != empty_file)
+        munmap(const_cast<char *>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+}
+
+#endif
@@ -0,0 +1,253 @@
+#include "mesh_cache.h"
+#include "model.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+static_assert(sizeof(Vec3f) == 12 && sizeof(Vec2f) == 8,
+              "mesh cache stores Vec3f / Vec2f as packed floats");
+
+std::string mesh_cache_path(const std::string &obj_filename) {
+    return fs::path(obj_filename).replace_extension(".smesh").string();
+}
+
+bool is_mesh_cache_path(const std::string &filename) {
+    return fs::path(filename).extension() == ".smesh";
+}
+
+namespace {
+
+// 缓存中记录的源文件名相对缓存所在目录
+std::string resolve_source(const std::string &cache_filename,
+                           const char *name, std::size_t length) {
+    if (!length) return {};
+    return (fs::path(cache_filename).parent_path() / std::string(name, length))
+        .string();
+}
+
+} // namespace
+
+std::string mesh_cache_source(const std::string &cache_filename) {
+    std::ifstream in(cache_filename, std::ios::binary);
+    MeshCacheHeader header;
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (!in.good() ||
+        std::memcmp(header.magic, mesh_cache_magic, sizeof(header.magic)) ||
+        header.endian_tag != mesh_cache_endian_tag)
+        return {};
+    std::string name(header.source_name_length, '\0');
+    in.read(name.data(), name.size());
+    if (!in.good()) return {};
+    return resolve_source(cache_filename, name.data(), name.size());
+}
+
+bool source_stamp(const std::string &filename, std::uint64_t &size,
+                  std::int64_t &mtime) {
+    std::error_code ec;
+    size = fs::file_size(filename, ec);
+    if (ec) return false;
+    mtime = fs::last_write_time(filename, ec).time_since_epoch().count();
+    return !ec;
+}
+
+std::uint64_t hash_file(const std::string &filename) {
+    MappedFile file;
+    if (!file.open(filename)) return 0;
+
+    std::uint64_t hash = 0xcbf29ce484222325ull;
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(file.data());
+    for (std::size_t i = 0; i < file.size(); ++i) {
+        hash ^= p[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+namespace {
+
+// 检查缓存是否与源文件一致
+// 源文件不存在或无法读取时无从比较, 也没有可回退的 OBJ, 输出警告后仍使用缓存
+bool is_cache_fresh(const MeshCacheHeader &header, const std::string &filename,
+                    const std::string &source) {
+    std::uint64_t size;
+    std::int64_t mtime;
+    if (!source_stamp(source, size, mtime)) {
+        std::cerr << "Warning: cannot stat " << source << ", using mesh cache "
+                  << filename << " without checking that it is up to date.\n";
+        return true;
+    }
+    if (size != header.source_size) return false;
+    if (mtime == header.source_mtime) return true;
+    // 修改时间变了但大小相同 (例如重新检出), 用内容哈希确认
+    return hash_file(source) == header.source_hash;
+}
+
+template <typename T>
+bool map_section(MeshArray<T> &array, const MeshCacheHeader &header,
+                 MeshCacheSection section, char *base, std::size_t file_size) {
+    const std::uint64_t count = header.counts[section];
+    const std::uint64_t offset = header.offsets[section];
+    if (offset % alignof(T) || offset > file_size ||
+        count > (file_size - offset) / sizeof(T))
+        return false;
+    array.view(reinterpret_cast<T *>(base + offset), count);
+    return true;
+}
+
+// 索引全部在 [min_index, count) 内
+// 面的顶点索引 min_index 为 0, 纹理坐标与法线索引为 -1 (未给出)
+// 损坏的缓存即使各段大小一致, 索引也可能越界, 加载时线性检查一遍
+bool indices_in_range(const MeshArray<int> &indices, int min_index,
+                      std::size_t count) {
+    const int *data = indices.data();
+    const std::int64_t n = indices.size();
+    const std::int64_t max_index = static_cast<std::int64_t>(count) - 1;
+    bool ok = true;
+#pragma omp parallel for schedule(static) reduction(&& : ok)
+    for (std::int64_t i = 0; i < n; ++i)
+        ok = ok && data[i] >= min_index && data[i] <= max_index;
+    return ok;
+}
+
+} // namespace
+
+bool Model::load_cache(const std::string &filename, const std::string &source) {
+    MappedFile file;
+    // 以写时复制方式映射, 修改模型数据时只复制被写的页, 不会写回文件
+    if (!file.open(filename, true)) return false;
+
+    MeshCacheHeader header;
+    if (file.size() < sizeof(header)) return false;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, mesh_cache_magic, sizeof(header.magic)) ||
+        header.version != mesh_cache_version ||
+        header.endian_tag != mesh_cache_endian_tag ||
+        sizeof(header) + header.source_name_length > file.size()) {
+        std::cerr << "Invalid mesh cache " << filename << ".\n";
+        return false;
+    }
+
+    // 没有指定源文件时使用缓存中记录的文件名
+    std::string source_path = source;
+    if (source_path.empty()) {
+        source_path = resolve_source(filename, file.data() + sizeof(header),
+                                     header.source_name_length);
+    }
+    if (!source_path.empty() &&
+        !is_cache_fresh(header, filename, source_path)) {
+        std::cerr << "Mesh cache " << filename << " is stale.\n";
+        return false;
+    }
+
+    char *base = const_cast<char *>(file.data());
+    MeshArray<Vec3f> vertices, normals;
+    MeshArray<Vec2f> tex_coords;
+    MeshArray<int> faces, face_tex_coords, face_normals;
+    if (!map_section(vertices, header, VERTICES, base, file.size()) ||
+        !map_section(tex_coords, header, TEX_COORDS, base, file.size()) ||
+        !map_section(normals, header, NORMALS, base, file.size()) ||
+        !map_section(faces, header, FACES, base, file.size()) ||
+        !map_section(face_tex_coords, header, FACE_TEX_COORDS, base, file.size()) ||
+        !map_section(face_normals, header, FACE_NORMALS, base, file.size()) ||
+        faces.size() % 3 || face_tex_coords.size() != faces.size() ||
+        face_normals.size() != faces.size() || vertices.size() > INT_MAX ||
+        tex_coords.size() > INT_MAX || normals.size() > INT_MAX ||
+        faces.size() > INT_MAX ||
+        !indices_in_range(faces, 0, vertices.size()) ||
+        !indices_in_range(face_tex_coords, -1, tex_coords.size()) ||
+        !indices_in_range(face_normals, -1, normals.size())) {
+        std::cerr << "Invalid mesh cache " << filename << ".\n";
+        return false;
+    }
+
+    vertices_ = std::move(vertices);
+    tex_coords_ = std::move(tex_coords);
+    normals_ = std::move(normals);
+    faces_ = std::move(faces);
+    face_tex_coords_ = std::move(face_tex_coords);
+    face_normals_ = std::move(face_normals);
+    cache_file_ = std::move(file);
+    optimizations_ = header.optimizations;
+    return true;
+}
+
+bool Model::write_cache(const std::string &filename,
+                        const std::string &source) const {
+    MeshCacheHeader header;
+    std::memcpy(header.magic, mesh_cache_magic, sizeof(header.magic));
+    header.version = mesh_cache_version;
+    header.endian_tag = mesh_cache_endian_tag;
+    if (!source_stamp(source, header.source_size, header.source_mtime)) {
+        std::cerr << "Failed to stat " << source << ".\n";
+        return false;
+    }
+    header.source_hash = hash_file(source);
+
+    const std::string source_name = fs::path(source).filename().string();
+    header.source_name_length = source_name.size();
+    header.optimizations = optimizations_;
+
+    const void *sections[MESH_CACHE_SECTIONS] = {
+        vertices_.data(), tex_coords_.data(),      normals_.data(),
+        faces_.data(),    face_tex_coords_.data(), face_normals_.data()};
+    const std::uint64_t element_sizes[MESH_CACHE_SECTIONS] = {
+        sizeof(Vec3f), sizeof(Vec2f), sizeof(Vec3f),
+        sizeof(int),   sizeof(int),   sizeof(int)};
+    header.counts[VERTICES] = vertices_.size();
+    header.counts[TEX_COORDS] = tex_coords_.size();
+    header.counts[NORMALS] = normals_.size();
+    header.counts[FACES] = faces_.size();
+    header.counts[FACE_TEX_COORDS] = face_tex_coords_.size();
+    header.counts[FACE_NORMALS] = face_normals_.size();
+
+    auto align = [](std::uint64_t offset) {
+        return (offset + mesh_cache_alignment - 1) / mesh_cache_alignment *
+               mesh_cache_alignment;
+    };
+    std::uint64_t offset = sizeof(header) + source_name.size();
+    for (int i = 0; i < MESH_CACHE_SECTIONS; ++i) {
+        offset = align(offset);
+        header.offsets[i] = offset;
+        offset += header.counts[i] * element_sizes[i];
+    }
+
+    // 先写临时文件再改名, 避免其它进程映射到写了一半的缓存
+    const std::string temp_filename = filename + ".tmp";
+    {
+        std::ofstream out(temp_filename, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open file " << temp_filename << ".\n";
+            return false;
+        }
+
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(source_name.data(), source_name.size());
+        std::uint64_t written = sizeof(header) + source_name.size();
+        const char padding[mesh_cache_alignment] = {};
+        for (int i = 0; i < MESH_CACHE_SECTIONS; ++i) {
+            out.write(padding, header.offsets[i] - written);
+            out.write(static_cast<const char *>(sections[i]),
+                      header.counts[i] * element_sizes[i]);
+            written = header.offsets[i] + header.counts[i] * element_sizes[i];
+        }
+        if (!out.good()) {
+            std::cerr << "An error occured while writing the mesh cache.\n";
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(temp_filename, filename, ec);
+    if (ec) {
+        std::cerr << "Failed to rename " << temp_filename << " to " << filename
+                  << ": " << ec.message() << ".\n";
+        fs::remove(temp_filename, ec);
+        return false;
+    }
+    return true;
+}
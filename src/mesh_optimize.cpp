@@ -0,0 +1,231 @@
+#include "mesh_optimize.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+// 顶点 -> 相邻面, CSR 格式, 面中重复出现的顶点对应重复的项
+struct VertexFaces {
+    std::vector<int> begin, faces;
+
+    explicit VertexFaces(const Model &model)
+        : begin(model.num_vertices() + 1, 0), faces(model.num_faces() * 3) {
+        const int n = model.num_faces() * 3;
+        for (int i = 0; i < n; ++i) ++begin[model.vertex_index(i / 3, i % 3) + 1];
+        for (int v = 0; v < model.num_vertices(); ++v) begin[v + 1] += begin[v];
+        std::vector<int> cursor(begin.begin(), begin.end() - 1);
+        for (int i = 0; i < n; ++i) faces[cursor[model.vertex_index(i / 3, i % 3)]++] = i / 3;
+    }
+};
+
+// Tipsify: 每次选一个扇心顶点, 输出它所有未输出的相邻面
+// 下一个扇心优先取刚输出的面中仍有未输出相邻面、且输出这些面后仍留在缓存中的最早进入缓存的顶点;
+// 没有时从最近输出过的顶点 (死路栈) 中找, 再没有时按编号顺序找下一个还有未输出面的顶点
+std::vector<int> tipsify(const Model &model, int cache_size) {
+    const int num_faces = model.num_faces();
+    const int num_vertices = model.num_vertices();
+    const VertexFaces adjacency(model);
+
+    // live[v]: 顶点 v 还未输出的相邻面个数; stamp[v]: 顶点 v 进入缓存的时间
+    std::vector<int> live(num_vertices), stamp(num_vertices, 0);
+    for (int v = 0; v < num_vertices; ++v)
+        live[v] = adjacency.begin[v + 1] - adjacency.begin[v];
+    std::vector<char> emitted(num_faces, 0);
+    std::vector<int> dead_end, candidates, order;
+    order.reserve(num_faces);
+    int time = cache_size + 1;
+    int cursor = 0;
+
+    auto skip_dead_end = [&]() {
+        while (!dead_end.empty()) {
+            const int v = dead_end.back();
+            dead_end.pop_back();
+            if (live[v] > 0) return v;
+        }
+        for (; cursor < num_vertices; ++cursor) {
+            if (live[cursor] > 0) return cursor++;
+        }
+        return -1;
+    };
+
+    int fan = skip_dead_end();
+    while (fan >= 0) {
+        candidates.clear();
+        for (int k = adjacency.begin[fan]; k < adjacency.begin[fan + 1]; ++k) {
+            const int face = adjacency.faces[k];
+            if (emitted[face]) continue;
+            emitted[face] = 1;
+            order.push_back(face);
+            for (int j = 0; j < 3; ++j) {
+                const int v = model.vertex_index(face, j);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - stamp[v] > cache_size) stamp[v] = time++;
+            }
+        }
+
+        fan = -1;
+        int best_priority = -1;
+        for (int v : candidates) {
+            if (live[v] <= 0) continue;
+            // 输出 v 的剩余面最多再让 2 * live[v] 个顶点进入缓存, 之后 v 仍在缓存中时优先取最早进入的
+            const int age = time - stamp[v];
+            const int priority = age + 2 * live[v] <= cache_size ? age : 0;
+            if (priority > best_priority) best_priority = priority, fan = v;
+        }
+        if (fan < 0) fan = skip_dead_end();
+    }
+    return order;
+}
+
+// 以面的顺序模拟 FIFO 缓存, 统计 [begin, end) 内的未命中次数
+// stamp 为各顶点进入缓存时的未命中计数, 由调用方初始化, 跨调用时延续缓存状态
+long long cache_misses(const Model &model, const int *order, int begin, int end,
+                       int cache_size, std::vector<long long> &stamp, long long &misses) {
+    const long long start = misses;
+    for (int k = begin; k < end; ++k) {
+        const int face = order ? order[k] : k;
+        for (int j = 0; j < 3; ++j) {
+            const int v = model.vertex_index(face, j);
+            if (misses - stamp[v] >= cache_size) stamp[v] = misses++;
+        }
+    }
+    return misses - start;
+}
+
+// 减少 overdraw 的簇排序 (Sander et al. 2007 的线性时间版本)
+// 硬边界: 三个顶点都未命中的面, 前面的面与它不共享缓存中的顶点, 在此切分不损失命中率
+// 软边界: 硬边界之间的区间从头累计, 当前簇的 ACMR 降到区间整体的 threshold 倍以内时切分
+// 各簇按 dot(簇重心 - 网格重心, 簇法线) 从大到小排序, 朝外的簇先画
+void sort_for_overdraw(const Model &model, std::vector<int> &order, int cache_size,
+                       float threshold) {
+    const int num_faces = order.size();
+    std::vector<long long> stamp(model.num_vertices(), -(1ll << 40));
+    // FIFO 的时钟, 向前拨 cache_size 即清空缓存
+    long long clock = 0;
+    auto misses = [&](int begin, int end) {
+        return cache_misses(model, order.data(), begin, end, cache_size, stamp, clock);
+    };
+
+    std::vector<int> hard = {0};
+    for (int k = 0; k < num_faces; ++k) {
+        if (misses(k, k + 1) == 3 && k > 0) hard.push_back(k);
+    }
+    hard.push_back(num_faces);
+
+    std::vector<int> boundaries;
+    for (std::size_t h = 0; h + 1 < hard.size(); ++h) {
+        const int begin = hard[h], end = hard[h + 1];
+        clock += cache_size;
+        const double acmr = static_cast<double>(misses(begin, end)) / (end - begin);
+        clock += cache_size;
+        boundaries.push_back(begin);
+        long long cluster_misses = 0;
+        int start = begin;
+        for (int k = begin; k + 1 < end; ++k) {
+            cluster_misses += misses(k, k + 1);
+            if (cluster_misses <= threshold * acmr * (k + 1 - start)) {
+                boundaries.push_back(k + 1);
+                start = k + 1;
+                cluster_misses = 0;
+                clock += cache_size;
+            }
+        }
+    }
+    boundaries.push_back(num_faces);
+
+    // 面积加权的重心与法线
+    struct Cluster {
+        int begin, end;
+        double key;
+    };
+    std::vector<Cluster> clusters;
+    std::vector<double> centroids, normals;
+    double mesh_centroid[3] = {}, mesh_area = 0;
+    for (std::size_t c = 0; c + 1 < boundaries.size(); ++c) {
+        double centroid[3] = {}, normal[3] = {}, area = 0;
+        for (int k = boundaries[c]; k < boundaries[c + 1]; ++k) {
+            const Vec3f &a = model.vertex(order[k], 0);
+            const Vec3f &b = model.vertex(order[k], 1);
+            const Vec3f &d = model.vertex(order[k], 2);
+            const double ab[3] = {b.x - a.x, b.y - a.y, b.z - a.z};
+            const double ad[3] = {d.x - a.x, d.y - a.y, d.z - a.z};
+            const double n[3] = {ab[1] * ad[2] - ab[2] * ad[1], ab[2] * ad[0] - ab[0] * ad[2],
+                                 ab[0] * ad[1] - ab[1] * ad[0]};
+            const double face_area = 0.5 * std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int i = 0; i < 3; ++i) {
+                centroid[i] += face_area * (a[i] + b[i] + d[i]) / 3;
+                normal[i] += n[i];
+            }
+            area += face_area;
+        }
+        for (int i = 0; i < 3; ++i) {
+            mesh_centroid[i] += centroid[i];
+            centroids.push_back(area > 0 ? centroid[i] / area : 0);
+            normals.push_back(normal[i]);
+        }
+        mesh_area += area;
+        clusters.push_back({boundaries[c], boundaries[c + 1], 0});
+    }
+    for (int i = 0; i < 3; ++i) mesh_centroid[i] /= mesh_area > 0 ? mesh_area : 1;
+    for (std::size_t c = 0; c < clusters.size(); ++c) {
+        const double *n = &normals[c * 3];
+        const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        double key = 0;
+        for (int i = 0; i < 3; ++i) key += (centroids[c * 3 + i] - mesh_centroid[i]) * n[i];
+        clusters[c].key = length > 0 ? key / length : 0;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(),
+                     [](const Cluster &a, const Cluster &b) { return a.key > b.key; });
+
+    std::vector<int> sorted;
+    sorted.reserve(num_faces);
+    for (const Cluster &cluster : clusters)
+        sorted.insert(sorted.end(), order.begin() + cluster.begin, order.begin() + cluster.end);
+    order.swap(sorted);
+}
+
+} // namespace
+
+VertexCacheStats vertex_cache_stats(const Model &model, int cache_size) {
+    VertexCacheStats result;
+    const int num_faces = model.num_faces();
+    if (!num_faces) return result;
+    std::vector<long long> stamp(model.num_vertices(), -(1ll << 40));
+    long long misses = 0;
+    cache_misses(model, nullptr, 0, num_faces, cache_size, stamp, misses);
+
+    std::vector<char> used(model.num_vertices(), 0);
+    for (int i = 0; i < num_faces * 3; ++i) used[model.vertex_index(i / 3, i % 3)] = 1;
+    const long long referenced = std::count(used.begin(), used.end(), 1);
+    result.acmr = static_cast<double>(misses) / num_faces;
+    result.atvr = referenced ? static_cast<double>(misses) / referenced : 0;
+    return result;
+}
+
+bool optimize_mesh(Model &model, const MeshOptimizeOptions &options) {
+    std::uint32_t wanted = MESH_OPTIMIZE_VERTEX_CACHE;
+    if (options.overdraw) wanted |= MESH_OPTIMIZE_OVERDRAW;
+    const std::uint32_t done = model.get_optimizations();
+    if ((done & wanted) == wanted || !model.num_faces()) return false;
+
+    // 已按顶点缓存优化过时直接在现有顺序上切簇排序
+    std::vector<int> order;
+    if (done & MESH_OPTIMIZE_VERTEX_CACHE) {
+        order.resize(model.num_faces());
+        std::iota(order.begin(), order.end(), 0);
+    } else {
+        order = tipsify(model, options.cache_size);
+    }
+    if (options.overdraw)
+        sort_for_overdraw(model, order, options.cache_size, options.overdraw_threshold);
+    // 重排的临时数组共用一个 Arena, 每个数组用完即复位, 后面的数组复用已分配的块
+    Arena scratch;
+    model.reorder_faces(order, &scratch);
+    model.renumber_vertices(&scratch);
+    model.set_optimizations(done | wanted);
+    return true;
+}
@@ -0,0 +1,623 @@
+#include "mesh_stream.h"
+#include "obj_parse.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <new>
+
+namespace fs = std::filesystem;
+
+std::string chunked_mesh_path(const std::string &obj_filename) {
+    return fs::path(obj_filename).replace_extension(".cmesh").string();
+}
+
+bool is_chunked_mesh_path(const std::string &filename) {
+    return fs::path(filename).extension() == ".cmesh";
+}
+
+MeshChunkHeader EncodedChunk::header() const {
+    MeshChunkHeader header;
+    if (size >= sizeof(header)) std::memcpy(&header, data.data(), sizeof(header));
+    return header;
+}
+
+namespace {
+
+// 量化后的最大值, 坐标量化为 [0, quantize_max] 内的整数
+constexpr float quantize_max = 65535.f;
+// 一个下标的变长编码最多 5 字节
+constexpr int max_varint_bytes = 5;
+// 读取 OBJ 时每次读入的字节数
+constexpr std::size_t read_block = std::size_t(1) << 20;
+
+// 一块的大小上限: 块头, 每个三角形最多 3 个顶点与 3 个下标, 以及对齐的填充
+constexpr std::uint64_t max_chunk_bytes =
+    sizeof(MeshChunkHeader) +
+    std::uint64_t(max_chunk_triangles) * 3 * (6 + max_varint_bytes) + chunked_mesh_alignment;
+
+// 由整个网格在一个坐标轴上的范围 [lo, hi] 选择量化步长的指数
+// 步长至少为该量级 float 的精度 (2^(e - 24), |x| < 2^e), 所以格点下标不超过 2^24;
+// 在此基础上取能把 [lo, hi] 放进 16 位的最小的 2 的幂, 范围更小的各块自然也放得下
+int lattice_exponent(float lo, float hi) {
+    if (!(lo <= hi)) return 0;
+    int magnitude, extent;
+    std::frexp(std::max(std::fabs(lo), std::fabs(hi)), &magnitude);
+    std::frexp((hi - lo) / quantize_max, &extent);
+    int e = std::max(magnitude - 24, extent);
+    while (std::round(std::ldexp(hi, -e)) - std::round(std::ldexp(lo, -e)) > quantize_max) ++e;
+    return e;
+}
+
+// 逐段 (每次 read_block 字节) 读入 in, 对每个完整的行调用 parse_line(p, eol),
+// 末尾不完整的行移到缓冲区开头与下一段拼接; parse_line 返回 false 时停止并返回 false
+template <typename ParseLine>
+bool for_each_line(std::istream &in, std::int64_t &bytes_read, ParseLine &&parse_line) {
+    using namespace obj_parse;
+    std::vector<char> buffer;
+    std::size_t carry = 0;
+    for (;;) {
+        buffer.resize(carry + read_block);
+        in.read(buffer.data() + carry, read_block);
+        const std::size_t got = in.gcount();
+        bytes_read += got;
+        const bool last = got < read_block;
+        const char *begin = buffer.data();
+        const char *end = begin + carry + got;
+        const char *stop = end;
+        if (!last) {
+            while (stop > begin && stop[-1] != '\n') --stop;
+        }
+        for (const char *p = begin; p < stop;) {
+            const char *eol = find_line_end(p, stop);
+            if (!parse_line(p, eol)) return false;
+            p = next_line(eol, stop);
+        }
+        carry = end - stop;
+        std::memmove(buffer.data(), stop, carry);
+        if (last) return true;
+    }
+}
+
+// 量化到格点, 乘以 2 的幂没有舍入, 结果只与 value 和 exponent 有关 (与块的原点无关)
+inline std::uint16_t quantize(float value, std::int32_t origin, float inv_step) {
+    const float q = std::round(value * inv_step) - origin;
+    return q >= quantize_max ? 65535 : q > 0.f ? static_cast<std::uint16_t>(q) : 0;
+}
+
+// zigzag: 把绝对值小的有符号数映射为小的无符号数, 0 -1 1 -2 ... -> 0 1 2 3 ...
+inline std::uint32_t zigzag(int value) {
+    return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+}
+
+inline int unzigzag(std::uint32_t value) {
+    return static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1);
+}
+
+// LEB128: 每字节 7 位, 最高位表示后面还有字节
+inline std::uint8_t *write_varint(std::uint8_t *p, std::uint32_t value) {
+    while (value >= 0x80) {
+        *p++ = static_cast<std::uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = static_cast<std::uint8_t>(value);
+    return p;
+}
+
+inline bool read_varint(const std::uint8_t *&p, const std::uint8_t *end,
+                        std::uint32_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 7 * max_varint_bytes && p < end; shift += 7) {
+        const std::uint8_t byte = *p++;
+        value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+void lattice_exponents(const Vec3f *positions, std::size_t count, std::int32_t exponent[3]) {
+    for (int axis = 0; axis < 3; ++axis) {
+        float lo = std::numeric_limits<float>::infinity(), hi = -lo;
+        for (std::size_t i = 0; i < count; ++i) {
+            const float value = positions[i][axis];
+            if (!std::isfinite(value)) continue;
+            lo = std::min(lo, value);
+            hi = std::max(hi, value);
+        }
+        exponent[axis] = lattice_exponent(lo, hi);
+    }
+}
+
+void encode_chunk(const Vec3f *positions, const int *indices, int num_triangles,
+                  std::uint64_t first_triangle, const std::int32_t exponent[3], Arena &scratch,
+                  EncodedChunk &out) {
+    scratch.reset();
+    const int n = num_triangles * 3;
+    // 块内的顶点: 用到的原下标去重后升序排列, 块内下标即在其中的位置
+    int *vertices = scratch.allocate_array<int>(n);
+    std::copy(indices, indices + n, vertices);
+    std::sort(vertices, vertices + n);
+    const int num_vertices = std::unique(vertices, vertices + n) - vertices;
+
+    MeshChunkHeader header;
+    header.first_triangle = first_triangle;
+    header.num_vertices = num_vertices;
+    header.num_triangles = num_triangles;
+    // 步长由整个网格决定, 原点取块内最小的坐标所在的格点
+    for (int axis = 0; axis < 3; ++axis) {
+        float lo = std::numeric_limits<float>::infinity();
+        for (int k = 0; k < num_vertices; ++k) {
+            const float value = positions[vertices[k]][axis];
+            if (std::isfinite(value)) lo = std::min(lo, value);
+        }
+        header.exponent[axis] = exponent[axis];
+        if (std::isfinite(lo))
+            header.origin[axis] =
+                static_cast<std::int32_t>(std::round(std::ldexp(lo, -exponent[axis])));
+    }
+
+    // 按最坏情况准备缓冲区, 只增不减
+    const std::size_t capacity =
+        sizeof(header) + std::size_t(num_vertices) * 6 + std::size_t(n) * max_varint_bytes;
+    if (out.data.size() < capacity) out.data.resize(capacity);
+    std::uint8_t *p = out.data.data() + sizeof(header);
+
+    float inv_step[3];
+    for (int axis = 0; axis < 3; ++axis) inv_step[axis] = std::ldexp(1.f, -header.exponent[axis]);
+    for (int k = 0; k < num_vertices; ++k) {
+        const Vec3f &position = positions[vertices[k]];
+        for (int axis = 0; axis < 3; ++axis) {
+            const std::uint16_t q = quantize(position[axis], header.origin[axis], inv_step[axis]);
+            std::memcpy(p, &q, sizeof(q));
+            p += sizeof(q);
+        }
+    }
+
+    const std::uint8_t *index_begin = p;
+    int previous = 0;
+    for (int i = 0; i < n; ++i) {
+        const int local = std::lower_bound(vertices, vertices + num_vertices, indices[i]) - vertices;
+        p = write_varint(p, zigzag(local - previous));
+        previous = local;
+    }
+    header.index_bytes = p - index_begin;
+    std::memcpy(out.data.data(), &header, sizeof(header));
+    out.size = p - out.data.data();
+}
+
+bool decode_chunk(const EncodedChunk &chunk, Arena &arena, DecodedChunk &out) {
+    if (chunk.size < sizeof(MeshChunkHeader)) return false;
+    const MeshChunkHeader header = chunk.header();
+    if (header.num_triangles > static_cast<std::uint32_t>(max_chunk_triangles) ||
+        header.num_vertices > 3 * header.num_triangles)
+        return false;
+    const int num_vertices = header.num_vertices;
+    const int n = header.num_triangles * 3;
+    const std::size_t positions_bytes = std::size_t(num_vertices) * 6;
+    if (chunk.size < sizeof(header) + positions_bytes + header.index_bytes) return false;
+
+    const std::uint8_t *p = chunk.data.data() + sizeof(header);
+    float step[3];
+    for (int axis = 0; axis < 3; ++axis) step[axis] = std::ldexp(1.f, header.exponent[axis]);
+    out.positions.allocate(arena, num_vertices);
+    for (int k = 0; k < num_vertices; ++k, p += 6) {
+        std::uint16_t q[3];
+        std::memcpy(q, p, sizeof(q));
+        out.positions[k] = Vec3f{static_cast<float>(header.origin[0] + q[0]) * step[0],
+                                 static_cast<float>(header.origin[1] + q[1]) * step[1],
+                                 static_cast<float>(header.origin[2] + q[2]) * step[2]};
+    }
+
+    const std::uint8_t *end = p + header.index_bytes;
+    out.indices.allocate(arena, n);
+    long long previous = 0;
+    for (int i = 0; i < n; ++i) {
+        std::uint32_t value;
+        if (!read_varint(p, end, value)) return false;
+        const long long index = previous + unzigzag(value);
+        if (index < 0 || index >= num_vertices) return false;
+        out.indices[i] = index;
+        previous = index;
+    }
+    // 面的颜色只取编号的低 32 位, 与 rasterize 中 int 编号的哈希相同
+    out.first_triangle = static_cast<int>(static_cast<std::uint32_t>(header.first_triangle));
+    return p == end;
+}
+
+MeshStream::MeshStream(const std::string &filename, const MeshStreamOptions &options)
+    : filename_(filename), options_(options) {
+    options_.chunk_triangles = std::clamp(options.chunk_triangles, 1, max_chunk_triangles / 2);
+    const int slots = std::max(1, options.prefetch) + 1;
+    for (int i = 0; i < slots; ++i) {
+        auto chunk = std::make_unique<EncodedChunk>();
+        free_.push_back(chunk.get());
+        slots_.push_back(std::move(chunk));
+    }
+    thread_ = std::thread(&MeshStream::run, this);
+}
+
+MeshStream::~MeshStream() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    chunk_freed_.notify_all();
+    thread_.join();
+}
+
+void MeshStream::run() {
+    bool ok = false;
+    // 读线程中的异常无法传给渲染线程, 内存不足时视为读取失败
+    try {
+        ok = is_chunked_mesh_path(filename_) ? read_chunked() : read_obj();
+    } catch (const std::bad_alloc &) {
+        std::cerr << "Out of memory while reading " << filename_ << '\n';
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed_ = !ok;
+        finished_ = true;
+    }
+    chunk_ready_.notify_all();
+}
+
+EncodedChunk *MeshStream::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    chunk_freed_.wait(lock, [this] { return stopping_ || !free_.empty(); });
+    if (stopping_) return nullptr;
+    EncodedChunk *chunk = free_.front();
+    free_.pop_front();
+    return chunk;
+}
+
+void MeshStream::submit(EncodedChunk *chunk, std::int64_t bytes_read) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(chunk);
+        ++chunks_;
+        encoded_bytes_ += chunk->size;
+        bytes_read_ = bytes_read;
+    }
+    chunk_ready_.notify_one();
+}
+
+bool MeshStream::read_chunked() {
+    std::ifstream in(filename_, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open " << filename_ << '\n';
+        return false;
+    }
+    ChunkedMeshHeader header;
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    std::error_code ec;
+    const std::uint64_t file_size = fs::file_size(filename_, ec);
+    // 偏移表必须恰好位于文件末尾, 先检查再按块数分配
+    if (!in.good() || std::memcmp(header.magic, chunked_mesh_magic, sizeof(header.magic)) ||
+        header.version != chunked_mesh_version ||
+        header.endian_tag != chunked_mesh_endian_tag || ec ||
+        header.table_offset > file_size ||
+        (file_size - header.table_offset) / sizeof(std::uint64_t) != header.num_chunks + 1) {
+        std::cerr << "Invalid chunked mesh " << filename_ << '\n';
+        return false;
+    }
+
+    std::vector<std::uint64_t> offsets(header.num_chunks + 1);
+    in.seekg(header.table_offset);
+    in.read(reinterpret_cast<char *>(offsets.data()), offsets.size() * sizeof(std::uint64_t));
+    if (!in.good() || offsets.back() != header.table_offset) {
+        std::cerr << "Invalid chunked mesh " << filename_ << '\n';
+        return false;
+    }
+    // 读任何一块之前检查整个偏移表: 各块依次排列在文件头与偏移表之间, 大小不超过上限,
+    // 损坏的偏移不会导致按错误的大小分配缓冲区
+    if (offsets[0] < sizeof(header)) {
+        std::cerr << "Invalid chunk table in " << filename_ << '\n';
+        return false;
+    }
+    for (std::uint64_t c = 0; c < header.num_chunks; ++c) {
+        if (offsets[c + 1] < offsets[c] || offsets[c + 1] - offsets[c] > max_chunk_bytes) {
+            std::cerr << "Invalid chunk table in " << filename_ << '\n';
+            return false;
+        }
+    }
+    std::int64_t bytes_read = sizeof(header) + offsets.size() * sizeof(std::uint64_t);
+
+    for (std::uint64_t c = 0; c < header.num_chunks; ++c) {
+        const std::size_t size = offsets[c + 1] - offsets[c];
+        EncodedChunk *chunk = acquire();
+        if (!chunk) return true;
+        if (chunk->data.size() < size) chunk->data.resize(size);
+        in.seekg(offsets[c]);
+        in.read(reinterpret_cast<char *>(chunk->data.data()), size);
+        if (!in.good()) {
+            std::cerr << "Failed to read chunk " << c << " of " << filename_ << '\n';
+            return false;
+        }
+        chunk->size = size;
+        // 所有块的步长必须与文件头相同, 否则共用的顶点在相邻块中的位置不同
+        const MeshChunkHeader chunk_header = chunk->header();
+        if (!std::equal(header.exponent, header.exponent + 3, chunk_header.exponent)) {
+            std::cerr << "Invalid chunk " << c << " in " << filename_ << '\n';
+            return false;
+        }
+        bytes_read += size;
+        submit(chunk, bytes_read);
+    }
+    return true;
+}
+
+// 读两遍: 第一遍读出全部顶点位置, 由包围盒求出量化步长;
+// 第二遍把面扇形三角化后追加到当前块, 攒够 chunk_triangles 个三角形时编码
+// 多边形面的三角形不拆到两块, 所以一块可能略多于 chunk_triangles 个三角形
+bool MeshStream::read_obj() {
+    using namespace obj_parse;
+    std::ifstream in(filename_, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open " << filename_ << '\n';
+        return false;
+    }
+
+    std::int64_t bytes_read = 0;
+    std::size_t line = 0, errors = 0, error_line = 0;
+    // 记录有问题的行, 两遍中行号最小的一个作为第一个错误输出
+    auto report = [&]() {
+        if (!errors++ || line < error_line) error_line = line;
+    };
+
+    // 第一遍: 顶点位置, 以及纹理坐标与法线的个数
+    std::vector<Vec3f> positions;
+    std::size_t total_tex_coords = 0, total_normals = 0;
+    for_each_line(in, bytes_read, [&](const char *p, const char *eol) {
+        ++line;
+        switch (line_type(p, eol)) {
+        case VERTEX: {
+            Vec3f &vertex = positions.emplace_back();
+            if (!parse_float(p, eol, vertex.x) || !parse_float(p, eol, vertex.y) ||
+                !parse_float(p, eol, vertex.z))
+                report();
+            break;
+        }
+        case TEX_COORD: ++total_tex_coords; break;
+        case NORMAL: ++total_normals; break;
+        default: break;
+        }
+        return true;
+    });
+    if (in.bad()) {
+        std::cerr << "Failed to read " << filename_ << '\n';
+        return false;
+    }
+    std::int32_t exponent[3];
+    lattice_exponents(positions.data(), positions.size(), exponent);
+
+    // 第二遍: 面, 相对索引按该行之前定义的个数解析, 与 Model::load_obj 相同
+    in.clear();
+    in.seekg(0);
+    line = 0;
+    std::size_t vertices = 0, tex_coords = 0, normals = 0;
+    const std::size_t chunk_indices = std::size_t(options_.chunk_triangles) * 3;
+    std::vector<int> triangles;
+    triangles.reserve(chunk_indices);
+    std::uint64_t emitted = 0; // 已编码的三角形个数, 即下一块第一个三角形的编号
+    Arena scratch;
+
+    // 把当前块编码后交给渲染线程, 被要求停止时返回 false
+    auto flush = [&]() {
+        EncodedChunk *chunk = acquire();
+        if (!chunk) return false;
+        const int count = triangles.size() / 3;
+        encode_chunk(positions.data(), triangles.data(), count, emitted, exponent, scratch,
+                     *chunk);
+        emitted += count;
+        triangles.clear();
+        submit(chunk, bytes_read);
+        return true;
+    };
+    const bool finished = for_each_line(in, bytes_read, [&](const char *p, const char *eol) {
+        ++line;
+        switch (line_type(p, eol)) {
+        case VERTEX: ++vertices; break;
+        case TEX_COORD: ++tex_coords; break;
+        case NORMAL: ++normals; break;
+        case FACE: {
+            const std::size_t begin = triangles.size();
+            int first = 0, prev = 0;
+            bool ok = true;
+            int n = 0;
+            for (p = skip_spaces(p, eol); p < eol; p = skip_spaces(p, eol), ++n) {
+                int raw[3];
+                if (!parse_face_vertex(p, eol, raw)) ok = false;
+                const int cur = resolve_index(raw[0], vertices, positions.size());
+                if (cur < 0 || resolve_index(raw[1], tex_coords, total_tex_coords) == -2 ||
+                    resolve_index(raw[2], normals, total_normals) == -2)
+                    ok = false;
+                if (n == 0) first = cur;
+                if (n >= 2) triangles.insert(triangles.end(), {first, prev, cur});
+                prev = cur;
+            }
+            if (!ok) {
+                report();
+                triangles.resize(begin);
+            } else if (triangles.size() >= chunk_indices) {
+                return flush();
+            }
+            break;
+        }
+        default: break;
+        }
+        return true;
+    });
+    if (!finished) return true;
+    if (in.bad()) {
+        std::cerr << "Failed to read " << filename_ << '\n';
+        return false;
+    }
+    if (!triangles.empty() && !flush()) return true;
+
+    if (errors) {
+        std::cerr << "Failed to parse line " << error_line << " of " << filename_ << '\n'
+                  << errors << " malformed line(s) in " << filename_ << '\n';
+    }
+    return true;
+}
+
+EncodedChunk *MeshStream::next() {
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    chunk_ready_.wait(lock, [this] { return finished_ || !ready_.empty(); });
+    wait_ms_ += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                          start)
+                    .count();
+    if (ready_.empty()) return nullptr;
+    EncodedChunk *chunk = ready_.front();
+    ready_.pop_front();
+    return chunk;
+}
+
+void MeshStream::release(EncodedChunk *chunk) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(chunk);
+    }
+    chunk_freed_.notify_one();
+}
+
+bool MeshStream::failed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return failed_;
+}
+
+std::int64_t MeshStream::bytes_read() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_read_;
+}
+
+std::int64_t MeshStream::chunks() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_;
+}
+
+std::int64_t MeshStream::encoded_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return encoded_bytes_;
+}
+
+bool write_chunked_mesh(const std::string &obj_filename, const std::string &filename,
+                        const MeshStreamOptions &options) {
+    ChunkedMeshHeader header;
+    std::memcpy(header.magic, chunked_mesh_magic, sizeof(header.magic));
+    header.version = chunked_mesh_version;
+    header.endian_tag = chunked_mesh_endian_tag;
+    header.chunk_triangles = std::clamp(options.chunk_triangles, 1, max_chunk_triangles / 2);
+
+    // 先写临时文件再改名, 避免其它进程读到写了一半的文件
+    const std::string temp_filename = filename + ".tmp";
+    {
+        std::ofstream out(temp_filename, std::ios::binary);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open file " << temp_filename << ".\n";
+            return false;
+        }
+        // 文件头在写完各块之后回填
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        std::vector<std::uint64_t> offsets;
+        std::uint64_t offset = sizeof(header);
+        const char padding[chunked_mesh_alignment] = {};
+        MeshStream stream(obj_filename, options);
+        while (EncodedChunk *chunk = stream.next()) {
+            const MeshChunkHeader chunk_header = chunk->header();
+            // 各块的步长相同, 记录在文件头中
+            if (offsets.empty())
+                std::copy(chunk_header.exponent, chunk_header.exponent + 3, header.exponent);
+            offsets.push_back(offset);
+            header.num_triangles += chunk_header.num_triangles;
+            const std::uint64_t padded = (chunk->size + chunked_mesh_alignment - 1) /
+                                         chunked_mesh_alignment * chunked_mesh_alignment;
+            out.write(reinterpret_cast<const char *>(chunk->data.data()), chunk->size);
+            out.write(padding, padded - chunk->size);
+            offset += padded;
+            stream.release(chunk);
+        }
+        if (stream.failed()) {
+            out.close();
+            std::error_code ec;
+            fs::remove(temp_filename, ec);
+            return false;
+        }
+        offsets.push_back(offset);
+        header.num_chunks = offsets.size() - 1;
+        header.table_offset = offset;
+        out.write(reinterpret_cast<const char *>(offsets.data()),
+                  offsets.size() * sizeof(std::uint64_t));
+        out.seekp(0);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        if (!out.good()) {
+            std::cerr << "An error occured while writing the chunked mesh.\n";
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(temp_filename, filename, ec);
+    if (ec) {
+        std::cerr << "Failed to rename " << temp_filename << " to " << filename << ": "
+                  << ec.message() << ".\n";
+        fs::remove(temp_filename, ec);
+        return false;
+    }
+    return true;
+}
+
+template <PixelFormat Format>
+StreamRenderResult render_stream(MeshStream &stream, Framebuffer<Format> &frame_buffer,
+                                 DepthBuffer &depth_buffer, const RasterOptions &options) {
+    const int width = frame_buffer.get_width();
+    const int height = frame_buffer.get_height();
+    RasterScratch local_scratch;
+    FrameArena &arena = (options.scratch ? *options.scratch : local_scratch).arena;
+    FrameStats *stats = options.stats;
+    StreamRenderResult result;
+    bool corrupt = false;
+    while (EncodedChunk *chunk = stream.next()) {
+        arena.reset();
+        DecodedChunk decoded;
+        TransformedVertices vertices;
+        {
+            RENDERER_STAGE_TIMER(stats, Stage::VERTEX);
+            corrupt = !decode_chunk(*chunk, arena.shared(), decoded);
+            if (!corrupt)
+                transform_vertices(decoded.positions.data(), decoded.positions.size(), width,
+                                   height, arena.shared(), vertices, options.transform);
+        }
+        // 解码之后块的字节不再需要, 读线程可以立即读下一块
+        stream.release(chunk);
+        if (corrupt) {
+            std::cerr << "Corrupt chunk " << result.chunks << " in the mesh stream\n";
+            break;
+        }
+        result.tested +=
+            rasterize_indexed(vertices, decoded.indices.data(), decoded.num_triangles(),
+                              decoded.first_triangle, frame_buffer, depth_buffer, arena, options);
+        result.triangles += decoded.num_triangles();
+        result.vertices += decoded.positions.size();
+        ++result.chunks;
+    }
+    RENDERER_STATS_ONLY(if (stats) stats->add_stage_time(Stage::LOAD, stream.wait_ms());)
+    result.ok = !corrupt && !stream.failed();
+    return result;
+}
+
+#define INSTANTIATE_RENDER_STREAM(Format)                                      \
+    template StreamRenderResult render_stream<Format>(                         \
+        MeshStream &, Framebuffer<Format> &, DepthBuffer &,                    \
+        const RasterOptions &);
+INSTANTIATE_RENDER_STREAM(PixelFormat::GRAYSCALE)
+INSTANTIATE_RENDER_STREAM(PixelFormat::RGB)
+INSTANTIATE_RENDER_STREAM(PixelFormat::RGBA)
+#undef INSTANTIATE_RENDER_STREAM
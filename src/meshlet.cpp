@@ -0,0 +1,264 @@
+#include "meshlet.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using Vec3d = Vec<3, double>;
+
+// 簇已有一半以上的面后, 法线与簇平均法线夹角余弦低于该值的相邻面不再加入
+constexpr double cone_limit = 0.7;
+// 两条边夹角的正弦低于该值的面视为退化, 其法线由舍入误差主导, 不参与背面剔除
+constexpr double degenerate_sine = 1e-2;
+// 背面剔除的余量: 变换后法线锥内所有法线的 z 分量都不超过 -backface_margin 时才剔除,
+// 吸收顶点阶段的浮点舍入, 保证逐面剔除对这些面的结果也是背面或退化
+constexpr float backface_margin = 0.02f;
+// 屏幕外剔除的余量, 单位为像素
+constexpr float offscreen_margin = 1.f;
+
+Vec3d to_double(const Vec3f &v) { return {v.x, v.y, v.z}; }
+
+Vec3d add(const Vec3d &a, const Vec3d &b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+
+Vec3d scale(const Vec3d &v, double s) { return {v.x * s, v.y * s, v.z * s}; }
+
+// 簇内面的并集, 求包围球与法线锥
+void meshlet_bounds(const Model &model, const int *faces, int count,
+                    const std::vector<Vec3d> &normals, Meshlet &meshlet) {
+    // 包围球: 取顶点的轴对齐包围盒中心为球心, 到各顶点的最远距离为半径
+    Vec3d lo = to_double(model.vertex(faces[0], 0)), hi = lo;
+    for (int k = 0; k < count; ++k) {
+        for (int j = 0; j < 3; ++j) {
+            const Vec3d v = to_double(model.vertex(faces[k], j));
+            for (int c = 0; c < 3; ++c) {
+                lo[c] = std::min(lo[c], v[c]);
+                hi[c] = std::max(hi[c], v[c]);
+            }
+        }
+    }
+    const Vec3d center = scale(add(lo, hi), 0.5);
+    double radius_squared = 0;
+    for (int k = 0; k < count; ++k) {
+        for (int j = 0; j < 3; ++j) {
+            radius_squared = std::max(
+                radius_squared, (to_double(model.vertex(faces[k], j)) - center).length_squared());
+        }
+    }
+    meshlet.center = {static_cast<float>(center.x), static_cast<float>(center.y),
+                      static_cast<float>(center.z)};
+    // 球心转为 float 的舍入由略微放大的半径吸收
+    const double radius = std::sqrt(radius_squared);
+    meshlet.radius = static_cast<float>(radius * (1 + 1e-5) + 1e-6 * (1 + std::fabs(center.x) +
+                                                                       std::fabs(center.y) +
+                                                                       std::fabs(center.z)));
+
+    // 法线锥: 轴为单位法线之和的方向, 夹角取最大的那个
+    // 含有退化面, 或法线之和太短 (法线张开接近整个球面) 时不做背面剔除
+    meshlet.cone_axis = {0, 0, 1};
+    meshlet.cone_cutoff = -1;
+    Vec3d sum = {0, 0, 0};
+    for (int k = 0; k < count; ++k) {
+        const Vec3d &n = normals[faces[k]];
+        if (n.length_squared() == 0) return;
+        sum = add(sum, n);
+    }
+    const double length = std::sqrt(sum.length_squared());
+    if (length < 1e-3 * count) return;
+    const Vec3d axis = scale(sum, 1 / length);
+    double cutoff = 1;
+    for (int k = 0; k < count; ++k) cutoff = std::min(cutoff, axis * normals[faces[k]]);
+    meshlet.cone_axis = {static_cast<float>(axis.x), static_cast<float>(axis.y),
+                         static_cast<float>(axis.z)};
+    // 轴转为 float 的舍入误差远小于该余量
+    meshlet.cone_cutoff = static_cast<float>(cutoff - 1e-4);
+}
+
+} // namespace
+
+void build_meshlets(const Model &model, Meshlets &out, int max_faces) {
+    max_faces = std::max(max_faces, 1);
+    const int num_faces = model.num_faces();
+    const int num_vertices = model.num_vertices();
+    out.meshlets.clear();
+    out.faces.clear();
+    out.faces.reserve(num_faces);
+    if (!num_faces) return;
+
+    // 面的单位法线与重心, 退化面的法线为 0
+    std::vector<Vec3d> normals(num_faces), centroids(num_faces);
+    double edge_sum = 0;
+    for (int i = 0; i < num_faces; ++i) {
+        const Vec3d a = to_double(model.vertex(i, 0));
+        const Vec3d b = to_double(model.vertex(i, 1));
+        const Vec3d c = to_double(model.vertex(i, 2));
+        const Vec3d ab = b - a, ac = c - a;
+        const Vec3d n = ab.cross(ac);
+        const double edges = std::sqrt(ab.length_squared() * ac.length_squared());
+        const double length = std::sqrt(n.length_squared());
+        normals[i] = length > degenerate_sine * edges && length > 0 ? scale(n, 1 / length)
+                                                                    : Vec3d{0, 0, 0};
+        centroids[i] = scale(add(add(a, b), c), 1.0 / 3);
+        edge_sum += std::sqrt(ab.length_squared());
+    }
+    // 距离按平均边长归一化, 使簇趋向紧凑, 包围球更小
+    const double distance_scale = 1 / (8 * std::max(edge_sum / num_faces, 1e-12));
+
+    // 顶点 -> 相邻面, CSR 格式
+    std::vector<int> vertex_begin(num_vertices + 1, 0), vertex_faces(num_faces * 3);
+    for (int i = 0; i < num_faces * 3; ++i) ++vertex_begin[model.vertex_index(i / 3, i % 3) + 1];
+    for (int v = 0; v < num_vertices; ++v) vertex_begin[v + 1] += vertex_begin[v];
+    {
+        std::vector<int> cursor(vertex_begin.begin(), vertex_begin.end() - 1);
+        for (int i = 0; i < num_faces * 3; ++i)
+            vertex_faces[cursor[model.vertex_index(i / 3, i % 3)]++] = i / 3;
+    }
+
+    auto emit = [&](int begin) {
+        Meshlet meshlet;
+        meshlet.face_begin = begin;
+        meshlet.face_count = static_cast<int>(out.faces.size()) - begin;
+        meshlet_bounds(model, out.faces.data() + begin, meshlet.face_count, normals, meshlet);
+        out.meshlets.push_back(meshlet);
+    };
+
+    // 退化面单独成簇, 最后按顺序输出
+    std::vector<int> degenerate_faces;
+    // visited[i] 为面 i 最后一次被加入候选集合的簇的编号加 1, 已分配的面为 -1
+    std::vector<int> visited(num_faces, 0);
+    std::vector<int> frontier;
+    for (int seed = 0; seed < num_faces; ++seed) {
+        if (visited[seed] < 0) continue;
+        if (normals[seed].length_squared() == 0) {
+            visited[seed] = -1;
+            degenerate_faces.push_back(seed);
+            continue;
+        }
+
+        const int stamp = static_cast<int>(out.meshlets.size()) + 1;
+        const int begin = out.faces.size();
+        Vec3d normal_sum = {0, 0, 0}, centroid_sum = {0, 0, 0};
+        frontier.clear();
+        int next = seed;
+        while (true) {
+            visited[next] = -1;
+            out.faces.push_back(next);
+            normal_sum = add(normal_sum, normals[next]);
+            centroid_sum = add(centroid_sum, centroids[next]);
+            const int count = static_cast<int>(out.faces.size()) - begin;
+            if (count == max_faces) break;
+
+            // 把新面的相邻面加入候选集合
+            for (int j = 0; j < 3; ++j) {
+                const int v = model.vertex_index(next, j);
+                for (int k = vertex_begin[v]; k < vertex_begin[v + 1]; ++k) {
+                    const int f = vertex_faces[k];
+                    if (visited[f] < 0 || visited[f] == stamp ||
+                        normals[f].length_squared() == 0)
+                        continue;
+                    visited[f] = stamp;
+                    frontier.push_back(f);
+                }
+            }
+
+            // 选出与簇朝向最接近且离簇中心最近的候选面
+            const double normal_length = std::sqrt(normal_sum.length_squared());
+            const Vec3d axis =
+                normal_length > 0 ? scale(normal_sum, 1 / normal_length) : Vec3d{0, 0, 0};
+            const Vec3d center = scale(centroid_sum, 1.0 / count);
+            int best = -1;
+            double best_score = 0, best_dot = 0;
+            for (int k = 0; k < static_cast<int>(frontier.size()); ++k) {
+                const int f = frontier[k];
+                if (visited[f] < 0) {
+                    frontier[k--] = frontier.back();
+                    frontier.pop_back();
+                    continue;
+                }
+                const double dot = axis * normals[f];
+                const double score =
+                    dot - std::sqrt((centroids[f] - center).length_squared()) * distance_scale;
+                if (best < 0 || score > best_score) best = k, best_score = score, best_dot = dot;
+            }
+            if (best < 0 || (count * 2 >= max_faces && best_dot < cone_limit)) break;
+            next = frontier[best];
+            frontier[best] = frontier.back();
+            frontier.pop_back();
+        }
+        // 未加入的候选面之后重新作为候选, 清除标记
+        for (int f : frontier) {
+            if (visited[f] == stamp) visited[f] = 0;
+        }
+        emit(begin);
+    }
+
+    for (std::size_t i = 0; i < degenerate_faces.size(); i += max_faces) {
+        const int begin = out.faces.size();
+        const std::size_t end = std::min(degenerate_faces.size(), i + max_faces);
+        out.faces.insert(out.faces.end(), degenerate_faces.begin() + i,
+                         degenerate_faces.begin() + end);
+        emit(begin);
+    }
+}
+
+MeshletCuller::MeshletCuller(int width, int height, const Affine3f *transform)
+    : width_(width), height_(height) {
+    if (transform) transform_ = *transform;
+    const float(*m)[3] = transform_.m;
+    // 余子式矩阵, 法线 n 变换为 cof(m) * n, 对任意可逆矩阵成立, 不要求正交
+    for (int r = 0; r < 3; ++r) {
+        for (int c = 0; c < 3; ++c) {
+            const int r1 = (r + 1) % 3, r2 = (r + 2) % 3;
+            const int c1 = (c + 1) % 3, c2 = (c + 2) % 3;
+            normal_matrix_[r][c] = m[r1][c1] * m[r2][c2] - m[r1][c2] * m[r2][c1];
+        }
+    }
+    // 线性部分为旋转乘均匀缩放时各行两两正交且长度相同, 变换保持法线之间的夹角
+    float rows[3];
+    for (int r = 0; r < 3; ++r)
+        rows[r] = std::sqrt(m[r][0] * m[r][0] + m[r][1] * m[r][1] + m[r][2] * m[r][2]);
+    const float row_max = std::max(std::max(rows[0], rows[1]), rows[2]);
+    for (int r = 0; r < 3 && backface_; ++r) {
+        if (std::fabs(rows[r] - row_max) > 1e-4f * row_max) backface_ = false;
+        const int s = (r + 1) % 3;
+        const float dot = m[r][0] * m[s][0] + m[r][1] * m[s][1] + m[r][2] * m[s][2];
+        if (std::fabs(dot) > 1e-4f * row_max * row_max) backface_ = false;
+    }
+    // 行列式为负时绕序翻转, 与逐面剔除的结果无法对应
+    const float det = m[0][0] * normal_matrix_[0][0] + m[0][1] * normal_matrix_[0][1] +
+                      m[0][2] * normal_matrix_[0][2];
+    if (!(det > 0)) backface_ = false;
+
+    // 与顶点阶段相同的视口变换, 屏幕 x 只与 m 的第 0 行有关, 球的投影半径为 |第 0 行| * r
+    scale_x_ = 0.5f * (width - 1);
+    scale_y_ = 0.5f * (height - 1);
+    radius_x_ = rows[0] * scale_x_;
+    radius_y_ = rows[1] * scale_y_;
+}
+
+MeshletCull MeshletCuller::cull(const Meshlet &meshlet) const {
+    // 屏幕外: 逐面剔除用截断取整的包围盒, 所有顶点 x < -1 或 x >= width 时一定被剔除, y 同理
+    const Vec3f c = transform_.apply(meshlet.center);
+    const float x = (c.x + 1.f) * scale_x_, y = (c.y + 1.f) * scale_y_;
+    const float rx = meshlet.radius * radius_x_ + offscreen_margin;
+    const float ry = meshlet.radius * radius_y_ + offscreen_margin;
+    if (x + rx < -1.f || x - rx > width_ || y + ry < -1.f || y - ry > height_)
+        return MeshletCull::OFFSCREEN;
+
+    // 背面: 正交投影下屏幕空间的绕序由变换后法线的 z 分量决定
+    // 锥的半角为 theta, 变换后的轴与 +z 的夹角为 phi, 锥内法线 z 分量的最大值为 cos(phi - theta)
+    if (!backface_ || meshlet.cone_cutoff <= 0) return MeshletCull::VISIBLE;
+    const Vec3f &a = meshlet.cone_axis;
+    const float (*n)[3] = normal_matrix_;
+    const float ax = n[0][0] * a.x + n[0][1] * a.y + n[0][2] * a.z;
+    const float ay = n[1][0] * a.x + n[1][1] * a.y + n[1][2] * a.z;
+    const float az = n[2][0] * a.x + n[2][1] * a.y + n[2][2] * a.z;
+    const float length = std::sqrt(ax * ax + ay * ay + az * az);
+    if (!(length > 0)) return MeshletCull::VISIBLE;
+    const float cos_phi = az / length;
+    const float sin_phi = std::sqrt(std::max(0.f, 1.f - cos_phi * cos_phi));
+    const float cos_theta = meshlet.cone_cutoff;
+    const float sin_theta = std::sqrt(std::max(0.f, 1.f - cos_theta * cos_theta));
+    if (cos_phi * cos_theta + sin_phi * sin_theta < -backface_margin)
+        return MeshletCull::BACKFACE;
+    return MeshletCull::VISIBLE;
+}
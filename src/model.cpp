@@ -1,34 +1,280 @@
 #include "model.h"
-#include <fstream>
-#include <sstream>
+#include "mapped_file.h"
+#include "mesh_cache.h"
+#include "obj_parse.h"
+#include <algorithm>
+
+namespace {
+
+using namespace obj_parse;
+
+// 文件按约 chunk_bytes 字节切分, 各分块由不同线程解析
+// 分块边界向后对齐到换行符, 保证每行完整地属于一个分块
+constexpr std::size_t chunk_bytes = std::size_t(1) << 22;
+
+// 单个分块内各类元素的个数, 前缀和之后改为写入偏移
+struct ChunkInfo {
+    const char *begin = nullptr, *end = nullptr;
+    std::size_t lines = 0;
+    std::size_t vertices = 0, tex_coords = 0, normals = 0, triangles = 0;
+    // 第一个解析失败的行在分块内的行号, 从 1 开始, 0 表示没有错误
+    std::size_t error_line = 0;
+    std::size_t errors = 0;
+};
+
+} // namespace
 
 Model::Model(const std::string &filename) {
-    std::ifstream in(filename);
-    if (!in.is_open()) {
-        std::cerr << "Failed to open " << filename << '\n';
+    // 传入 .smesh 时源文件名由缓存自己记录
+    const bool is_cache = is_mesh_cache_path(filename);
+    const std::string cache = is_cache ? filename : mesh_cache_path(filename);
+    if (load_cache(cache, is_cache ? std::string() : filename)) {
+        std::cerr << "Mesh cache: " << cache << '\n';
+    } else if (is_cache) {
+        // 缓存无效或过期, 回退到解析缓存记录的源 OBJ
+        const std::string source = mesh_cache_source(filename);
+        if (source.empty()) {
+            std::cerr << "Mesh cache " << filename << " has no usable source\n";
+            return;
+        }
+        if (!load_obj(source)) return;
+    } else if (!load_obj(filename)) {
         return;
     }
 
-    std::string line;
-    while (std::getline(in, line)) {
-        std::stringstream line_ss(line);
-        std::string prefix;
-        line_ss >> prefix;
-        if (prefix == "v") {
-            float x, y, z;
-            line_ss >> x >> y >> z;
-            vertices_.push_back({x, y, z});
-        } else if (prefix == "f") {
-            std::string seg;
-            while (line_ss >> seg) {
-                std::stringstream seg_ss(seg);
-                int index;
-                seg_ss >> index;
-                faces_.push_back(--index);
+    std::cerr << "Vertices: #" << num_vertices() << '\n';
+    std::cerr << "Faces: #" << num_faces() << '\n';
+}
+
+// 两遍解析:
+// 1. 并行统计每个分块中 v / vt / vn 的个数和面三角化后的三角形个数
+// 2. 前缀和得到每个分块的写入偏移, 一次性分配好各数组, 再并行解析写入
+// 多边形面按扇形三角化, 支持负数的相对索引
+bool Model::load_obj(const std::string &filename) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        std::cerr << "Failed to open " << filename << '\n';
+        return false;
+    }
+    const char *data = file.data();
+    const char *data_end = data + file.size();
+
+    std::vector<ChunkInfo> chunks;
+    for (const char *p = data; p < data_end;) {
+        const char *end = p + std::min(chunk_bytes, std::size_t(data_end - p));
+        if (end < data_end) end = next_line(find_line_end(end, data_end), data_end);
+        ChunkInfo chunk;
+        chunk.begin = p;
+        chunk.end = end;
+        chunks.push_back(chunk);
+        p = end;
+    }
+    const int num_chunks = chunks.size();
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < num_chunks; ++c) {
+        ChunkInfo &chunk = chunks[c];
+        for (const char *p = chunk.begin; p < chunk.end;) {
+            const char *eol = find_line_end(p, chunk.end);
+            ++chunk.lines;
+            switch (line_type(p, eol)) {
+            case VERTEX: ++chunk.vertices; break;
+            case TEX_COORD: ++chunk.tex_coords; break;
+            case NORMAL: ++chunk.normals; break;
+            case FACE: {
+                std::size_t n = count_tokens(p, eol);
+                chunk.triangles += n >= 3 ? n - 2 : 0;
+                break;
             }
+            default: break;
+            }
+            p = next_line(eol, chunk.end);
         }
     }
 
-    std::cerr << "Vertices: #" << num_vertices() << '\n';
-    std::cerr << "Faces: #" << num_faces() << '\n';
+    // 前缀和, ChunkInfo 中的个数改为该分块第一个元素的全局下标
+    std::size_t totals[5] = {0, 0, 0, 0, 0};
+    for (ChunkInfo &chunk : chunks) {
+        std::size_t *fields[5] = {&chunk.lines, &chunk.vertices,
+                                  &chunk.tex_coords, &chunk.normals,
+                                  &chunk.triangles};
+        for (int k = 0; k < 5; ++k) {
+            std::size_t count = *fields[k];
+            *fields[k] = totals[k];
+            totals[k] += count;
+        }
+    }
+    const std::size_t total_vertices = totals[1];
+    const std::size_t total_tex_coords = totals[2];
+    const std::size_t total_normals = totals[3];
+    const std::size_t total_triangles = totals[4];
+
+    vertices_.resize(total_vertices);
+    tex_coords_.resize(total_tex_coords);
+    normals_.resize(total_normals);
+    faces_.resize(total_triangles * 3);
+    face_tex_coords_.resize(total_triangles * 3);
+    face_normals_.resize(total_triangles * 3);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < num_chunks; ++c) {
+        ChunkInfo &chunk = chunks[c];
+        std::size_t v = chunk.vertices, vt = chunk.tex_coords,
+                    vn = chunk.normals, t = chunk.triangles;
+        std::size_t line = 0;
+        auto report = [&]() {
+            if (!chunk.errors++) chunk.error_line = line;
+        };
+
+        for (const char *p = chunk.begin; p < chunk.end;) {
+            const char *eol = find_line_end(p, chunk.end);
+            ++line;
+            switch (line_type(p, eol)) {
+            case VERTEX: {
+                Vec3f &vertex = vertices_[v++];
+                if (!parse_float(p, eol, vertex.x) ||
+                    !parse_float(p, eol, vertex.y) ||
+                    !parse_float(p, eol, vertex.z))
+                    report();
+                break;
+            }
+            case TEX_COORD: {
+                // vt u [v [w]], 只保留 u, v
+                Vec2f &tex_coord = tex_coords_[vt++];
+                if (!parse_float(p, eol, tex_coord[0])) report();
+                const char *q = skip_spaces(p, eol);
+                if (q < eol && !parse_float(p, eol, tex_coord[1])) report();
+                break;
+            }
+            case NORMAL: {
+                Vec3f &normal = normals_[vn++];
+                if (!parse_float(p, eol, normal.x) ||
+                    !parse_float(p, eol, normal.y) ||
+                    !parse_float(p, eol, normal.z))
+                    report();
+                break;
+            }
+            case FACE: {
+                // 扇形三角化: (0, k - 1, k)
+                int first[3], prev[3], cur[3];
+                bool ok = true;
+                int n = 0;
+                for (p = skip_spaces(p, eol); p < eol; p = skip_spaces(p, eol), ++n) {
+                    int raw[3];
+                    if (!parse_face_vertex(p, eol, raw)) ok = false;
+                    cur[0] = resolve_index(raw[0], v, total_vertices);
+                    cur[1] = resolve_index(raw[1], vt, total_tex_coords);
+                    cur[2] = resolve_index(raw[2], vn, total_normals);
+                    if (cur[0] < 0 || cur[1] == -2 || cur[2] == -2) ok = false;
+
+                    if (n == 0) std::copy(cur, cur + 3, first);
+                    if (n >= 2) {
+                        const int *corners[3] = {first, prev, cur};
+                        for (int j = 0; j < 3; ++j) {
+                            faces_[t * 3 + j] = corners[j][0];
+                            face_tex_coords_[t * 3 + j] = corners[j][1];
+                            face_normals_[t * 3 + j] = corners[j][2];
+                        }
+                        ++t;
+                    }
+                    std::copy(cur, cur + 3, prev);
+                }
+                if (!ok) {
+                    report();
+                    // 标记该行产生的三角形无效, 之后统一删除
+                    for (int k = 0; k < n - 2; ++k) faces_[(t - 1 - k) * 3] = -1;
+                }
+                break;
+            }
+            default: break;
+            }
+            p = next_line(eol, chunk.end);
+        }
+    }
+
+    std::size_t errors = 0;
+    for (const ChunkInfo &chunk : chunks) {
+        if (chunk.errors && !errors) {
+            std::cerr << "Failed to parse line "
+                      << chunk.lines + chunk.error_line << " of " << filename
+                      << '\n';
+        }
+        errors += chunk.errors;
+    }
+    if (errors) {
+        std::cerr << errors << " malformed line(s) in " << filename << '\n';
+        // 删除索引无效的三角形
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < total_triangles; ++i) {
+            if (faces_[i * 3] < 0 || faces_[i * 3 + 1] < 0 || faces_[i * 3 + 2] < 0)
+                continue;
+            for (int j = 0; j < 3; ++j) {
+                faces_[kept * 3 + j] = faces_[i * 3 + j];
+                face_tex_coords_[kept * 3 + j] = face_tex_coords_[i * 3 + j];
+                face_normals_[kept * 3 + j] = face_normals_[i * 3 + j];
+            }
+            ++kept;
+        }
+        faces_.resize(kept * 3);
+        face_tex_coords_.resize(kept * 3);
+        face_normals_.resize(kept * 3);
+    }
+
+    return true;
+}
+
+namespace {
+
+// 按 order 重排每 3 个一组的面索引, 临时数组从 arena 分配, 用完即复位
+void permute_faces(MeshArray<int> &array, const std::vector<int> &order, Arena &arena) {
+    int *permuted = arena.allocate_array<int>(array.size());
+    for (std::size_t k = 0; k < order.size(); ++k) {
+        for (int j = 0; j < 3; ++j) permuted[k * 3 + j] = array[order[k] * 3 + j];
+    }
+    std::copy(permuted, permuted + array.size(), array.data());
+    arena.reset();
+}
+
+// 按首次出现的顺序重新编号 indices 引用的 values, 索引为 -1 的保持不变
+// 临时数组从 arena 分配, 用完即复位
+template <typename T>
+void renumber(MeshArray<T> &values, MeshArray<int> &indices, Arena &arena) {
+    const int n = values.size();
+    int *remap = arena.allocate_array<int>(n);
+    std::fill(remap, remap + n, -1);
+    T *renumbered = arena.allocate_array<T>(n);
+    int count = 0;
+    for (std::size_t i = 0; i < indices.size(); ++i) {
+        int &index = indices[i];
+        if (index < 0) continue;
+        if (remap[index] < 0) {
+            remap[index] = count;
+            renumbered[count++] = values[index];
+        }
+        index = remap[index];
+    }
+    for (int i = 0; i < n; ++i) {
+        if (remap[i] < 0) renumbered[count++] = values[i];
+    }
+    std::copy(renumbered, renumbered + n, values.data());
+    arena.reset();
+}
+
+} // namespace
+
+// 映射的缓存是写时复制的, 可以原地修改
+void Model::reorder_faces(const std::vector<int> &order, Arena *scratch) {
+    Arena local_scratch;
+    Arena &arena = scratch ? *scratch : local_scratch;
+    permute_faces(faces_, order, arena);
+    permute_faces(face_tex_coords_, order, arena);
+    permute_faces(face_normals_, order, arena);
+}
+
+void Model::renumber_vertices(Arena *scratch) {
+    Arena local_scratch;
+    Arena &arena = scratch ? *scratch : local_scratch;
+    renumber(vertices_, faces_, arena);
+    renumber(tex_coords_, face_tex_coords_, arena);
+    renumber(normals_, face_normals_, arena);
 }
\ No newline at end of file
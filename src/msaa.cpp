@@ -0,0 +1,451 @@
+#include "msaa.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RENDERER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// D3D 标准采样模式, 单位为 1/16 像素, y 轴已翻转为向上
+// 偏移都在 [-7, 7] 内, 采样点严格位于像素内部
+constexpr std::int8_t sample_offsets_4[4][2] = {{-2, 6}, {6, 2}, {-6, -2}, {2, -6}};
+constexpr std::int8_t sample_offsets_8[8][2] = {{1, 3},  {-1, -3}, {5, -1}, {-3, 5},
+                                                {-5, -5}, {-7, 1},  {3, -7}, {7, 7}};
+
+// 传给内循环的整数边函数截断到 [-edge_limit, edge_limit], 与 edge_rasterizer.cpp 相同
+// 采样点相对像素中心的边函数偏移不超过 2^26, 截断前后各采样点的符号不变, 加上偏移后不超过 32 位
+constexpr std::int64_t edge_limit = std::int64_t(1) << 30;
+
+std::int32_t clamp_edge(std::int64_t value) {
+    return static_cast<std::int32_t>(std::min(std::max(value, -edge_limit), edge_limit));
+}
+
+// 一个三角形的多重采样光栅化参数
+// 第 l 个通道对应像素 l / Samples 的第 l % Samples 个采样点, 4 个采样点时两个像素占满 8 个通道
+// 采样点的边函数为像素中心的边函数加 edge_offsets, 深度为像素中心的深度加 z_offsets,
+// 再截断到顶点深度的范围 [z_lo, z_hi]
+struct MsaaSetup {
+    alignas(32) std::int32_t edge_offsets[3][max_msaa_samples];
+    alignas(32) float z_offsets[max_msaa_samples];
+    float dzdx;
+    float z_lo, z_hi;
+    PackedPixel pixel;
+};
+
+// 一行 count 个像素, 第一个像素的整数边函数为 edge, 深度为 z_start, 每向右一个像素边函数加 step
+// depth / target 指向第一个像素的第一个采样点
+struct MsaaRow {
+    int count;
+    std::int64_t edge[3], step[3];
+    float z_start;
+    float *depth;
+    PackedPixel *target;
+    std::uint16_t *overdraw; // 为空时不统计
+};
+
+struct MsaaCounts {
+    std::int64_t covered = 0, passed = 0;
+};
+
+// 覆盖次数加 1, 达到上限后不再增加
+inline void count_overdraw(std::uint16_t &count) { count += count != 0xffff; }
+
+// 像素中心的深度与 edge_rasterizer 相同: z_start + dzdx * dx, 各路径都在标量中求出,
+// 采样点的深度 min(max(z + z_offset, z_lo), z_hi) 按相同的顺序计算, 各路径逐采样点一致
+template <int Samples>
+void msaa_row_scalar(const MsaaSetup &setup, const MsaaRow &row, MsaaCounts &counts) {
+    std::int64_t e0 = row.edge[0], e1 = row.edge[1], e2 = row.edge[2];
+    float *depth = row.depth;
+    PackedPixel *target = row.target;
+    for (int i = 0; i < row.count; ++i, e0 += row.step[0], e1 += row.step[1],
+             e2 += row.step[2], depth += Samples, target += Samples) {
+        const std::int32_t c0 = clamp_edge(e0), c1 = clamp_edge(e1), c2 = clamp_edge(e2);
+        unsigned mask = 0;
+        for (int k = 0; k < Samples; ++k) {
+            if (((c0 + setup.edge_offsets[0][k]) | (c1 + setup.edge_offsets[1][k]) |
+                 (c2 + setup.edge_offsets[2][k])) >= 0)
+                mask |= 1u << k;
+        }
+        if (!mask) continue;
+        ++counts.covered;
+        RENDERER_STATS_ONLY(if (row.overdraw) count_overdraw(row.overdraw[i]);)
+        const float z_center = row.z_start + setup.dzdx * static_cast<float>(i);
+        bool passed = false;
+        for (; mask; mask &= mask - 1) {
+            const int k = __builtin_ctz(mask);
+            const float z =
+                std::min(setup.z_hi, std::max(setup.z_lo, z_center + setup.z_offsets[k]));
+            if (z > depth[k]) {
+                passed = true;
+                depth[k] = z;
+                target[k] = setup.pixel;
+            }
+        }
+        counts.passed += passed;
+    }
+}
+
+#ifdef RENDERER_X86
+
+// SSE2 没有按掩码存储, 未通过的通道写回原值; 每个 tile 只由一个线程写入, 不会冲突
+inline __m128 select_ps(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// 每次处理一个像素, 8 个采样点分两组, 每组 4 个
+template <int Samples>
+void msaa_row_sse(const MsaaSetup &setup, const MsaaRow &row, MsaaCounts &counts) {
+    constexpr int groups = Samples / 4;
+    const __m128i minus_one = _mm_set1_epi32(-1);
+    const __m128 z_lo = _mm_set1_ps(setup.z_lo);
+    const __m128 z_hi = _mm_set1_ps(setup.z_hi);
+    const __m128 pixel = _mm_castsi128_ps(_mm_set1_epi32(setup.pixel));
+    std::int64_t e0 = row.edge[0], e1 = row.edge[1], e2 = row.edge[2];
+    float *depth = row.depth;
+    PackedPixel *target = row.target;
+    for (int i = 0; i < row.count; ++i, e0 += row.step[0], e1 += row.step[1],
+             e2 += row.step[2], depth += Samples, target += Samples) {
+        const __m128i c0 = _mm_set1_epi32(clamp_edge(e0));
+        const __m128i c1 = _mm_set1_epi32(clamp_edge(e1));
+        const __m128i c2 = _mm_set1_epi32(clamp_edge(e2));
+        __m128 inside[groups];
+        int mask = 0;
+        for (int g = 0; g < groups; ++g) {
+            const __m128i s0 = _mm_add_epi32(
+                c0, _mm_load_si128(reinterpret_cast<const __m128i *>(setup.edge_offsets[0] + g * 4)));
+            const __m128i s1 = _mm_add_epi32(
+                c1, _mm_load_si128(reinterpret_cast<const __m128i *>(setup.edge_offsets[1] + g * 4)));
+            const __m128i s2 = _mm_add_epi32(
+                c2, _mm_load_si128(reinterpret_cast<const __m128i *>(setup.edge_offsets[2] + g * 4)));
+            inside[g] = _mm_castsi128_ps(
+                _mm_cmpgt_epi32(_mm_or_si128(_mm_or_si128(s0, s1), s2), minus_one));
+            mask |= _mm_movemask_ps(inside[g]) << g * 4;
+        }
+        if (!mask) continue;
+        ++counts.covered;
+        RENDERER_STATS_ONLY(if (row.overdraw) count_overdraw(row.overdraw[i]);)
+        const __m128 z_center =
+            _mm_set1_ps(row.z_start + setup.dzdx * static_cast<float>(i));
+        int pass_mask = 0;
+        for (int g = 0; g < groups; ++g) {
+            const __m128 new_z = _mm_min_ps(
+                _mm_max_ps(_mm_add_ps(z_center, _mm_load_ps(setup.z_offsets + g * 4)), z_lo),
+                z_hi);
+            const __m128 old_z = _mm_loadu_ps(depth + g * 4);
+            const __m128 pass = _mm_and_ps(inside[g], _mm_cmpgt_ps(new_z, old_z));
+            const int group_pass = _mm_movemask_ps(pass);
+            if (!group_pass) continue;
+            pass_mask |= group_pass;
+            _mm_storeu_ps(depth + g * 4, select_ps(pass, new_z, old_z));
+            float *colors = reinterpret_cast<float *>(target + g * 4);
+            _mm_storeu_ps(colors, select_ps(pass, pixel, _mm_loadu_ps(colors)));
+        }
+        counts.passed += pass_mask != 0;
+    }
+}
+
+// 一次处理 8 个通道: 8 个采样点时一个像素, 4 个采样点时两个像素
+// 行尾不足两个像素时屏蔽后 4 个通道, 不读写行尾之外的采样点
+template <int Samples>
+__attribute__((target("avx2"))) void msaa_row_avx2(const MsaaSetup &setup,
+                                                    const MsaaRow &row,
+                                                    MsaaCounts &counts) {
+    constexpr int pixels = 8 / Samples;
+    constexpr int pixel_mask = (1 << Samples) - 1;
+    const __m256i minus_one = _mm256_set1_epi32(-1);
+    const __m256i offsets0 = _mm256_load_si256(reinterpret_cast<const __m256i *>(setup.edge_offsets[0]));
+    const __m256i offsets1 = _mm256_load_si256(reinterpret_cast<const __m256i *>(setup.edge_offsets[1]));
+    const __m256i offsets2 = _mm256_load_si256(reinterpret_cast<const __m256i *>(setup.edge_offsets[2]));
+    const __m256 z_offsets = _mm256_load_ps(setup.z_offsets);
+    const __m256 z_lo = _mm256_set1_ps(setup.z_lo);
+    const __m256 z_hi = _mm256_set1_ps(setup.z_hi);
+    const __m256i pixel = _mm256_set1_epi32(setup.pixel);
+    // 每个通道所属的像素, 与行尾之前剩余的像素个数比较得到有效的通道
+    const __m256i lane_pixel = _mm256_setr_epi32(0, 0, 0, 0, pixels - 1, pixels - 1,
+                                                 pixels - 1, pixels - 1);
+    std::int64_t e[3] = {row.edge[0], row.edge[1], row.edge[2]};
+    float *depth = row.depth;
+    PackedPixel *target = row.target;
+    for (int i = 0; i < row.count; i += pixels, depth += 8, target += 8) {
+        // 每个像素中心的截断边函数与深度, 4 个采样点时第二个像素可能在行尾之外
+        std::int32_t c[pixels][3];
+        float z_center[pixels];
+        for (int p = 0; p < pixels; ++p) {
+            for (int j = 0; j < 3; ++j) {
+                c[p][j] = clamp_edge(e[j]);
+                e[j] += row.step[j];
+            }
+            z_center[p] = row.z_start + setup.dzdx * static_cast<float>(i + p);
+        }
+        __m256i c0, c1, c2;
+        __m256 z;
+        if constexpr (pixels == 1) {
+            c0 = _mm256_set1_epi32(c[0][0]);
+            c1 = _mm256_set1_epi32(c[0][1]);
+            c2 = _mm256_set1_epi32(c[0][2]);
+            z = _mm256_set1_ps(z_center[0]);
+        } else {
+            c0 = _mm256_setr_m128i(_mm_set1_epi32(c[0][0]), _mm_set1_epi32(c[1][0]));
+            c1 = _mm256_setr_m128i(_mm_set1_epi32(c[0][1]), _mm_set1_epi32(c[1][1]));
+            c2 = _mm256_setr_m128i(_mm_set1_epi32(c[0][2]), _mm_set1_epi32(c[1][2]));
+            z = _mm256_setr_m128(_mm_set1_ps(z_center[0]), _mm_set1_ps(z_center[1]));
+        }
+        const __m256i valid =
+            _mm256_cmpgt_epi32(_mm256_set1_epi32(row.count - i), lane_pixel);
+        const __m256i s0 = _mm256_add_epi32(c0, offsets0);
+        const __m256i s1 = _mm256_add_epi32(c1, offsets1);
+        const __m256i s2 = _mm256_add_epi32(c2, offsets2);
+        const __m256 inside = _mm256_castsi256_ps(_mm256_and_si256(
+            _mm256_cmpgt_epi32(_mm256_or_si256(_mm256_or_si256(s0, s1), s2), minus_one),
+            valid));
+        const int mask = _mm256_movemask_ps(inside);
+        if (!mask) continue;
+        for (int p = 0; p < pixels; ++p) {
+            if (!(mask >> p * Samples & pixel_mask)) continue;
+            ++counts.covered;
+            RENDERER_STATS_ONLY(if (row.overdraw) count_overdraw(row.overdraw[i + p]);)
+        }
+
+        const __m256 new_z =
+            _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(z, z_offsets), z_lo), z_hi);
+        const __m256 old_z = _mm256_maskload_ps(depth, valid);
+        const __m256 pass = _mm256_and_ps(inside, _mm256_cmp_ps(new_z, old_z, _CMP_GT_OQ));
+        const int pass_mask = _mm256_movemask_ps(pass);
+        if (!pass_mask) continue;
+        for (int p = 0; p < pixels; ++p) counts.passed += (pass_mask >> p * Samples & pixel_mask) != 0;
+        _mm256_maskstore_ps(depth, _mm256_castps_si256(pass), new_z);
+        _mm256_maskstore_epi32(reinterpret_cast<int *>(target), _mm256_castps_si256(pass),
+                               pixel);
+    }
+}
+
+#endif
+
+using MsaaRowFunction = void (*)(const MsaaSetup &setup, const MsaaRow &row,
+                                 MsaaCounts &counts);
+
+template <int Samples> MsaaRowFunction msaa_row_function(RasterPath path) {
+#ifdef RENDERER_X86
+    if (path == RasterPath::AVX2) return msaa_row_avx2<Samples>;
+    if (path == RasterPath::SSE) return msaa_row_sse<Samples>;
+#endif
+    return msaa_row_scalar<Samples>;
+}
+
+// 一个像素的解析: 颜色的每个通道为各采样点之和加 Samples / 2 再除以 Samples,
+// 深度为各采样点的最大值; 所有路径都是整数运算与取最大值, 结果逐位一致
+template <int Samples>
+void resolve_pixel_scalar(const PackedPixel *colors, const float *depth, PackedPixel &pixel,
+                          float &z) {
+    constexpr int shift = Samples == 4 ? 2 : 3;
+    std::uint32_t sum[4] = {};
+    float max_z = depth[0];
+    for (int k = 0; k < Samples; ++k) {
+        for (int j = 0; j < 4; ++j) sum[j] += colors[k] >> (8 * j) & 0xff;
+        // 参数顺序与 _mm_max_ps 的语义一致
+        max_z = std::max(depth[k], max_z);
+    }
+    pixel = 0;
+    for (int j = 0; j < 4; ++j) pixel |= (sum[j] + Samples / 2) >> shift << (8 * j);
+    z = max_z;
+}
+
+#ifdef RENDERER_X86
+
+// 每个采样点的 4 个通道零扩展为 16 位后相加, 再把两半相加得到 4 个通道之和
+template <int Samples>
+void resolve_pixel_sse(const PackedPixel *colors, const float *depth, PackedPixel &pixel,
+                       float &z) {
+    constexpr int shift = Samples == 4 ? 2 : 3;
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    __m128 max_z = _mm_loadu_ps(depth);
+    for (int g = 0; g < Samples / 4; ++g) {
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(colors + g * 4));
+        sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_unpacklo_epi8(c, zero),
+                                               _mm_unpackhi_epi8(c, zero)));
+        if (g) max_z = _mm_max_ps(_mm_loadu_ps(depth + g * 4), max_z);
+    }
+    sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+    sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(Samples / 2)), shift);
+    pixel = static_cast<PackedPixel>(_mm_cvtsi128_si32(_mm_packus_epi16(sum, zero)));
+    max_z = _mm_max_ps(_mm_movehl_ps(max_z, max_z), max_z);
+    max_z = _mm_max_ss(_mm_shuffle_ps(max_z, max_z, 1), max_z);
+    z = _mm_cvtss_f32(max_z);
+}
+
+// 一次读入 8 个采样点 (一个 8x 像素或两个 4x 像素) 的 32 字节
+template <int Samples>
+__attribute__((target("avx2"))) void resolve_pixels_avx2(const PackedPixel *colors,
+                                                         const float *depth,
+                                                         PackedPixel pixel[2], float z[2]) {
+    constexpr int shift = Samples == 4 ? 2 : 3;
+    const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(colors));
+    const __m256i zero = _mm256_setzero_si256();
+    // 每个 128 位半边内: 4 个采样点的通道之和
+    __m256i sum = _mm256_add_epi16(_mm256_unpacklo_epi8(c, zero), _mm256_unpackhi_epi8(c, zero));
+    sum = _mm256_add_epi16(sum, _mm256_srli_si256(sum, 8));
+    __m256 max_z = _mm256_loadu_ps(depth);
+    max_z = _mm256_max_ps(_mm256_permute_ps(max_z, 0x4e), max_z);
+    max_z = _mm256_max_ps(_mm256_permute_ps(max_z, 0xb1), max_z);
+    if constexpr (Samples == 8) {
+        sum = _mm256_add_epi16(sum, _mm256_permute2x128_si256(sum, sum, 0x01));
+        max_z = _mm256_max_ps(_mm256_permute2f128_ps(max_z, max_z, 0x01), max_z);
+    }
+    sum = _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(Samples / 2)), shift);
+    const __m256i packed = _mm256_packus_epi16(sum, zero);
+    pixel[0] = static_cast<PackedPixel>(_mm256_cvtsi256_si32(packed));
+    z[0] = _mm256_cvtss_f32(max_z);
+    if constexpr (Samples == 4) {
+        pixel[1] = static_cast<PackedPixel>(
+            _mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1)));
+        z[1] = _mm_cvtss_f32(_mm256_extractf128_ps(max_z, 1));
+    }
+}
+
+#endif
+
+template <int Samples, PixelFormat Format>
+void resolve_rows(const MsaaBuffer &buffer, Framebuffer<Format> &frame_buffer,
+                  DepthBuffer &depth_buffer, int x_min, int y_min, int x_max, int y_max,
+                  RasterPath path) {
+    constexpr int bytespp = Framebuffer<Format>::bytespp;
+    for (int y = y_min; y <= y_max; ++y) {
+        const PackedPixel *colors = buffer.colors(x_min, y);
+        const float *depth = buffer.depth(x_min, y);
+        std::uint8_t *dst = frame_buffer.pixel(x_min, y);
+        float *z_row = depth_buffer.row(y);
+        int x = x_min;
+#ifdef RENDERER_X86
+        if (path == RasterPath::AVX2) {
+            constexpr int pixels = 8 / Samples;
+            PackedPixel pixel[2];
+            float z[2];
+            for (; x + pixels - 1 <= x_max; x += pixels, colors += 8, depth += 8) {
+                resolve_pixels_avx2<Samples>(colors, depth, pixel, z);
+                for (int p = 0; p < pixels; ++p) {
+                    Framebuffer<Format>::store(dst, pixel[p]);
+                    dst += bytespp;
+                    z_row[x + p] = z[p];
+                }
+            }
+        }
+        if (path == RasterPath::AVX2 || path == RasterPath::SSE) {
+            for (; x <= x_max; ++x, colors += Samples, depth += Samples, dst += bytespp) {
+                PackedPixel pixel;
+                resolve_pixel_sse<Samples>(colors, depth, pixel, z_row[x]);
+                Framebuffer<Format>::store(dst, pixel);
+            }
+        }
+#endif
+        for (; x <= x_max; ++x, colors += Samples, depth += Samples, dst += bytespp) {
+            PackedPixel pixel;
+            resolve_pixel_scalar<Samples>(colors, depth, pixel, z_row[x]);
+            Framebuffer<Format>::store(dst, pixel);
+        }
+    }
+}
+
+} // namespace
+
+const std::int8_t (*msaa_sample_offsets(int samples))[2] {
+    return samples == 8 ? sample_offsets_8 : sample_offsets_4;
+}
+
+MsaaBuffer::MsaaBuffer(const int width, const int height, const int samples)
+    : width_(width), height_(height), samples_(samples),
+      colors_(static_cast<std::size_t>(width) * height * samples, 0),
+      depth_(static_cast<std::size_t>(width) * height * samples, 0.f) {}
+
+void MsaaBuffer::clear(PackedPixel color, float depth) {
+    std::fill(colors_.begin(), colors_.end(), color);
+    std::fill(depth_.begin(), depth_.end(), depth);
+}
+
+template <PixelFormat Format>
+void MsaaBuffer::resolve(Framebuffer<Format> &frame_buffer, DepthBuffer &depth_buffer,
+                         int x_min, int y_min, int x_max, int y_max, RasterPath path) const {
+    if (x_min > x_max || y_min > y_max) return;
+    if (samples_ == 8) {
+        resolve_rows<8>(*this, frame_buffer, depth_buffer, x_min, y_min, x_max, y_max, path);
+    } else {
+        resolve_rows<4>(*this, frame_buffer, depth_buffer, x_min, y_min, x_max, y_max, path);
+    }
+    constexpr int block_size = DepthBuffer::block_size;
+    for (int y = y_min / block_size * block_size; y <= y_max; y += block_size) {
+        for (int x = x_min / block_size * block_size; x <= x_max; x += block_size)
+            depth_buffer.mark_dirty(x, y);
+    }
+}
+
+std::int64_t triangle_rasterize_msaa(const Vec3f &p0, const Vec3f &p1, const Vec3f &p2,
+                                     MsaaBuffer &buffer, PackedPixel *target,
+                                     PackedPixel pixel, int clip_x_min, int clip_y_min,
+                                     int clip_x_max, int clip_y_max, RasterPath path,
+                                     ThreadStats *stats) {
+    FixedPointTriangle triangle;
+    if (!triangle.setup(p0, p1, p2)) return 0;
+    // 采样点偏离像素中心不到半个像素, 包含采样点的像素最多比中心的像素范围向外多一个像素
+    const int x_min = std::max(triangle.x_min - 1, clip_x_min);
+    const int x_max = std::min(triangle.x_max + 1, clip_x_max);
+    const int y_min = std::max(triangle.y_min - 1, clip_y_min);
+    const int y_max = std::min(triangle.y_max + 1, clip_y_max);
+    if (x_min > x_max || y_min > y_max) return 0;
+
+    const int samples = buffer.get_samples();
+    const std::int8_t(*offsets)[2] = msaa_sample_offsets(samples);
+    const DepthPlane plane(triangle, p0, p1, p2);
+    const double dzdx = plane.at(triangle.a), dzdy = plane.at(triangle.b);
+    MsaaSetup setup;
+    // a_i, b_i 为每像素的步进, 是 subpixel_scale 的整数倍, 采样点的偏移以 1/16 像素为单位
+    for (int l = 0; l < max_msaa_samples; ++l) {
+        const int ox = offsets[l % samples][0], oy = offsets[l % samples][1];
+        for (int i = 0; i < 3; ++i) {
+            setup.edge_offsets[i][l] = static_cast<std::int32_t>(
+                triangle.a[i] / subpixel_scale * ox + triangle.b[i] / subpixel_scale * oy);
+        }
+        setup.z_offsets[l] = static_cast<float>((dzdx * ox + dzdy * oy) / subpixel_scale);
+    }
+    setup.dzdx = static_cast<float>(dzdx);
+    setup.z_lo = std::min(std::min(p0.z, p1.z), p2.z);
+    setup.z_hi = std::max(std::max(p0.z, p1.z), p2.z);
+    setup.pixel = pixel;
+    const MsaaRowFunction row_function =
+        samples == 8 ? msaa_row_function<8>(path) : msaa_row_function<4>(path);
+
+    MsaaRow row;
+    row.count = x_max - x_min + 1;
+    for (int i = 0; i < 3; ++i) row.step[i] = triangle.a[i];
+    row.overdraw = nullptr;
+    MsaaCounts counts;
+    std::int64_t edge_row[3];
+    for (int i = 0; i < 3; ++i) edge_row[i] = triangle.edge(i, x_min, y_min);
+    for (int y = y_min; y <= y_max; ++y) {
+        for (int i = 0; i < 3; ++i) {
+            row.edge[i] = edge_row[i];
+            edge_row[i] += triangle.b[i];
+        }
+        row.z_start = static_cast<float>(plane.at(row.edge));
+        row.depth = buffer.depth(x_min, y);
+        row.target =
+            target ? target + buffer.sample_index(x_min, y) : buffer.colors(x_min, y);
+        RENDERER_STATS_ONLY(
+            if (stats && stats->overdraw) row.overdraw =
+                stats->overdraw + y * stats->overdraw_width + x_min;)
+        row_function(setup, row, counts);
+    }
+    RENDERER_STATS_ADD(stats, pixels_passed, counts.passed);
+    return counts.covered;
+}
+
+#define INSTANTIATE_MSAA_RESOLVE(Format)                                       \
+    template void MsaaBuffer::resolve<Format>(Framebuffer<Format> &,           \
+                                              DepthBuffer &, int, int, int,    \
+                                              int, RasterPath) const;
+INSTANTIATE_MSAA_RESOLVE(PixelFormat::GRAYSCALE)
+INSTANTIATE_MSAA_RESOLVE(PixelFormat::RGB)
+INSTANTIATE_MSAA_RESOLVE(PixelFormat::RGBA)
+#undef INSTANTIATE_MSAA_RESOLVE
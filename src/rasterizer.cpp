@@ -0,0 +1,842 @@
+#include "rasterizer.h"
+#include "vertex_stage.h"
+#include <algorithm>
+#include <cstdint>
+#include <omp.h>
+#include <vector>
+
+namespace {
+
+// 32 位整数哈希, 用于生成可复现的伪随机数
+std::uint32_t hash_u32(std::uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// 为编号 first_face 起的 count 个面生成伪随机颜色
+// 颜色只由种子和面的编号决定, 相同种子每次渲染的结果相同,
+// 串行、分块与逐块流式渲染几种路径着色一致, 也可以并行生成
+void face_colors(std::uint32_t seed, int first_face, int count, TgaColor *colors) {
+    const std::uint32_t base = hash_u32(seed) + static_cast<std::uint32_t>(first_face);
+#pragma omp parallel for schedule(static) if (count > 65536)
+    for (int i = 0; i < count; ++i) {
+        const std::uint32_t h = hash_u32(base + i);
+        for (int j = 0; j < 3; ++j) colors[i][j] = (h >> (8 * j) & 0xff) % 255;
+    }
+}
+
+// 剔除结果
+enum class CullResult { VISIBLE, BACKFACE, DEGENERATE };
+
+// 屏幕空间的背面剔除
+CullResult cull_face(const Vec3f &a, const Vec3f &b, const Vec3f &c) {
+    // 背面剔除
+    // 背面剔除应该使用世界坐标来做
+    // 但是目前渲染条件为: 右手坐标系, 使用的模型局部坐标均在 [-1, 1]^3, 直接拿来当作 NDC 坐标
+    // 右手坐标系, 如果使用的模型的局部坐标在 [-1, 1]^3, 那么将其直接拿来当作 NDC 坐标，这相当于自动进行了下面操作
+    // 1. 不进行模型变换，局部坐标就是世界坐标
+    // 2. 接着进行了相机在 z 轴某个能看清出模型全貌(就是和模型不重合)的位置,
+    // x, y, z 轴与世界坐标的 x, y, z 轴相同方向的视图变换
+    // 3. 然后进行了选取合适的长方体进行正交投影变换得到 NDC,
+    // 并且这个合适的长方体使得模型各点的 NDC 坐标与模型局部坐标相同的正交投影变换。
+    // 所以在目前相机看向 z 轴负方向且使用正交投影的特定条件下，
+    // 视口变换后的屏幕空间背面剔除是可行的，结果与世界坐标剔除等价。
+    // 这是因为正交投影保留了三维空间中 z 轴方向的朝向关系，
+    // 屏幕空间的顶点顺序和法向量分量可直接用于背面判定。
+    // 但需注意，当投影方式或观察方向改变时，仍需在三维坐标空间中执行标准背面剔除。
+    Vec3f AB{b.x - a.x, b.y - a.y, 0};
+    Vec3f AC{c.x - a.x, c.y - a.y, 0};
+    float z = AB.cross(AC).z;
+    constexpr float epsilon = 1e-6f;
+    // 当前使用的模型按照右手坐标系, 逆时针绕序为正面
+    // 叉积法判断三角形退化 |z| < epsilon 和背面剔除 z < 0 一起做
+    if (z >= epsilon) return CullResult::VISIBLE;
+    return z > -epsilon ? CullResult::DEGENERATE : CullResult::BACKFACE;
+}
+
+// 视口变换 + 背面剔除
+CullResult triangle_setup(const Model &model, int face_index, const int width,
+                          const int height, Vec3f &a, Vec3f &b, Vec3f &c) {
+    // 视口变换
+    // NDC -> 屏幕空间坐标
+    a = viewport_trans(model.vertex(face_index, 0), width, height);
+    b = viewport_trans(model.vertex(face_index, 1), width, height);
+    c = viewport_trans(model.vertex(face_index, 2), width, height);
+    return cull_face(a, b, c);
+}
+
+// 同上, 顶点已由顶点阶段变换过, 这里只按索引取出
+CullResult triangle_setup(const Model &model,
+                          const TransformedVertices &vertices, int face_index,
+                          Vec3f &a, Vec3f &b, Vec3f &c) {
+    a = vertices[model.vertex_index(face_index, 0)];
+    b = vertices[model.vertex_index(face_index, 1)];
+    c = vertices[model.vertex_index(face_index, 2)];
+    return cull_face(a, b, c);
+}
+
+// 可见性缓冲的着色: 对 [x_min, x_max]x[y_min, y_max] 内每个可见像素按面的编号取颜色写入帧缓冲
+// 同一行相邻的像素大多属于同一个面, 编号不变时沿用上一个像素的颜色
+// 返回着色的像素个数
+template <PixelFormat Format>
+std::int64_t shade_visibility(const VisibilityBuffer &visibility,
+                              const TgaColor *colors,
+                              Framebuffer<Format> &frame_buffer, int x_min, int y_min,
+                              int x_max, int y_max) {
+    std::int64_t shaded = 0;
+    for (int y = y_min; y <= y_max; ++y) {
+        const std::uint8_t *ids = visibility.pixel(x_min, y);
+        std::uint8_t *dst = frame_buffer.pixel(x_min, y);
+        PackedPixel last_id = 0, pixel = 0;
+        for (int x = x_min; x <= x_max; ++x, ids += VisibilityBuffer::bytespp,
+                 dst += Framebuffer<Format>::bytespp) {
+            const PackedPixel id = VisibilityBuffer::load(ids);
+            if (!id) continue;
+            if (id != last_id) {
+                last_id = id;
+                pixel = pack_color(colors[id - 1]);
+            }
+            Framebuffer<Format>::store(dst, pixel);
+            ++shaded;
+        }
+    }
+    return shaded;
+}
+
+// 一个面的纹理坐标平面: 正交投影下纹理坐标是屏幕坐标的线性函数
+// (u, v) = (u0, v0) + (dudx, dvdx) * (x - x0) + (dudy, dvdy) * (y - y0),
+// 其中 (x0, y0) 为第一个顶点的屏幕坐标, (x, y) 为像素中心
+struct TexturePlane {
+    float x0, y0, u0, v0;
+    float dudx, dvdx, dudy, dvdy;
+    int level; // 导数在面内为常数, 整个面使用同一级 mip
+};
+
+// 由屏幕空间的三个顶点与纹理坐标求平面, 面没有纹理坐标时返回 false
+bool texture_plane(const Model &model, const TriangleSetup &setup, int face,
+                   const Texture &texture, TexturePlane &plane) {
+    int index[3];
+    for (int j = 0; j < 3; ++j) {
+        index[j] = model.tex_coord_index(face, j);
+        if (index[j] < 0) return false;
+    }
+    const Vec2f &t0 = model.tex_coord(index[0]);
+    const Vec2f &t1 = model.tex_coord(index[1]);
+    const Vec2f &t2 = model.tex_coord(index[2]);
+    const float e1x = setup.p1.x - setup.p0.x, e1y = setup.p1.y - setup.p0.y;
+    const float e2x = setup.p2.x - setup.p0.x, e2y = setup.p2.y - setup.p0.y;
+    // 通过剔除的面面积为正
+    const float area = e1x * e2y - e1y * e2x;
+    const float du1 = t1[0] - t0[0], du2 = t2[0] - t0[0];
+    const float dv1 = t1[1] - t0[1], dv2 = t2[1] - t0[1];
+    plane.x0 = setup.p0.x;
+    plane.y0 = setup.p0.y;
+    plane.u0 = t0[0];
+    plane.v0 = t0[1];
+    plane.dudx = (du1 * e2y - du2 * e1y) / area;
+    plane.dudy = (du2 * e1x - du1 * e2x) / area;
+    plane.dvdx = (dv1 * e2y - dv2 * e1y) / area;
+    plane.dvdy = (dv2 * e1x - dv1 * e2x) / area;
+    plane.level = texture.select_level(plane.dudx, plane.dvdx, plane.dudy, plane.dvdy);
+    return true;
+}
+
+// 可见性缓冲的纹理着色: 每行中属于同一个面的连续像素一起求纹理坐标, 一次批量采样
+// 面的纹理坐标平面在面变化时重新求出
+template <PixelFormat Format>
+std::int64_t shade_visibility_textured(const VisibilityBuffer &visibility, const Model &model,
+                                       const TriangleSetup *setups,
+                                       const TgaColor *colors,
+                                       const Texture &texture, RasterPath path,
+                                       Framebuffer<Format> &frame_buffer, int x_min, int y_min,
+                                       int x_max, int y_max) {
+    constexpr int bytespp = Framebuffer<Format>::bytespp;
+    float u[tile_size], v[tile_size];
+    PackedPixel texels[tile_size];
+    std::int64_t shaded = 0;
+    int face = -1;
+    bool textured = false;
+    TexturePlane plane;
+    PackedPixel color = 0;
+    for (int y = y_min; y <= y_max; ++y) {
+        const std::uint8_t *ids = visibility.pixel(0, y);
+        std::uint8_t *dst = frame_buffer.pixel(0, y);
+        for (int x = x_min; x <= x_max;) {
+            const PackedPixel id = VisibilityBuffer::load(ids + x * VisibilityBuffer::bytespp);
+            int end = x + 1;
+            while (end <= x_max &&
+                   VisibilityBuffer::load(ids + end * VisibilityBuffer::bytespp) == id)
+                ++end;
+            if (!id) {
+                x = end;
+                continue;
+            }
+            if (static_cast<int>(id - 1) != face) {
+                face = id - 1;
+                textured = texture_plane(model, setups[face], face, texture, plane);
+                if (!textured) color = pack_color(colors[face]);
+            }
+            const int count = end - x;
+            if (textured) {
+                const float dy = y + 0.5f - plane.y0;
+                const float u_row = plane.u0 + plane.dudy * dy;
+                const float v_row = plane.v0 + plane.dvdy * dy;
+                for (int k = 0; k < count; ++k) {
+                    const float dx = x + k + 0.5f - plane.x0;
+                    u[k] = u_row + plane.dudx * dx;
+                    v[k] = v_row + plane.dvdx * dx;
+                }
+                texture.sample(u, v, count, plane.level, texels, path);
+                for (int k = 0; k < count; ++k)
+                    Framebuffer<Format>::store(dst + (x + k) * bytespp, texels[k]);
+            } else {
+                frame_buffer.fill_span(y, x, end, color);
+            }
+            shaded += count;
+            x = end;
+        }
+    }
+    return shaded;
+}
+
+// 多重采样的可见性缓冲着色: 按每个采样点的面的编号取颜色写入多重采样缓冲
+// 返回至少有一个采样点可见的像素个数
+std::int64_t shade_samples(const PackedPixel *sample_ids, const TgaColor *colors,
+                           MsaaBuffer &msaa, int x_min, int y_min, int x_max, int y_max) {
+    const int samples = msaa.get_samples();
+    std::int64_t shaded = 0;
+    for (int y = y_min; y <= y_max; ++y) {
+        const PackedPixel *ids = sample_ids + msaa.sample_index(x_min, y);
+        PackedPixel *dst = msaa.colors(x_min, y);
+        PackedPixel last_id = 0, pixel = 0;
+        for (int x = x_min; x <= x_max; ++x, ids += samples, dst += samples) {
+            bool visible = false;
+            for (int k = 0; k < samples; ++k) {
+                const PackedPixel id = ids[k];
+                if (!id) continue;
+                visible = true;
+                if (id != last_id) {
+                    last_id = id;
+                    pixel = pack_color(colors[id - 1]);
+                }
+                dst[k] = pixel;
+            }
+            shaded += visible;
+        }
+    }
+    return shaded;
+}
+
+// 多重采样的纹理着色, 每个像素中的每个面只在像素中心采样一次
+// 像素的代表面为第一个可见采样点的面, 每行中代表面相同的连续像素一起批量采样;
+// 三角形边缘处属于其他面的采样点逐个像素单独采样
+std::int64_t shade_samples_textured(const PackedPixel *sample_ids, const Model &model,
+                                    const TriangleSetup *setups,
+                                    const TgaColor *colors,
+                                    const Texture &texture, RasterPath path, MsaaBuffer &msaa,
+                                    int x_min, int y_min, int x_max, int y_max) {
+    const int samples = msaa.get_samples();
+    float u[tile_size], v[tile_size];
+    PackedPixel texels[tile_size];
+    PackedPixel representative[tile_size];
+    std::int64_t shaded = 0;
+    // 代表面与边缘处其他面的纹理坐标平面, 面变化时重新求出
+    struct FaceShading {
+        int face = -1;
+        bool textured = false;
+        TexturePlane plane;
+        PackedPixel color = 0;
+
+        void select(int new_face, const Model &model, const TriangleSetup *setups,
+                    const TgaColor *colors, const Texture &texture) {
+            if (new_face == face) return;
+            face = new_face;
+            textured = texture_plane(model, setups[face], face, texture, plane);
+            if (!textured) color = pack_color(colors[face]);
+        }
+    } run, edge;
+    for (int y = y_min; y <= y_max; ++y) {
+        const PackedPixel *ids = sample_ids + msaa.sample_index(x_min, y);
+        PackedPixel *dst = msaa.colors(x_min, y);
+        const int count = x_max - x_min + 1;
+        for (int i = 0; i < count; ++i) {
+            representative[i] = 0;
+            for (int k = 0; k < samples && !representative[i]; ++k)
+                representative[i] = ids[i * samples + k];
+        }
+        for (int i = 0; i < count;) {
+            const PackedPixel id = representative[i];
+            int end = i + 1;
+            while (end < count && representative[end] == id) ++end;
+            if (!id) {
+                i = end;
+                continue;
+            }
+            run.select(id - 1, model, setups, colors, texture);
+            const int run_length = end - i;
+            if (run.textured) {
+                const float dy = y + 0.5f - run.plane.y0;
+                const float u_row = run.plane.u0 + run.plane.dudy * dy;
+                const float v_row = run.plane.v0 + run.plane.dvdy * dy;
+                for (int k = 0; k < run_length; ++k) {
+                    const float dx = x_min + i + k + 0.5f - run.plane.x0;
+                    u[k] = u_row + run.plane.dudx * dx;
+                    v[k] = v_row + run.plane.dvdx * dx;
+                }
+                texture.sample(u, v, run_length, run.plane.level, texels, path);
+            } else {
+                std::fill(texels, texels + run_length, run.color);
+            }
+            for (int k = 0; k < run_length; ++k) {
+                const PackedPixel *pixel_ids = ids + (i + k) * samples;
+                PackedPixel *pixel_colors = dst + (i + k) * samples;
+                PackedPixel edge_id = 0, edge_color = 0;
+                for (int s = 0; s < samples; ++s) {
+                    const PackedPixel sample_id = pixel_ids[s];
+                    if (sample_id == id) {
+                        pixel_colors[s] = texels[k];
+                        continue;
+                    }
+                    if (!sample_id) continue;
+                    if (sample_id != edge_id) {
+                        edge_id = sample_id;
+                        edge.select(sample_id - 1, model, setups, colors, texture);
+                        edge_color = edge.color;
+                        if (edge.textured) {
+                            const float dx = x_min + i + k + 0.5f - edge.plane.x0;
+                            const float dy = y + 0.5f - edge.plane.y0;
+                            edge_color = texture.sample(
+                                edge.plane.u0 + edge.plane.dudy * dy + edge.plane.dudx * dx,
+                                edge.plane.v0 + edge.plane.dvdy * dy + edge.plane.dvdx * dx,
+                                edge.plane.level);
+                        }
+                    }
+                    pixel_colors[s] = edge_color;
+                }
+            }
+            shaded += run_length;
+            i = end;
+        }
+    }
+    return shaded;
+}
+
+} // namespace
+
+bool triangle_bounds(TriangleSetup &setup, const int width, const int height) {
+    // 截断取整的包围盒包含 FixedPointTriangle 的像素范围, 用于分块足够
+    int x_min = std::min(std::min(setup.p0.x, setup.p1.x), setup.p2.x);
+    int x_max = std::max(std::max(setup.p0.x, setup.p1.x), setup.p2.x);
+    int y_min = std::min(std::min(setup.p0.y, setup.p1.y), setup.p2.y);
+    int y_max = std::max(std::max(setup.p0.y, setup.p1.y), setup.p2.y);
+    setup.x_min = std::max(x_min, 0);
+    setup.x_max = std::min(x_max, width - 1);
+    setup.y_min = std::max(y_min, 0);
+    setup.y_max = std::min(y_max, height - 1);
+    // 完全位于屏幕外
+    if (setup.x_min > setup.x_max || setup.y_min > setup.y_max) {
+        setup.x_min = 0, setup.x_max = -1;
+        return false;
+    }
+    return true;
+}
+
+void bin_triangles(const TriangleSetup *setups, const int count, const int width,
+                   const int height, FrameArena &arena, TileBins &out) {
+    const int tiles_x = (width + tile_size - 1) / tile_size;
+    const int tiles_y = (height + tile_size - 1) / tile_size;
+    const int num_tiles = tiles_x * tiles_y;
+    const int num_triangles = count;
+    out.tiles_x = tiles_x;
+    out.tiles_y = tiles_y;
+
+    // 三角形按连续区间划分给各线程, 线程 t 负责 [chunk_begin(t), chunk_begin(t + 1))
+    const int num_chunks = omp_get_max_threads();
+    auto chunk_begin = [&](int t) {
+        return static_cast<int>(static_cast<long long>(num_triangles) * t / num_chunks);
+    };
+    auto for_each_tile = [&](const TriangleSetup &setup, auto visit) {
+        for (int ty = setup.y_min / tile_size; ty <= setup.y_max / tile_size; ++ty) {
+            for (int tx = setup.x_min / tile_size; tx <= setup.x_max / tile_size; ++tx)
+                visit(ty * tiles_x + tx);
+        }
+    };
+
+    // 统计每个区间落入每个 tile 的三角形个数
+    // counts[t][tile], 之后原地改写为写入偏移; 每个区间的计数由处理它的线程在自己的 Arena 中分配
+    int **counts = arena.shared().allocate_array<int *>(num_chunks);
+#pragma omp parallel for schedule(static, 1)
+    for (int t = 0; t < num_chunks; ++t) {
+        int *chunk_counts = arena.thread(omp_get_thread_num()).allocate_array<int>(num_tiles);
+        std::fill(chunk_counts, chunk_counts + num_tiles, 0);
+        counts[t] = chunk_counts;
+        for (int i = chunk_begin(t); i < chunk_begin(t + 1); ++i) {
+            if (setups[i].x_min <= setups[i].x_max)
+                for_each_tile(setups[i], [&](int tile) { ++chunk_counts[tile]; });
+        }
+    }
+
+    // 前缀和, 顺序为 (tile, 区间), 使每个 tile 的三角形列表按三角形的顺序排列
+    ArenaArray<int> &tile_begin = out.tile_begin;
+    tile_begin.allocate(arena.shared(), num_tiles + 1);
+    int total = 0;
+    for (int tile = 0; tile < num_tiles; ++tile) {
+        tile_begin[tile] = total;
+        for (int t = 0; t < num_chunks; ++t) {
+            int &chunk_count = counts[t][tile];
+            int offset = total;
+            total += chunk_count;
+            chunk_count = offset;
+        }
+    }
+    tile_begin[num_tiles] = total;
+
+    // 分块: 各区间把三角形索引写入自己在每个 tile 中的槽位
+    ArenaArray<int> &bins = out.triangles;
+    bins.allocate(arena.shared(), total);
+#pragma omp parallel for schedule(static, 1)
+    for (int t = 0; t < num_chunks; ++t) {
+        int *chunk_offsets = counts[t];
+        for (int i = chunk_begin(t); i < chunk_begin(t + 1); ++i) {
+            if (setups[i].x_min <= setups[i].x_max)
+                for_each_tile(setups[i], [&](int tile) { bins[chunk_offsets[tile]++] = i; });
+        }
+    }
+}
+
+Vec3f viewport_trans(const Vec3f &point, const int width, const int height) {
+    return {(point.x + 1.f) * (width - 1) / 2, (point.y + 1.f) * (height - 1) / 2, (point.z + 1.f) / 2};
+}
+
+template <PixelFormat Format>
+std::int64_t triangle_rasterize(const Vec3f &p0, const Vec3f &p1,
+                                const Vec3f &p2,
+                                Framebuffer<Format> &frame_buffer,
+                                DepthBuffer &depth_buffer,
+                                PackedPixel pixel, int clip_x_min,
+                                int clip_y_min, int clip_x_max, int clip_y_max,
+                                ThreadStats *stats) {
+    float ax = p0[0], ay = p0[1], az = p0[2];
+    float bx = p1[0], by = p1[1], bz = p1[2];
+    float cx = p2[0], cy = p2[1], cz = p2[2];
+
+    // 定点化的三角形, 覆盖判断与边函数路径相同
+    FixedPointTriangle triangle;
+    if (!triangle.setup(p0, p1, p2)) return 0;
+    // 包围盒与裁剪矩形求交
+    const int x_min = std::max(triangle.x_min, clip_x_min);
+    const int x_max = std::min(triangle.x_max, clip_x_max);
+    const int y_min = std::max(triangle.y_min, clip_y_min);
+    const int y_max = std::min(triangle.y_max, clip_y_max);
+
+    std::int64_t covered = 0;
+    // 遍历包围盒内像素
+    for (int x = x_min; x <= x_max; ++x) {
+        for (int y = y_min; y <= y_max; ++y) {
+            if (triangle.covers(x, y)) {
+                // 计算重心坐标
+                auto [alpha, beta, gamma] = barycentric_coordinates(Vec2f{x + 0.5f, y + 0.5f}, Vec2f{ax, ay}, Vec2f{bx, by}, Vec2f{cx, cy});
+                ++covered;
+                RENDERER_STATS_ONLY(if (stats && stats->overdraw) {
+                    std::uint16_t &count =
+                        stats->overdraw[y * stats->overdraw_width + x];
+                    count += count != 0xffff;
+                })
+                // 正交投影 可以使用屏幕空间的重心坐标插值 z
+                float z = alpha * az + beta * bz + gamma * cz;
+                float &depth = depth_buffer.row(y)[x];
+                if (z > depth) {
+                    RENDERER_STATS_ADD(stats, pixels_passed, 1);
+                    depth = z;
+                    depth_buffer.mark_dirty(x, y);
+                    frame_buffer.set(x, y, pixel);
+                }
+            }
+        }
+    }
+    return covered;
+}
+
+template <PixelFormat Format>
+std::int64_t triangle_rasterize(const Vec3f &p0, const Vec3f &p1,
+                                const Vec3f &p2,
+                                Framebuffer<Format> &frame_buffer,
+                                DepthBuffer &depth_buffer,
+                                const TgaColor &color) {
+    // x 坐标为 width 的点位于第 width - 1 列像素的右侧边界上, y 同理
+    return triangle_rasterize(p0, p1, p2, frame_buffer, depth_buffer, pack_color(color), 0, 0,
+                              frame_buffer.get_width() - 1,
+                              frame_buffer.get_height() - 1);
+}
+
+template <PixelFormat Format>
+std::int64_t rasterize_serial(const Model &model,
+                              Framebuffer<Format> &frame_buffer,
+                              DepthBuffer &depth_buffer,
+                              std::uint32_t color_seed) {
+    const int width = frame_buffer.get_width();
+    const int height = frame_buffer.get_height();
+    std::vector<TgaColor> colors(model.num_faces());
+    face_colors(color_seed, 0, model.num_faces(), colors.data());
+
+    std::int64_t covered = 0;
+    for (int i = 0; i < model.num_faces(); ++i) {
+        Vec3f a, b, c;
+        if (triangle_setup(model, i, width, height, a, b, c) !=
+            CullResult::VISIBLE)
+            continue;
+
+        covered += triangle_rasterize(a, b, c, frame_buffer, depth_buffer, colors[i]);
+    }
+    return covered;
+}
+
+template <PixelFormat Format>
+std::int64_t rasterize(const Model &model, Framebuffer<Format> &frame_buffer,
+                       DepthBuffer &depth_buffer, const RasterOptions &options) {
+    const int width = frame_buffer.get_width();
+    const int height = frame_buffer.get_height();
+    const int num_faces = model.num_faces();
+    RasterScratch local_scratch;
+    RasterScratch &scratch = options.scratch ? *options.scratch : local_scratch;
+    FrameArena &arena = scratch.arena;
+    arena.reset();
+    ArenaArray<TgaColor> &colors = scratch.colors;
+    colors.allocate(arena.shared(), num_faces);
+    face_colors(options.color_seed, 0, num_faces, colors.data());
+    const RasterPath path = select_raster_path(options.path);
+
+    // 面按连续区间划分给各线程, 线程 t 负责 [chunk_begin(t), chunk_begin(t + 1))
+    const int num_chunks = omp_get_max_threads();
+    auto chunk_begin = [&](int t) {
+        return static_cast<int>(static_cast<long long>(num_faces) * t /
+                                num_chunks);
+    };
+
+    const Meshlets *meshlets = options.meshlets;
+    FrameStats *stats = options.stats;
+    RENDERER_STATS_ONLY(if (stats) stats->add_triangles(num_faces);)
+
+    // 顶点阶段: 每个顶点只做一次视口变换
+    TransformedVertices &vertices = scratch.vertices;
+    {
+        RENDERER_STAGE_TIMER(stats, Stage::VERTEX);
+        transform_vertices(model, width, height, arena.shared(), vertices, options.transform);
+    }
+
+    // 前端: 并行取出变换后的顶点并剔除
+    ArenaArray<TriangleSetup> &setups = scratch.setups;
+    setups.allocate(arena.shared(), num_faces);
+
+    {
+        RENDERER_STAGE_TIMER(stats, Stage::CULL);
+        // 单个面的剔除与包围盒计算
+        auto setup_face = [&](int i, ThreadStats *thread_stats) {
+            TriangleSetup &setup = setups[i];
+            const CullResult cull = triangle_setup(
+                model, vertices, i, setup.p0, setup.p1, setup.p2);
+            if (cull != CullResult::VISIBLE) {
+                // setups 未初始化, 需要标记为剔除
+                setup.x_min = 0, setup.x_max = -1;
+                if (cull == CullResult::BACKFACE) {
+                    RENDERER_STATS_ADD(thread_stats, backface, 1);
+                } else {
+                    RENDERER_STATS_ADD(thread_stats, degenerate, 1);
+                }
+                return;
+            }
+            if (!triangle_bounds(setup, width, height))
+                RENDERER_STATS_ADD(thread_stats, offscreen, 1);
+        };
+
+        if (!meshlets) {
+#pragma omp parallel for schedule(static, 1)
+            for (int t = 0; t < num_chunks; ++t) {
+                ThreadStats *thread_stats = nullptr;
+                RENDERER_STATS_ONLY(
+                    if (stats) thread_stats = stats->thread(omp_get_thread_num());)
+                for (int i = chunk_begin(t); i < chunk_begin(t + 1); ++i)
+                    setup_face(i, thread_stats);
+            }
+        } else {
+            // 先整簇剔除, 被剔除的簇只把其中的面标记为剔除
+            // 簇之间开销差别大 (被剔除的簇几乎没有开销), 以簇为单位动态分配给线程
+            // setups 按面的索引存放, 与簇的处理顺序无关
+            const MeshletCuller culler(width, height, options.transform);
+            const int num_meshlets = meshlets->meshlets.size();
+#pragma omp parallel for schedule(dynamic, 16)
+            for (int k = 0; k < num_meshlets; ++k) {
+                ThreadStats *thread_stats = nullptr;
+                RENDERER_STATS_ONLY(
+                    if (stats) thread_stats = stats->thread(omp_get_thread_num());)
+                const Meshlet &meshlet = meshlets->meshlets[k];
+                const int *faces = meshlets->faces.data() + meshlet.face_begin;
+                const MeshletCull cull = culler.cull(meshlet);
+                if (cull == MeshletCull::VISIBLE) {
+                    for (int j = 0; j < meshlet.face_count; ++j) setup_face(faces[j], thread_stats);
+                    continue;
+                }
+                for (int j = 0; j < meshlet.face_count; ++j) {
+                    setups[faces[j]].x_min = 0, setups[faces[j]].x_max = -1;
+                }
+                if (cull == MeshletCull::BACKFACE) {
+                    RENDERER_STATS_ADD(thread_stats, cluster_backface, meshlet.face_count);
+                } else {
+                    RENDERER_STATS_ADD(thread_stats, cluster_offscreen, meshlet.face_count);
+                }
+            }
+        }
+    }
+
+    TileBins &tile_bins = scratch.bins;
+    {
+        RENDERER_STAGE_TIMER(stats, Stage::SETUP);
+        bin_triangles(setups.data(), num_faces, width, height, arena, tile_bins);
+    }
+    const int num_tiles = tile_bins.num_tiles();
+    const ArenaArray<int> &tile_begin = tile_bins.tile_begin;
+    const ArenaArray<int> &bins = tile_bins.triangles;
+
+    // 可见性缓冲模式: 光栅化写入面的编号, 之后再着色
+    // 多重采样时编号逐采样点写入 sample_ids, 不使用 visibility
+    const Texture *texture =
+        options.texture && !options.texture->empty() ? options.texture : nullptr;
+    const bool deferred = options.visibility_buffer || texture;
+    MsaaBuffer *msaa = options.msaa;
+    const RasterPath sample_path = path == RasterPath::BARYCENTRIC ? RasterPath::SCALAR : path;
+    VisibilityBuffer *visibility = nullptr;
+    PackedPixel *sample_ids = nullptr;
+    if (deferred && msaa) {
+        scratch.sample_ids.allocate(arena.shared(), msaa->sample_index(0, height));
+        sample_ids = scratch.sample_ids.data();
+    } else if (deferred) {
+        visibility = &scratch.visibility;
+        if (visibility->get_width() != width || visibility->get_height() != height)
+            *visibility = VisibilityBuffer(width, height);
+    }
+    auto tile_rect = [&](int tile, int &x_min, int &y_min, int &x_max, int &y_max) {
+        tile_bins.tile_rect(tile, width, height, x_min, y_min, x_max, y_max);
+    };
+
+    // 后端: 每个 tile 由一个线程光栅化, tile 之间负载不均, 使用动态调度
+    // tile_size 是 Hi-Z 块大小的整数倍, 每个块也只属于一个线程
+    static_assert(tile_size % DepthBuffer::block_size == 0 &&
+                      tile_size % DepthBuffer::coarse_size == 0,
+                  "tiles must own whole depth buffer blocks");
+    std::int64_t tested = 0;
+    {
+        RENDERER_STAGE_TIMER(stats, Stage::RASTER);
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : tested)
+        for (int tile = 0; tile < num_tiles; ++tile) {
+            int clip_x_min, clip_y_min, clip_x_max, clip_y_max;
+            tile_rect(tile, clip_x_min, clip_y_min, clip_x_max, clip_y_max);
+            ThreadStats *thread_stats = nullptr;
+            RENDERER_STATS_ONLY(
+                if (stats) thread_stats = stats->thread(omp_get_thread_num());)
+            RENDERER_STATS_ONLY(
+                const std::int64_t passed = thread_stats ? thread_stats->pixels_passed : 0;)
+
+            // target 为帧缓冲或可见性缓冲, pixel_of(i) 为第 i 个面写入的像素值
+            auto raster_tile = [&](auto &target, auto pixel_of) {
+                std::int64_t tile_tested = 0;
+                for (int k = tile_begin[tile]; k < tile_begin[tile + 1]; ++k) {
+                    const int i = bins[k];
+                    const TriangleSetup &setup = setups[i];
+                    if (msaa) {
+                        tile_tested += triangle_rasterize_msaa(
+                            setup.p0, setup.p1, setup.p2, *msaa, sample_ids, pixel_of(i),
+                            clip_x_min, clip_y_min, clip_x_max, clip_y_max, sample_path,
+                            thread_stats);
+                    } else if (path == RasterPath::BARYCENTRIC) {
+                        tile_tested += triangle_rasterize(
+                            setup.p0, setup.p1, setup.p2, target, depth_buffer,
+                            pixel_of(i), clip_x_min, clip_y_min, clip_x_max,
+                            clip_y_max, thread_stats);
+                    } else {
+                        tile_tested += triangle_rasterize_edge(
+                            setup.p0, setup.p1, setup.p2, target, depth_buffer,
+                            pixel_of(i), clip_x_min, clip_y_min, clip_x_max,
+                            clip_y_max, path, options.hierarchical_z, thread_stats);
+                    }
+                }
+                return tile_tested;
+            };
+            // 没有三角形的 tile 不需要清空可见性缓冲, 也不需要解析
+            if (tile_bins.empty(tile)) continue;
+            auto face_id = [](int i) { return static_cast<PackedPixel>(i) + 1; };
+            std::int64_t tile_tested;
+            if (sample_ids) {
+                const int tile_samples = (clip_x_max - clip_x_min + 1) * msaa->get_samples();
+                for (int y = clip_y_min; y <= clip_y_max; ++y) {
+                    PackedPixel *ids = sample_ids + msaa->sample_index(clip_x_min, y);
+                    std::fill(ids, ids + tile_samples, 0);
+                }
+                // 多重采样时 raster_tile 的 target 不被使用, 编号写入 sample_ids
+                tile_tested = raster_tile(frame_buffer, face_id);
+            } else if (visibility) {
+                for (int y = clip_y_min; y <= clip_y_max; ++y)
+                    visibility->fill_span(y, clip_x_min, clip_x_max + 1, 0);
+                tile_tested = raster_tile(*visibility, face_id);
+            } else {
+                tile_tested = raster_tile(frame_buffer, [&](int i) {
+                    return pack_color(colors[i]);
+                });
+                // 直接写颜色时每个通过深度测试的片元都着色一次
+                RENDERER_STATS_ADD(thread_stats, pixels_shaded,
+                                   thread_stats->pixels_passed - passed);
+                // tile 的采样点仍在缓存中, 立即解析
+                if (msaa)
+                    msaa->resolve(frame_buffer, depth_buffer, clip_x_min, clip_y_min,
+                                  clip_x_max, clip_y_max, sample_path);
+            }
+            RENDERER_STATS_ADD(thread_stats, pixels_tested, tile_tested);
+            tested += tile_tested;
+        }
+    }
+
+    if (deferred) {
+        RENDERER_STAGE_TIMER(stats, Stage::SHADE);
+#pragma omp parallel for schedule(dynamic, 1)
+        for (int tile = 0; tile < num_tiles; ++tile) {
+            if (tile_bins.empty(tile)) continue;
+            int x_min, y_min, x_max, y_max;
+            tile_rect(tile, x_min, y_min, x_max, y_max);
+            ThreadStats *thread_stats = nullptr;
+            RENDERER_STATS_ONLY(
+                if (stats) thread_stats = stats->thread(omp_get_thread_num());)
+            std::int64_t shaded;
+            if (sample_ids) {
+                shaded = texture ? shade_samples_textured(sample_ids, model, setups.data(),
+                                                          colors.data(), *texture, path,
+                                                          *msaa, x_min, y_min, x_max, y_max)
+                                 : shade_samples(sample_ids, colors.data(), *msaa, x_min,
+                                                 y_min, x_max, y_max);
+                msaa->resolve(frame_buffer, depth_buffer, x_min, y_min, x_max, y_max,
+                              sample_path);
+            } else {
+                shaded = texture ? shade_visibility_textured(*visibility, model, setups.data(),
+                                                             colors.data(), *texture, path,
+                                                             frame_buffer, x_min, y_min,
+                                                             x_max, y_max)
+                                 : shade_visibility(*visibility, colors.data(), frame_buffer,
+                                                    x_min, y_min, x_max, y_max);
+            }
+            RENDERER_STATS_ADD(thread_stats, pixels_shaded, shaded);
+        }
+    }
+    return tested;
+}
+
+template <PixelFormat Format>
+std::int64_t rasterize_indexed(const TransformedVertices &vertices, const int *indices,
+                               int count, int first_face, Framebuffer<Format> &frame_buffer,
+                               DepthBuffer &depth_buffer, FrameArena &arena,
+                               const RasterOptions &options) {
+    const int width = frame_buffer.get_width();
+    const int height = frame_buffer.get_height();
+    ArenaArray<TgaColor> colors;
+    colors.allocate(arena.shared(), count);
+    face_colors(options.color_seed, first_face, count, colors.data());
+    const RasterPath path = select_raster_path(options.path);
+    FrameStats *stats = options.stats;
+    RENDERER_STATS_ONLY(if (stats) stats->add_triangles(count);)
+
+    ArenaArray<TriangleSetup> setups;
+    setups.allocate(arena.shared(), count);
+    {
+        RENDERER_STAGE_TIMER(stats, Stage::CULL);
+        const int num_chunks = omp_get_max_threads();
+#pragma omp parallel for schedule(static, 1)
+        for (int t = 0; t < num_chunks; ++t) {
+            ThreadStats *thread_stats = nullptr;
+            RENDERER_STATS_ONLY(if (stats) thread_stats = stats->thread(omp_get_thread_num());)
+            const int begin = static_cast<long long>(count) * t / num_chunks;
+            const int end = static_cast<long long>(count) * (t + 1) / num_chunks;
+            for (int i = begin; i < end; ++i) {
+                TriangleSetup &setup = setups[i];
+                setup.p0 = vertices[indices[i * 3]];
+                setup.p1 = vertices[indices[i * 3 + 1]];
+                setup.p2 = vertices[indices[i * 3 + 2]];
+                const CullResult cull = cull_face(setup.p0, setup.p1, setup.p2);
+                if (cull != CullResult::VISIBLE) {
+                    setup.x_min = 0, setup.x_max = -1;
+                    if (cull == CullResult::BACKFACE) {
+                        RENDERER_STATS_ADD(thread_stats, backface, 1);
+                    } else {
+                        RENDERER_STATS_ADD(thread_stats, degenerate, 1);
+                    }
+                } else if (!triangle_bounds(setup, width, height)) {
+                    RENDERER_STATS_ADD(thread_stats, offscreen, 1);
+                }
+            }
+        }
+    }
+
+    TileBins tile_bins;
+    {
+        RENDERER_STAGE_TIMER(stats, Stage::SETUP);
+        bin_triangles(setups.data(), count, width, height, arena, tile_bins);
+    }
+
+    std::int64_t tested = 0;
+    {
+        RENDERER_STAGE_TIMER(stats, Stage::RASTER);
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : tested)
+        for (int tile = 0; tile < tile_bins.num_tiles(); ++tile) {
+            if (tile_bins.empty(tile)) continue;
+            int clip_x_min, clip_y_min, clip_x_max, clip_y_max;
+            tile_bins.tile_rect(tile, width, height, clip_x_min, clip_y_min, clip_x_max,
+                                clip_y_max);
+            ThreadStats *thread_stats = nullptr;
+            RENDERER_STATS_ONLY(if (stats) thread_stats = stats->thread(omp_get_thread_num());)
+            RENDERER_STATS_ONLY(
+                const std::int64_t passed = thread_stats ? thread_stats->pixels_passed : 0;)
+            std::int64_t tile_tested = 0;
+            for (int k = tile_bins.tile_begin[tile]; k < tile_bins.tile_begin[tile + 1]; ++k) {
+                const int i = tile_bins.triangles[k];
+                const TriangleSetup &setup = setups[i];
+                if (path == RasterPath::BARYCENTRIC) {
+                    tile_tested += triangle_rasterize(
+                        setup.p0, setup.p1, setup.p2, frame_buffer, depth_buffer,
+                        pack_color(colors[i]), clip_x_min, clip_y_min, clip_x_max, clip_y_max,
+                        thread_stats);
+                } else {
+                    tile_tested += triangle_rasterize_edge(
+                        setup.p0, setup.p1, setup.p2, frame_buffer, depth_buffer,
+                        pack_color(colors[i]), clip_x_min, clip_y_min, clip_x_max, clip_y_max,
+                        path, options.hierarchical_z, thread_stats);
+                }
+            }
+            RENDERER_STATS_ADD(thread_stats, pixels_shaded, thread_stats->pixels_passed - passed);
+            RENDERER_STATS_ADD(thread_stats, pixels_tested, tile_tested);
+            tested += tile_tested;
+        }
+    }
+    return tested;
+}
+
+#define INSTANTIATE_RASTERIZER(Format)                                         \
+    template std::int64_t triangle_rasterize<Format>(                          \
+        const Vec3f &, const Vec3f &, const Vec3f &, Framebuffer<Format> &,    \
+        DepthBuffer &, PackedPixel, int, int, int, int, ThreadStats *);        \
+    template std::int64_t triangle_rasterize<Format>(                          \
+        const Vec3f &, const Vec3f &, const Vec3f &, Framebuffer<Format> &,    \
+        DepthBuffer &, const TgaColor &);                                      \
+    template std::int64_t rasterize<Format>(const Model &,                     \
+                                            Framebuffer<Format> &,             \
+                                            DepthBuffer &,                     \
+                                            const RasterOptions &);            \
+    template std::int64_t rasterize_serial<Format>(                            \
+        const Model &, Framebuffer<Format> &, DepthBuffer &, std::uint32_t);   \
+    template std::int64_t rasterize_indexed<Format>(                           \
+        const TransformedVertices &, const int *, int, int,                    \
+        Framebuffer<Format> &, DepthBuffer &, FrameArena &,                    \
+        const RasterOptions &);
+INSTANTIATE_RASTERIZER(PixelFormat::GRAYSCALE)
+INSTANTIATE_RASTERIZER(PixelFormat::RGB)
+INSTANTIATE_RASTERIZER(PixelFormat::RGBA)
+#undef INSTANTIATE_RASTERIZER
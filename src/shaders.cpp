@@ -0,0 +1,74 @@
+#include "shaders.h"
+
+void FlatShader::shade_faces(const Model &model, const ShaderUniforms &uniforms,
+                             std::vector<PackedPixel> &out) {
+    out.resize(model.num_faces());
+#pragma omp parallel for schedule(static) if (out.size() > 65536)
+    for (int face = 0; face < static_cast<int>(out.size()); ++face) {
+        const Vec3f &a = model.vertex(face, 0), &b = model.vertex(face, 1),
+                    &c = model.vertex(face, 2);
+        const Vec4f center = uniforms.model.apply_point(
+            Vec3f{(a.x + b.x + c.x) / 3, (a.y + b.y + c.y) / 3, (a.z + b.z + c.z) / 3});
+        const Vec3f normal =
+            uniforms.model.apply_direction(face_normal(model, face)).normalized();
+        float diffuse, specular;
+        blinn_phong(uniforms, normal, Vec3f{center[0], center[1], center[2]}, diffuse,
+                    specular);
+        out[face] = shade_color(uniforms.albedo, diffuse, specular);
+    }
+}
+
+const char *shader_name(ShaderKind shader) {
+    switch (shader) {
+    case ShaderKind::FLAT: return "flat";
+    case ShaderKind::GOURAUD: return "gouraud";
+    case ShaderKind::PHONG: return "phong";
+    }
+    return "unknown";
+}
+
+bool parse_shader(const std::string &name, ShaderKind &shader) {
+    for (ShaderKind candidate : {ShaderKind::FLAT, ShaderKind::GOURAUD, ShaderKind::PHONG}) {
+        if (name == shader_name(candidate)) {
+            shader = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <PixelFormat Format>
+std::int64_t render_shaded(const Model &model, ShaderKind shader,
+                           const ShaderUniforms &uniforms, Framebuffer<Format> &frame_buffer,
+                           DepthBuffer &depth_buffer, ShadedScratch *scratch,
+                           FrameStats *stats, bool hierarchical_z) {
+    ShadedScratch local_scratch;
+    ShadedScratch &s = scratch ? *scratch : local_scratch;
+    switch (shader) {
+    case ShaderKind::FLAT: {
+        {
+            RENDERER_STAGE_TIMER(stats, Stage::VERTEX);
+            FlatShader::shade_faces(model, uniforms, s.face_pixels);
+        }
+        return render_pipeline(model, FlatShader(model, uniforms, s.face_pixels),
+                               frame_buffer, depth_buffer, &s.flat, stats, hierarchical_z);
+    }
+    case ShaderKind::GOURAUD:
+        return render_pipeline(model, GouraudShader(model, uniforms), frame_buffer,
+                               depth_buffer, &s.gouraud, stats, hierarchical_z);
+    case ShaderKind::PHONG:
+        return render_pipeline(model, PhongShader(model, uniforms), frame_buffer,
+                               depth_buffer, &s.phong, stats, hierarchical_z);
+    }
+    return 0;
+}
+
+#define INSTANTIATE_RENDER_SHADED(Format)                                      \
+    template std::int64_t render_shaded<Format>(                               \
+        const Model &, ShaderKind, const ShaderUniforms &,                     \
+        Framebuffer<Format> &, DepthBuffer &, ShadedScratch *,                 \
+        FrameStats *, bool);
+INSTANTIATE_RENDER_SHADED(PixelFormat::GRAYSCALE)
+INSTANTIATE_RENDER_SHADED(PixelFormat::RGB)
+INSTANTIATE_RENDER_SHADED(PixelFormat::RGBA)
+#undef INSTANTIATE_RENDER_SHADED
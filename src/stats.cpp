@@ -0,0 +1,122 @@
+#include "stats.h"
+#include <algorithm>
+#include <omp.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+const char *stage_name(Stage stage) {
+    switch (stage) {
+    case Stage::LOAD: return "load";
+    case Stage::VERTEX: return "vertex";
+    case Stage::CULL: return "cull";
+    case Stage::SETUP: return "setup";
+    case Stage::RASTER: return "raster";
+    case Stage::SHADE: return "shade";
+    case Stage::DEPTH: return "depth";
+    case Stage::WRITE: return "write";
+    default: return "unknown";
+    }
+}
+
+const char *triangle_class_name(TriangleClass triangle_class) {
+    switch (triangle_class) {
+    case TriangleClass::EMPTY: return "empty";
+    case TriangleClass::TINY: return "tiny";
+    case TriangleClass::MEDIUM: return "medium";
+    case TriangleClass::LARGE: return "large";
+    default: return "unknown";
+    }
+}
+
+void FrameStats::begin_frame(const int width, const int height) {
+    width_ = width, height_ = height;
+    std::fill(std::begin(stage_ms_), std::end(stage_ms_), 0.0);
+    triangles_ = 0;
+    overdraw_.assign(static_cast<std::size_t>(width) * height, 0);
+    threads_.assign(omp_get_max_threads(), ThreadStats{});
+    for (auto &thread : threads_) {
+        thread.overdraw = overdraw_.data();
+        thread.overdraw_width = width;
+    }
+}
+
+ThreadStats FrameStats::total() const {
+    ThreadStats result;
+    for (const auto &thread : threads_) {
+        result.backface += thread.backface;
+        result.degenerate += thread.degenerate;
+        result.offscreen += thread.offscreen;
+        result.cluster_backface += thread.cluster_backface;
+        result.cluster_offscreen += thread.cluster_offscreen;
+        result.pixels_tested += thread.pixels_tested;
+        result.pixels_passed += thread.pixels_passed;
+        result.pixels_shaded += thread.pixels_shaded;
+        for (int i = 0; i < triangle_classes; ++i) {
+            result.class_triangles[i] += thread.class_triangles[i];
+            result.class_pixels[i] += thread.class_pixels[i];
+        }
+    }
+    return result;
+}
+
+void FrameStats::write_json(std::ostream &out) const {
+    const ThreadStats sum = total();
+    std::int64_t histogram[overdraw_buckets] = {};
+    for (std::uint16_t count : overdraw_) {
+        ++histogram[std::min<int>(count, overdraw_buckets - 1)];
+    }
+
+    out << "{\n";
+    out << "  \"width\": " << width_ << ",\n";
+    out << "  \"height\": " << height_ << ",\n";
+    out << "  \"threads\": " << threads_.size() << ",\n";
+    out << "  \"stages_ms\": {";
+    for (int i = 0; i < static_cast<int>(Stage::COUNT); ++i) {
+        out << (i ? ", " : "") << '"' << stage_name(static_cast<Stage>(i))
+            << "\": " << stage_ms_[i];
+    }
+    out << "},\n";
+    out << "  \"triangles\": {\"submitted\": " << triangles_
+        << ", \"backface\": " << sum.backface
+        << ", \"degenerate\": " << sum.degenerate
+        << ", \"offscreen\": " << sum.offscreen
+        << ", \"cluster_backface\": " << sum.cluster_backface
+        << ", \"cluster_offscreen\": " << sum.cluster_offscreen << ", \"rasterized\": "
+        << triangles_ - sum.backface - sum.degenerate - sum.offscreen -
+               sum.cluster_backface - sum.cluster_offscreen
+        << "},\n";
+    out << "  \"pixels\": {\"tested\": " << sum.pixels_tested
+        << ", \"passed\": " << sum.pixels_passed << ", \"shaded\": " << sum.pixels_shaded
+        << "},\n";
+    // 边函数路径按大小分类的三角形个数与做了深度测试的片元个数
+    out << "  \"size_classes\": {";
+    for (int i = 0; i < triangle_classes; ++i) {
+        out << (i ? ", " : "") << '"' << triangle_class_name(static_cast<TriangleClass>(i))
+            << "\": {\"triangles\": " << sum.class_triangles[i]
+            << ", \"pixels\": " << sum.class_pixels[i] << '}';
+    }
+    out << "},\n";
+    // 第 i 项为恰好被 i 个片元覆盖的像素个数, 最后一项为不少于该数的
+    out << "  \"overdraw_histogram\": [";
+    for (int i = 0; i < overdraw_buckets; ++i) {
+        out << (i ? ", " : "") << histogram[i];
+    }
+    out << "]\n";
+    out << "}\n";
+}
+
+std::int64_t peak_resident_bytes() {
+#ifdef _WIN32
+    return 0;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage)) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss; // macOS 以字节为单位
+#else
+    return static_cast<std::int64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
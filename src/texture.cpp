@@ -0,0 +1,357 @@
+#include "texture.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define RENDERER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 纹理宽高的上限, 纹素下标用 32 位整数表示
+constexpr int max_texture_size = 1 << 14;
+// 采样时纹素坐标的截断范围, 转换为整数不会溢出, 截断后按位与仍落在纹理内
+constexpr float coordinate_limit = 1 << 22;
+
+bool is_power_of_two(int n) { return n > 0 && !(n & (n - 1)); }
+
+int log2_int(int n) {
+    int k = 0;
+    while ((1 << k) < n) ++k;
+    return k;
+}
+
+// 块内的 Morton 顺序: 下标的第 0 / 2 位来自 x, 第 1 / 3 位来自 y
+inline int tiled_index(int x, int y, int tile_shift) {
+    return (((y >> 2) << tile_shift) + (x >> 2)) << 4 | (x & 1) | (y & 1) << 1 |
+           (x & 2) << 1 | (y & 2) << 2;
+}
+
+// 2x2 的盒式滤波生成下一级, 宽或高为 1 时只在另一个方向上平均, 各通道四舍五入
+void downsample(const std::vector<PackedPixel> &src, int width, int height,
+                std::vector<PackedPixel> &dst) {
+    const int w = std::max(width / 2, 1), h = std::max(height / 2, 1);
+    const int dx = width > 1, dy = height > 1;
+    dst.resize(static_cast<std::size_t>(w) * h);
+    for (int y = 0; y < h; ++y) {
+        const PackedPixel *row0 = src.data() + static_cast<std::size_t>(2 * y) * width;
+        const PackedPixel *row1 = row0 + static_cast<std::size_t>(dy) * width;
+        for (int x = 0; x < w; ++x) {
+            const PackedPixel a = row0[2 * x], b = row0[2 * x + dx];
+            const PackedPixel c = row1[2 * x], d = row1[2 * x + dx];
+            PackedPixel result = 0;
+            for (int shift = 0; shift < 32; shift += 8) {
+                const PackedPixel sum = (a >> shift & 0xff) + (b >> shift & 0xff) +
+                                        (c >> shift & 0xff) + (d >> shift & 0xff);
+                result |= (sum + 2) >> 2 << shift;
+            }
+            dst[static_cast<std::size_t>(y) * w + x] = result;
+        }
+    }
+}
+
+// 各路径共用的计算顺序:
+// x = clamp(u * width - 0.5), x0 = floor(x), fx = x - x0, 纹素列为 x0 与 x0 + 1 对宽度取模, y 同理
+// 每个通道 top = c00 + (c10 - c00) * fx, bottom = c01 + (c11 - c01) * fx,
+// c = top + (bottom - top) * fy, 结果为 (int)(c + 0.5)
+inline PackedPixel bilinear(PackedPixel t00, PackedPixel t10, PackedPixel t01,
+                            PackedPixel t11, float fx, float fy) {
+    PackedPixel result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        const float c00 = static_cast<float>(t00 >> shift & 0xff);
+        const float c10 = static_cast<float>(t10 >> shift & 0xff);
+        const float c01 = static_cast<float>(t01 >> shift & 0xff);
+        const float c11 = static_cast<float>(t11 >> shift & 0xff);
+        const float top = c00 + (c10 - c00) * fx;
+        const float bottom = c01 + (c11 - c01) * fx;
+        const float c = top + (bottom - top) * fy;
+        result |= static_cast<PackedPixel>(static_cast<int>(c + 0.5f)) << shift;
+    }
+    return result;
+}
+
+PackedPixel sample_scalar(const Texture::Level &level, const PackedPixel *texels, float u,
+                          float v) {
+    float x = u * static_cast<float>(level.width) - 0.5f;
+    float y = v * static_cast<float>(level.height) - 0.5f;
+    // 参数顺序与 _mm_max_ps / _mm_min_ps 的语义一致, NaN 截断到下界
+    x = std::min(coordinate_limit, std::max(-coordinate_limit, x));
+    y = std::min(coordinate_limit, std::max(-coordinate_limit, y));
+    const float x_floor = std::floor(x), y_floor = std::floor(y);
+    const float fx = x - x_floor, fy = y - y_floor;
+    const int xi = static_cast<int>(x_floor), yi = static_cast<int>(y_floor);
+    const int x0 = xi & (level.width - 1), x1 = (xi + 1) & (level.width - 1);
+    const int y0 = yi & (level.height - 1), y1 = (yi + 1) & (level.height - 1);
+    return bilinear(texels[tiled_index(x0, y0, level.tile_shift)],
+                    texels[tiled_index(x1, y0, level.tile_shift)],
+                    texels[tiled_index(x0, y1, level.tile_shift)],
+                    texels[tiled_index(x1, y1, level.tile_shift)], fx, fy);
+}
+
+#ifdef RENDERER_X86
+
+// 纹素坐标 -> 块内 Morton 下标, 4 个通道
+inline __m128i tiled_index_sse(__m128i x, __m128i y, __m128i tile_shift) {
+    const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+    const __m128i tile = _mm_add_epi32(_mm_sll_epi32(_mm_srli_epi32(y, 2), tile_shift),
+                                       _mm_srli_epi32(x, 2));
+    __m128i index = _mm_slli_epi32(tile, 4);
+    index = _mm_or_si128(index, _mm_and_si128(x, one));
+    index = _mm_or_si128(index, _mm_slli_epi32(_mm_and_si128(y, one), 1));
+    index = _mm_or_si128(index, _mm_slli_epi32(_mm_and_si128(x, two), 1));
+    return _mm_or_si128(index, _mm_slli_epi32(_mm_and_si128(y, two), 2));
+}
+
+// 一个通道的双线性插值, 结果移回通道所在的位置
+template <int Shift>
+inline __m128i bilinear_channel_sse(__m128i t00, __m128i t10, __m128i t01, __m128i t11,
+                                    __m128 fx, __m128 fy) {
+    const __m128i mask = _mm_set1_epi32(0xff);
+    const __m128 c00 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(t00, Shift), mask));
+    const __m128 c10 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(t10, Shift), mask));
+    const __m128 c01 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(t01, Shift), mask));
+    const __m128 c11 = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(t11, Shift), mask));
+    const __m128 top = _mm_add_ps(c00, _mm_mul_ps(_mm_sub_ps(c10, c00), fx));
+    const __m128 bottom = _mm_add_ps(c01, _mm_mul_ps(_mm_sub_ps(c11, c01), fx));
+    const __m128 c = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), fy));
+    return _mm_slli_epi32(_mm_cvttps_epi32(_mm_add_ps(c, _mm_set1_ps(0.5f))), Shift);
+}
+
+// 每次 4 个坐标, SSE2 没有 gather, 纹素下标算好后逐个取
+// 返回处理的坐标个数 (count 向下取整到 4 的倍数)
+int sample_sse(const Texture::Level &level, const PackedPixel *texels, const float *u,
+               const float *v, int count, PackedPixel *out) {
+    const __m128 width = _mm_set1_ps(static_cast<float>(level.width));
+    const __m128 height = _mm_set1_ps(static_cast<float>(level.height));
+    const __m128 half = _mm_set1_ps(0.5f), one_f = _mm_set1_ps(1.f);
+    const __m128 lower = _mm_set1_ps(-coordinate_limit), upper = _mm_set1_ps(coordinate_limit);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i x_mask = _mm_set1_epi32(level.width - 1);
+    const __m128i y_mask = _mm_set1_epi32(level.height - 1);
+    const __m128i tile_shift = _mm_cvtsi32_si128(level.tile_shift);
+    alignas(16) std::int32_t index[4][4];
+    alignas(16) PackedPixel t[4][4];
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(u + i), width), half);
+        __m128 y = _mm_sub_ps(_mm_mul_ps(_mm_loadu_ps(v + i), height), half);
+        x = _mm_min_ps(_mm_max_ps(x, lower), upper);
+        y = _mm_min_ps(_mm_max_ps(y, lower), upper);
+        // floor: 截断后比原值大的减 1
+        __m128i xi = _mm_cvttps_epi32(x), yi = _mm_cvttps_epi32(y);
+        __m128 x_floor = _mm_cvtepi32_ps(xi), y_floor = _mm_cvtepi32_ps(yi);
+        const __m128 x_over = _mm_cmpgt_ps(x_floor, x), y_over = _mm_cmpgt_ps(y_floor, y);
+        xi = _mm_add_epi32(xi, _mm_castps_si128(x_over));
+        yi = _mm_add_epi32(yi, _mm_castps_si128(y_over));
+        x_floor = _mm_sub_ps(x_floor, _mm_and_ps(x_over, one_f));
+        y_floor = _mm_sub_ps(y_floor, _mm_and_ps(y_over, one_f));
+        const __m128 fx = _mm_sub_ps(x, x_floor), fy = _mm_sub_ps(y, y_floor);
+        const __m128i x0 = _mm_and_si128(xi, x_mask);
+        const __m128i x1 = _mm_and_si128(_mm_add_epi32(xi, one), x_mask);
+        const __m128i y0 = _mm_and_si128(yi, y_mask);
+        const __m128i y1 = _mm_and_si128(_mm_add_epi32(yi, one), y_mask);
+        _mm_store_si128(reinterpret_cast<__m128i *>(index[0]), tiled_index_sse(x0, y0, tile_shift));
+        _mm_store_si128(reinterpret_cast<__m128i *>(index[1]), tiled_index_sse(x1, y0, tile_shift));
+        _mm_store_si128(reinterpret_cast<__m128i *>(index[2]), tiled_index_sse(x0, y1, tile_shift));
+        _mm_store_si128(reinterpret_cast<__m128i *>(index[3]), tiled_index_sse(x1, y1, tile_shift));
+        for (int k = 0; k < 4; ++k) {
+            for (int lane = 0; lane < 4; ++lane) t[k][lane] = texels[index[k][lane]];
+        }
+        const __m128i t00 = _mm_load_si128(reinterpret_cast<const __m128i *>(t[0]));
+        const __m128i t10 = _mm_load_si128(reinterpret_cast<const __m128i *>(t[1]));
+        const __m128i t01 = _mm_load_si128(reinterpret_cast<const __m128i *>(t[2]));
+        const __m128i t11 = _mm_load_si128(reinterpret_cast<const __m128i *>(t[3]));
+        __m128i result = bilinear_channel_sse<0>(t00, t10, t01, t11, fx, fy);
+        result = _mm_or_si128(result, bilinear_channel_sse<8>(t00, t10, t01, t11, fx, fy));
+        result = _mm_or_si128(result, bilinear_channel_sse<16>(t00, t10, t01, t11, fx, fy));
+        result = _mm_or_si128(result, bilinear_channel_sse<24>(t00, t10, t01, t11, fx, fy));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), result);
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) inline __m256i
+tiled_index_avx2(__m256i x, __m256i y, __m128i tile_shift) {
+    const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+    const __m256i tile = _mm256_add_epi32(
+        _mm256_sll_epi32(_mm256_srli_epi32(y, 2), tile_shift), _mm256_srli_epi32(x, 2));
+    __m256i index = _mm256_slli_epi32(tile, 4);
+    index = _mm256_or_si256(index, _mm256_and_si256(x, one));
+    index = _mm256_or_si256(index, _mm256_slli_epi32(_mm256_and_si256(y, one), 1));
+    index = _mm256_or_si256(index, _mm256_slli_epi32(_mm256_and_si256(x, two), 1));
+    return _mm256_or_si256(index, _mm256_slli_epi32(_mm256_and_si256(y, two), 2));
+}
+
+template <int Shift>
+__attribute__((target("avx2"))) inline __m256i
+bilinear_channel_avx2(__m256i t00, __m256i t10, __m256i t01, __m256i t11, __m256 fx,
+                      __m256 fy) {
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m256 c00 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(t00, Shift), mask));
+    const __m256 c10 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(t10, Shift), mask));
+    const __m256 c01 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(t01, Shift), mask));
+    const __m256 c11 = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(t11, Shift), mask));
+    const __m256 top = _mm256_add_ps(c00, _mm256_mul_ps(_mm256_sub_ps(c10, c00), fx));
+    const __m256 bottom = _mm256_add_ps(c01, _mm256_mul_ps(_mm256_sub_ps(c11, c01), fx));
+    const __m256 c = _mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), fy));
+    return _mm256_slli_epi32(_mm256_cvttps_epi32(_mm256_add_ps(c, _mm256_set1_ps(0.5f))),
+                             Shift);
+}
+
+// 每次 8 个坐标, 四个角的纹素各用一次 gather 取出
+__attribute__((target("avx2"))) int sample_avx2(const Texture::Level &level,
+                                                const PackedPixel *texels, const float *u,
+                                                const float *v, int count, PackedPixel *out) {
+    const __m256 width = _mm256_set1_ps(static_cast<float>(level.width));
+    const __m256 height = _mm256_set1_ps(static_cast<float>(level.height));
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 lower = _mm256_set1_ps(-coordinate_limit);
+    const __m256 upper = _mm256_set1_ps(coordinate_limit);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i x_mask = _mm256_set1_epi32(level.width - 1);
+    const __m256i y_mask = _mm256_set1_epi32(level.height - 1);
+    const __m128i tile_shift = _mm_cvtsi32_si128(level.tile_shift);
+    const int *base = reinterpret_cast<const int *>(texels);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(u + i), width), half);
+        __m256 y = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(v + i), height), half);
+        x = _mm256_min_ps(_mm256_max_ps(x, lower), upper);
+        y = _mm256_min_ps(_mm256_max_ps(y, lower), upper);
+        const __m256 x_floor = _mm256_floor_ps(x), y_floor = _mm256_floor_ps(y);
+        const __m256 fx = _mm256_sub_ps(x, x_floor), fy = _mm256_sub_ps(y, y_floor);
+        const __m256i xi = _mm256_cvttps_epi32(x_floor), yi = _mm256_cvttps_epi32(y_floor);
+        const __m256i x0 = _mm256_and_si256(xi, x_mask);
+        const __m256i x1 = _mm256_and_si256(_mm256_add_epi32(xi, one), x_mask);
+        const __m256i y0 = _mm256_and_si256(yi, y_mask);
+        const __m256i y1 = _mm256_and_si256(_mm256_add_epi32(yi, one), y_mask);
+        const __m256i t00 = _mm256_i32gather_epi32(base, tiled_index_avx2(x0, y0, tile_shift), 4);
+        const __m256i t10 = _mm256_i32gather_epi32(base, tiled_index_avx2(x1, y0, tile_shift), 4);
+        const __m256i t01 = _mm256_i32gather_epi32(base, tiled_index_avx2(x0, y1, tile_shift), 4);
+        const __m256i t11 = _mm256_i32gather_epi32(base, tiled_index_avx2(x1, y1, tile_shift), 4);
+        __m256i result = bilinear_channel_avx2<0>(t00, t10, t01, t11, fx, fy);
+        result = _mm256_or_si256(result, bilinear_channel_avx2<8>(t00, t10, t01, t11, fx, fy));
+        result = _mm256_or_si256(result, bilinear_channel_avx2<16>(t00, t10, t01, t11, fx, fy));
+        result = _mm256_or_si256(result, bilinear_channel_avx2<24>(t00, t10, t01, t11, fx, fy));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), result);
+    }
+    return i;
+}
+
+#endif
+
+} // namespace
+
+bool Texture::build(const TgaImage &image) {
+    levels_.clear();
+    storage_.clear();
+    base_ = 0;
+    const int width = image.get_width(), height = image.get_height();
+    const int bytespp = image.get_bytespp();
+    if (!image.data() || (bytespp != 1 && bytespp != 3 && bytespp != 4)) {
+        std::cerr << "Unsupported texture format.\n";
+        return false;
+    }
+    if (!is_power_of_two(width) || !is_power_of_two(height) || width > max_texture_size ||
+        height > max_texture_size) {
+        std::cerr << "Texture size " << width << "x" << height
+                  << " is not supported, width and height must be powers of two up to "
+                  << max_texture_size << ".\n";
+        return false;
+    }
+
+    // 各级的大小与位置, 每级至少一个块
+    std::size_t total = 0;
+    for (int w = width, h = height;; w = std::max(w / 2, 1), h = std::max(h / 2, 1)) {
+        Level level;
+        level.width = w;
+        level.height = h;
+        level.tile_shift = log2_int(std::max(w / tile_size, 1));
+        level.offset = total;
+        total += static_cast<std::size_t>(std::max(w / tile_size, 1)) *
+                 std::max(h / tile_size, 1) * tile_size * tile_size;
+        levels_.push_back(level);
+        if (w == 1 && h == 1) break;
+    }
+    storage_.assign(total + 15, 0);
+    base_ = (64 - reinterpret_cast<std::uintptr_t>(storage_.data()) % 64) % 64 /
+            sizeof(PackedPixel);
+
+    // 第 0 级先按行优先展开为 32 位, 第 0 行为图像的最下方一行
+    std::vector<PackedPixel> linear(static_cast<std::size_t>(width) * height), next;
+    for (int y = 0; y < height; ++y) {
+        const std::uint8_t *src = image.row(image.is_bottom_up() ? y : height - 1 - y);
+        PackedPixel *dst = linear.data() + static_cast<std::size_t>(y) * width;
+        for (int x = 0; x < width; ++x, src += bytespp) {
+            if (bytespp == 1) {
+                dst[x] = pack_pixel(src[0], src[0], src[0]);
+            } else {
+                dst[x] = pack_pixel(src[0], src[1], src[2], bytespp == 4 ? src[3] : 255);
+            }
+        }
+    }
+    for (std::size_t i = 0; i < levels_.size(); ++i) {
+        const Level &level = levels_[i];
+        PackedPixel *dst = storage_.data() + base_ + level.offset;
+        for (int y = 0; y < level.height; ++y) {
+            for (int x = 0; x < level.width; ++x)
+                dst[tiled_index(x, y, level.tile_shift)] =
+                    linear[static_cast<std::size_t>(y) * level.width + x];
+        }
+        if (i + 1 < levels_.size()) {
+            downsample(linear, level.width, level.height, next);
+            linear.swap(next);
+        }
+    }
+    return true;
+}
+
+bool Texture::load(const std::string &filename) {
+    TgaImage image;
+    if (!image.read_tga_file(filename)) return false;
+    return build(image);
+}
+
+PackedPixel Texture::texel(int level, int x, int y) const {
+    const Level &l = levels_[level];
+    return texels(l)[tiled_index(x, y, l.tile_shift)];
+}
+
+int Texture::select_level(float dudx, float dvdx, float dudy, float dvdy) const {
+    const float width = static_cast<float>(get_width());
+    const float height = static_cast<float>(get_height());
+    // 屏幕上一个像素在两个方向上覆盖的纹素个数
+    const float sx = dudx * width, tx = dvdx * height;
+    const float sy = dudy * width, ty = dvdy * height;
+    const float rho_x = std::sqrt(sx * sx + tx * tx);
+    const float rho_y = std::sqrt(sy * sy + ty * ty);
+    const float rho = std::max(rho_x, rho_y);
+    if (!(rho > 1.f)) return 0;
+    const int level = static_cast<int>(std::floor(std::log2(std::min(rho, 1e9f)) + 0.5f));
+    return std::min(level, num_levels() - 1);
+}
+
+PackedPixel Texture::sample(float u, float v, int level) const {
+    const Level &l = levels_[level];
+    return sample_scalar(l, texels(l), u, v);
+}
+
+void Texture::sample(const float *u, const float *v, int count, int level, PackedPixel *out,
+                     RasterPath path) const {
+    const Level &l = levels_[level];
+    const PackedPixel *t = texels(l);
+    int i = 0;
+#ifdef RENDERER_X86
+    if (path == RasterPath::AVX2) {
+        i = sample_avx2(l, t, u, v, count, out);
+    } else if (path == RasterPath::SSE) {
+        i = sample_sse(l, t, u, v, count, out);
+    }
+#else
+    (void)path;
+#endif
+    for (; i < count; ++i) out[i] = sample_scalar(l, t, u[i], v[i]);
+}
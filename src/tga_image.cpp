@@ -1,4 +1,7 @@
 #include "tga_image.h"
+#include "image_transform.h"
+#include "mapped_file.h"
+#include "tga_rle.h"
 #include <cstdint>
 #include <cstring>
 #include <iostream>
@@ -6,15 +9,19 @@
 
 TgaImage::TgaImage(const int width, const int height, const int bytespp)
     : width_(width), height_(height), bytespp_(bytespp),
-      data_(width * height * bytespp, 0) {}
+      data_(static_cast<std::size_t>(width) * height * bytespp, 0) {}
+
+TgaImage::TgaImage(std::uint8_t *data, const int width, const int height,
+                   const int bytespp)
+    : width_(width), height_(height), bytespp_(bytespp), view_(data) {}
 
 TgaColor TgaImage::get_pixel(int x, int y) const {
-    if (!data_.size() || x < 0 || y < 0 || x >= width_ || y >= height_)
+    if (!data() || x < 0 || y < 0 || x >= width_ || y >= height_)
         return {};
 
     TgaColor ret_color = {0, 0, 0, 0, bytespp_};
 
-    const std::uint8_t *pdata = data_.data() + (y * width_ + x) * bytespp_;
+    const std::uint8_t *pdata = data() + (y * width_ + x) * bytespp_;
     for (int i = 0; i < bytespp_; ++i)
         ret_color[i] = pdata[i];
 
@@ -22,27 +29,29 @@ TgaColor TgaImage::get_pixel(int x, int y) const {
 }
 
 bool TgaImage::set_pixel(int x, int y, const TgaColor &tga_color) {
-    if (!data_.size() || x < 0 || y < 0 || x >= width_ || y >= height_)
+    if (!data() || x < 0 || y < 0 || x >= width_ || y >= height_)
         return false;
 
-    std::memcpy(data_.data() + (y * width_ + x) * bytespp_, tga_color.bgra,
+    std::memcpy(data() + (y * width_ + x) * bytespp_, tga_color.bgra,
                 bytespp_);
     return true;
 }
 
 bool TgaImage::read_tga_file(const std::string &filename) {
-    std::ifstream in(filename, std::ios::binary);
-    if (!in.is_open()) {
+    MappedFile file;
+    if (!file.open(filename)) {
         std::cerr << "Failed to open " << filename << ".\n";
         return false;
     }
+    const std::uint8_t *begin = reinterpret_cast<const std::uint8_t *>(file.data());
+    const std::uint8_t *end = begin + file.size();
 
     TgaHeader header;
-    in.read(reinterpret_cast<char *>(&header), sizeof(header));
-    if (!in.good()) {
+    if (file.size() < sizeof(header)) {
         std::cerr << "An error occured while reading the header.\n";
         return false;
     }
+    std::memcpy(&header, begin, sizeof(header));
 
     width_ = header.image_width;
     height_ = header.image_height;
@@ -54,22 +63,26 @@ bool TgaImage::read_tga_file(const std::string &filename) {
         return false;
     }
 
-    in.ignore(header.id_length);
-    if (!in.good()) {
+    const std::uint8_t *p = begin + sizeof(header);
+    if (static_cast<std::size_t>(end - p) < header.id_length) {
         std::cerr << "An error occured while skipping the image id.\n";
         return false;
     }
+    p += header.id_length;
 
-    uint32_t nbytes = width_ * height_ * bytespp_;
+    const std::size_t nbytes = static_cast<std::size_t>(width_) * height_ * bytespp_;
     data_ = std::vector<std::uint8_t>(nbytes, 0);
+    view_ = nullptr;
+    bottom_up_ = !(header.image_descriptor & 0x20);
     if (header.image_type == 2 || header.image_type == 3) {
-        in.read(reinterpret_cast<char *>(data_.data()), nbytes);
-        if (!in.good()) {
+        if (static_cast<std::size_t>(end - p) < nbytes) {
             std::cerr << "An error occured while reading the image data.\n";
             return false;
         }
+        std::memcpy(data_.data(), p, nbytes);
     } else if (header.image_type == 10 || header.image_type == 11) {
-        if (!load_rle_data(in)) {
+        if (!tga_rle_decode(p, end - p, static_cast<std::size_t>(width_) * height_,
+                            bytespp_, data_.data())) {
             std::cerr << "An error occured while reading the run-length "
                          "encoded image data.\n";
             return false;
@@ -82,9 +95,6 @@ bool TgaImage::read_tga_file(const std::string &filename) {
     if (header.image_descriptor & 0x10) {
         flip_horizontally();
     }
-    if (!(header.image_descriptor & 0x20)) {
-        flip_vertically();
-    }
 
     // WxH/Bits
     std::cerr << width_ << "x" << height_ << "/" << bytespp_ * 8 << '\n';
@@ -92,83 +102,25 @@ bool TgaImage::read_tga_file(const std::string &filename) {
     return true;
 }
 
-bool TgaImage::load_rle_data(std::ifstream &in) {
-    int npixels = width_ * height_;
-    int pixel_count = 0;
-    int byte_count = 0;
-
-    TgaColor color_buffer;
-    unsigned char packet_header = 0;
-    int nbytes = 0;
-    while (pixel_count < npixels) {
-        packet_header = in.get();
-        if (!in.good())
-            return false;
-
-        if (packet_header <= 127) {
-            packet_header++;
-            if (packet_header + pixel_count > npixels) {
-                std::cerr << "Read too many pixels.\n";
-                return false;
-            }
-
-            nbytes = packet_header * bytespp_;
-            in.read(reinterpret_cast<char *>(data_.data() + byte_count),
-                    nbytes);
-            if (!in.good())
-                return false;
-
-            byte_count += nbytes;
-        } else {
-            packet_header -= 127;
-            if (packet_header + pixel_count > npixels) {
-                std::cerr << "Read too many pixels.\n";
-                return false;
-            }
-
-            in.read(reinterpret_cast<char *>(color_buffer.bgra), bytespp_);
-            if (!in.good())
-                return false;
-            for (int i = 0; i < packet_header; ++i, byte_count += bytespp_) {
-                std::memcpy(data_.data() + byte_count, color_buffer.bgra,
-                            bytespp_);
-            }
-        }
-
-        pixel_count += packet_header;
-    }
-
-    return true;
-}
-
 bool TgaImage::flip_horizontally() {
-    for (int i = 0; i < height_; ++i) {
-        for (int j = 0; j < width_ / 2; ++j) {
-            for (int k = 0; k < bytespp_; ++k) {
-                std::swap(data_[(i * width_ + j) * bytespp_ + k],
-                          data_[(i * width_ + width_ - 1 - j) * bytespp_ + k]);
-            }
-        }
-    }
-
+    flip_columns(data(), width_, height_, bytespp_);
     return true;
 }
 
 bool TgaImage::flip_vertically() {
-    for (int i = 0; i < width_; ++i) {
-        for (int j = 0; j < height_ / 2; ++j) {
-            for (int k = 0; k < bytespp_; ++k) {
-                std::swap(
-                    data_[(j * width_ + i) * bytespp_ + k],
-                    data_[((height_ - 1 - j) * width_ + i) * bytespp_ + k]);
-            }
-        }
-    }
+    flip_rows(data(), width_, height_, bytespp_);
     return true;
 }
 
-bool TgaImage::write_tga_file(const std::string &filename, const bool is_v_flip,
+bool TgaImage::write_tga_file(const std::string &filename,
+                              [[maybe_unused]] const bool is_v_flip,
                               const bool is_rle) const {
+    std::vector<std::uint8_t> buffer;
+    return write_tga_file(filename, is_rle, buffer);
+}
+
+bool TgaImage::write_tga_file(const std::string &filename, const bool is_rle,
+                              std::vector<std::uint8_t> &buffer) const {
     std::ofstream out(filename, std::ios::binary);
 
     if (!out.is_open()) {
@@ -183,75 +135,38 @@ bool TgaImage::write_tga_file(const std::string &filename, const bool is_v_flip,
     tga_header.image_height = height_;
     tga_header.pixel_depth = bytespp_ << 3;
     tga_header.image_descriptor =
-        is_v_flip ? 0x00 : 0x20; // bottom-left origin or top-left origin
-    out.write(reinterpret_cast<char *>(&tga_header), sizeof(tga_header));
-    if (!out.good()) {
-        std::cerr << "An error occured while writing the tga header.\n";
-        return false;
-    }
+        bottom_up_ ? 0x00 : 0x20; // bottom-left origin or top-left origin
 
     if (is_rle) {
-        if (!save_rle_data(out)) {
+        // 文件头与编码后的数据放在同一个缓冲区, 一次写入
+        buffer.resize(sizeof(tga_header) + tga_rle_bound(width_, height_, bytespp_));
+        std::memcpy(buffer.data(), &tga_header, sizeof(tga_header));
+        const std::size_t size = tga_rle_encode(
+            data(), width_, height_, bytespp_, buffer.data() + sizeof(tga_header));
+        if (!size) {
             std::cerr << "An error occured while saving the run-length encoded "
                          "image data.\n";
             return false;
         }
-    } else {
-        out.write(reinterpret_cast<const char *>(data_.data()),
-                  width_ * height_ * bytespp_);
+        out.write(reinterpret_cast<const char *>(buffer.data()),
+                  sizeof(tga_header) + size);
         if (!out.good()) {
-            std::cerr << "An error occured while writing the image data.\n";
+            std::cerr << "An error occured while saving the run-length encoded "
+                         "image data.\n";
             return false;
         }
-    }
-
-    return true;
-}
-
-bool TgaImage::save_rle_data(std::ofstream &out) const {
-    int max_packet_length = 128;
-    int npixels = width_ * height_;
-    int cur_pixel = 0;
-
-    int packet_shart = 0;
-
-    while (cur_pixel < npixels) {
-        uint8_t run_length = 1;
-        uint32_t cur_byte = cur_pixel * bytespp_;
-        bool is_raw = true;
-        while (cur_pixel + run_length < npixels &&
-               run_length < max_packet_length) {
-            bool is_same = true;
-            for (int i = 0; is_same && i < bytespp_; ++i) {
-                is_same = data_[cur_byte + i] == data_[cur_byte + bytespp_ + i];
-            }
-            if (run_length == 1)
-                is_raw = !is_same;
-
-            if (is_same && is_raw) {
-                run_length--;
-                break;
-            }
-
-            if (!is_same && !is_raw) {
-                break;
-            }
-
-            cur_byte += bytespp_;
-            run_length++;
-        }
-
-        out.put(is_raw ? run_length - 1 : run_length + 127);
-        if (!out.good())
+    } else {
+        out.write(reinterpret_cast<char *>(&tga_header), sizeof(tga_header));
+        if (!out.good()) {
+            std::cerr << "An error occured while writing the tga header.\n";
             return false;
-
-        out.write(
-            reinterpret_cast<const char *>(data_.data() + cur_pixel * bytespp_),
-            is_raw ? run_length * bytespp_ : bytespp_);
-        if (!out.good())
+        }
+        out.write(reinterpret_cast<const char *>(data()),
+                  static_cast<std::size_t>(width_) * height_ * bytespp_);
+        if (!out.good()) {
+            std::cerr << "An error occured while writing the image data.\n";
             return false;
-
-        cur_pixel += run_length;
+        }
     }
 
     return true;
@@ -0,0 +1,193 @@
+#include "tga_rle.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RENDERER_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr int max_packet_length = 128;
+// 每个行带的行数, 行带是并行编码的单位
+constexpr int band_rows = 16;
+
+template <int Bytespp>
+inline bool same_pixel(const std::uint8_t *a, const std::uint8_t *b) {
+    return std::memcmp(a, b, Bytespp) == 0;
+}
+
+#ifdef RENDERER_SSE
+// 16 字节窗口内能完整比较的像素个数
+template <int Bytespp> constexpr int window_pixels = 16 / Bytespp;
+
+// 由逐字节相等的掩码得到逐像素相等的掩码: 像素 j 的所有字节都相等时第 j * Bytespp 位为 1
+template <int Bytespp> inline unsigned pixel_mask(unsigned byte_mask) {
+    if constexpr (Bytespp == 1) {
+        return byte_mask;
+    } else if constexpr (Bytespp == 3) {
+        return byte_mask & byte_mask >> 1 & byte_mask >> 2 & 0x1249u;
+    } else {
+        return byte_mask & byte_mask >> 1 & byte_mask >> 2 & byte_mask >> 3 &
+               0x1111u;
+    }
+}
+#endif
+
+// 从第 begin 个像素开始与其相同的连续像素个数, 不超过 end - begin
+template <int Bytespp>
+int run_length(const std::uint8_t *row, int width, int begin, int end) {
+    const std::uint8_t *first = row + begin * Bytespp;
+    int k = begin + 1;
+#ifdef RENDERER_SSE
+    // 把第一个像素平铺成 16 字节, 窗口从像素边界开始, 相位与平铺一致
+    alignas(16) std::uint8_t tiled[16];
+    for (int j = 0; j < 16; ++j) tiled[j] = first[j % Bytespp];
+    const __m128i pattern = _mm_load_si128(reinterpret_cast<const __m128i *>(tiled));
+    while (k < end && (k * Bytespp + 16) <= width * Bytespp) {
+        const __m128i window =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + k * Bytespp));
+        const unsigned diff =
+            ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(window, pattern)));
+        const int matched = __builtin_ctz(diff | 0x10000u) / Bytespp;
+        if (matched < window_pixels<Bytespp>) return std::min(k + matched, end) - begin;
+        k += window_pixels<Bytespp>;
+    }
+#endif
+    while (k < end && same_pixel<Bytespp>(row + k * Bytespp, first)) ++k;
+    return std::min(k, end) - begin;
+}
+
+// 从第 begin 个像素开始的原始包长度: 遇到与下一个像素相同的像素时停止, 它是下一个重复包的开头
+// 调用方保证第 begin 个像素与下一个像素不同, 结果不超过 end - begin
+template <int Bytespp>
+int raw_length(const std::uint8_t *row, int width, int begin, int end) {
+    int k = begin + 1;
+#ifdef RENDERER_SSE
+    while (k < end && ((k + 1) * Bytespp + 16) <= width * Bytespp) {
+        const __m128i a =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + k * Bytespp));
+        const __m128i b = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(row + (k + 1) * Bytespp));
+        const unsigned same = pixel_mask<Bytespp>(
+            static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))));
+        if (same) return std::min(k + __builtin_ctz(same) / Bytespp, end) - begin;
+        k += window_pixels<Bytespp>;
+    }
+#endif
+    while (k < end && !(k + 1 < width && same_pixel<Bytespp>(row + k * Bytespp,
+                                                            row + (k + 1) * Bytespp)))
+        ++k;
+    return std::min(k, end) - begin;
+}
+
+template <int Bytespp>
+std::uint8_t *encode_row(const std::uint8_t *row, int width, std::uint8_t *out) {
+    int i = 0;
+    while (i < width) {
+        const std::uint8_t *pixel = row + i * Bytespp;
+        const int end = std::min(width, i + max_packet_length);
+        if (i + 1 < width && same_pixel<Bytespp>(pixel, pixel + Bytespp)) {
+            const int n = run_length<Bytespp>(row, width, i, end);
+            *out++ = static_cast<std::uint8_t>(n + 127);
+            std::memcpy(out, pixel, Bytespp);
+            out += Bytespp;
+            i += n;
+        } else {
+            const int n = raw_length<Bytespp>(row, width, i, end);
+            *out++ = static_cast<std::uint8_t>(n - 1);
+            std::memcpy(out, pixel, n * Bytespp);
+            out += n * Bytespp;
+            i += n;
+        }
+    }
+    return out;
+}
+
+template <int Bytespp>
+std::size_t encode(const std::uint8_t *pixels, int width, int height,
+                   std::uint8_t *out) {
+    // 每个行带先写到自己在 out 中的区域, 区域大小为行带的最大编码长度
+    const std::size_t row_bound = tga_rle_bound(width, 1, Bytespp);
+    const std::size_t row_bytes = static_cast<std::size_t>(width) * Bytespp;
+    const int bands = (height + band_rows - 1) / band_rows;
+    std::vector<std::size_t> band_size(bands);
+#pragma omp parallel for schedule(dynamic) if (bands > 1 && row_bytes * height > (1 << 18))
+    for (int band = 0; band < bands; ++band) {
+        std::uint8_t *band_out = out + band * band_rows * row_bound;
+        std::uint8_t *p = band_out;
+        for (int y = band * band_rows; y < std::min(height, (band + 1) * band_rows); ++y)
+            p = encode_row<Bytespp>(pixels + y * row_bytes, width, p);
+        band_size[band] = p - band_out;
+    }
+
+    // 按顺序拼接, 目标位置不超过源位置, 从前往后移动不会覆盖未移动的数据
+    std::size_t size = 0;
+    for (int band = 0; band < bands; ++band) {
+        std::memmove(out + size, out + band * band_rows * row_bound, band_size[band]);
+        size += band_size[band];
+    }
+    return size;
+}
+
+template <int Bytespp>
+std::size_t decode(const std::uint8_t *in, std::size_t size, std::size_t npixels,
+                   std::uint8_t *pixels) {
+    const std::uint8_t *p = in, *in_end = in + size;
+    std::size_t count = 0;
+    while (count < npixels) {
+        if (p == in_end) return 0;
+        const std::uint8_t header = *p++;
+        if (header < 128) {
+            const std::size_t n = header + 1;
+            if (count + n > npixels || static_cast<std::size_t>(in_end - p) < n * Bytespp)
+                return 0;
+            std::memcpy(pixels + count * Bytespp, p, n * Bytespp);
+            p += n * Bytespp;
+            count += n;
+        } else {
+            const std::size_t n = header - 127;
+            if (count + n > npixels || in_end - p < Bytespp) return 0;
+            std::uint8_t *dst = pixels + count * Bytespp;
+            if constexpr (Bytespp == 1) {
+                std::memset(dst, *p, n);
+            } else {
+                for (std::size_t j = 0; j < n; ++j, dst += Bytespp)
+                    std::memcpy(dst, p, Bytespp);
+            }
+            p += Bytespp;
+            count += n;
+        }
+    }
+    return p - in;
+}
+
+} // namespace
+
+std::size_t tga_rle_bound(int width, int height, int bytespp) {
+    // 最坏情况下每个像素单独带一个包头
+    return static_cast<std::size_t>(width) * height * (bytespp + 1);
+}
+
+std::size_t tga_rle_encode(const std::uint8_t *pixels, int width, int height,
+                           int bytespp, std::uint8_t *out) {
+    switch (bytespp) {
+    case 1: return encode<1>(pixels, width, height, out);
+    case 3: return encode<3>(pixels, width, height, out);
+    case 4: return encode<4>(pixels, width, height, out);
+    default: return 0;
+    }
+}
+
+std::size_t tga_rle_decode(const std::uint8_t *in, std::size_t size,
+                           std::size_t npixels, int bytespp,
+                           std::uint8_t *pixels) {
+    switch (bytespp) {
+    case 1: return decode<1>(in, size, npixels, pixels);
+    case 3: return decode<3>(in, size, npixels, pixels);
+    case 4: return decode<4>(in, size, npixels, pixels);
+    default: return 0;
+    }
+}
@@ -0,0 +1,103 @@
+#include "vertex_stage.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define RENDERER_SSE 1
+#include <immintrin.h>
+#endif
+
+static_assert(sizeof(Vec3f) == 3 * sizeof(float),
+              "vertex stage reads Vec3f arrays as packed floats");
+
+namespace {
+
+// 每个线程一次处理的顶点个数
+constexpr int vertex_batch = 4096;
+
+// 视口变换, 运算顺序与 viewport_trans 相同:
+// x' = (x + 1) * (width - 1) / 2, 除以 2 与乘 0.5 结果完全相同
+// transform 不为空时先做仿射变换, 运算顺序与 Affine3f::apply 相同
+void transform_range(const float *in, int begin, int end, float scale_x,
+                     float scale_y, const Affine3f *transform, float *out_x,
+                     float *out_y, float *out_z) {
+    int i = begin;
+#ifdef RENDERER_SSE
+    __m128 m[3][3], t[3];
+    if (transform) {
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) m[r][c] = _mm_set1_ps(transform->m[r][c]);
+            t[r] = _mm_set1_ps(transform->t[r]);
+        }
+    }
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 sx = _mm_set1_ps(scale_x);
+    const __m128 sy = _mm_set1_ps(scale_y);
+    for (; i + 4 <= end; i += 4) {
+        // 4 个 AoS 顶点 x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3 转置为 SoA
+        const __m128 a = _mm_loadu_ps(in + i * 3);
+        const __m128 b = _mm_loadu_ps(in + i * 3 + 4);
+        const __m128 c = _mm_loadu_ps(in + i * 3 + 8);
+        __m128 x = _mm_shuffle_ps(
+            a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)),
+            _MM_SHUFFLE(2, 0, 3, 0));
+        __m128 y =
+            _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)),
+                           _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)),
+                           _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 z =
+            _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)),
+                           _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)),
+                           _MM_SHUFFLE(2, 0, 2, 0));
+        if (transform) {
+            __m128 p[3];
+            for (int r = 0; r < 3; ++r) {
+                p[r] = _mm_add_ps(
+                    _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[r][0], x), _mm_mul_ps(m[r][1], y)),
+                               _mm_mul_ps(m[r][2], z)),
+                    t[r]);
+            }
+            x = p[0], y = p[1], z = p[2];
+        }
+
+        _mm_storeu_ps(out_x + i,
+                      _mm_mul_ps(_mm_mul_ps(_mm_add_ps(x, one), sx), half));
+        _mm_storeu_ps(out_y + i,
+                      _mm_mul_ps(_mm_mul_ps(_mm_add_ps(y, one), sy), half));
+        _mm_storeu_ps(out_z + i, _mm_mul_ps(_mm_add_ps(z, one), half));
+    }
+#endif
+    for (; i < end; ++i) {
+        Vec3f p = {in[i * 3], in[i * 3 + 1], in[i * 3 + 2]};
+        if (transform) p = transform->apply(p);
+        out_x[i] = (p.x + 1.f) * scale_x * 0.5f;
+        out_y[i] = (p.y + 1.f) * scale_y * 0.5f;
+        out_z[i] = (p.z + 1.f) * 0.5f;
+    }
+}
+
+} // namespace
+
+void transform_vertices(const Model &model, const int width, const int height, Arena &arena,
+                        TransformedVertices &out, const Affine3f *transform) {
+    transform_vertices(model.vertex_data(), model.num_vertices(), width, height, arena, out,
+                       transform);
+}
+
+void transform_vertices(const Vec3f *positions, const int count, const int width,
+                        const int height, Arena &arena, TransformedVertices &out,
+                        const Affine3f *transform) {
+    const int n = count;
+    out.allocate(arena, n);
+    const float *in = reinterpret_cast<const float *>(positions);
+    const float scale_x = width - 1, scale_y = height - 1;
+
+    const int batches = (n + vertex_batch - 1) / vertex_batch;
+#pragma omp parallel for schedule(static) if (batches > 1)
+    for (int batch = 0; batch < batches; ++batch) {
+        transform_range(in, batch * vertex_batch,
+                        std::min(n, (batch + 1) * vertex_batch), scale_x,
+                        scale_y, transform, out.x.data(), out.y.data(),
+                        out.z.data());
+    }
+}
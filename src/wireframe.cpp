@@ -0,0 +1,113 @@
+#include "wireframe.h"
+#include "line_draw.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// 每个带的行数
+constexpr int band_rows = 64;
+// 像素坐标的范围, 变换后远在屏幕外的顶点截断到该范围, 画线时的整数运算不会溢出
+constexpr float coordinate_limit = 1 << 24;
+
+int to_pixel(float v) {
+    return static_cast<int>(std::floor(std::min(std::max(v + 0.5f, -coordinate_limit),
+                                                coordinate_limit)));
+}
+
+} // namespace
+
+void extract_edges(const Model &model, std::vector<Edge> &edges) {
+    // 边编码为 64 位整数 (a << 32 | b), 排序后去重
+    std::vector<std::uint64_t> keys;
+    keys.reserve(static_cast<std::size_t>(model.num_faces()) * 3);
+    for (int i = 0; i < model.num_faces(); ++i) {
+        for (int j = 0; j < 3; ++j) {
+            const int u = model.vertex_index(i, j);
+            const int v = model.vertex_index(i, (j + 1) % 3);
+            if (u == v) continue;
+            keys.push_back(static_cast<std::uint64_t>(std::min(u, v)) << 32 |
+                           static_cast<std::uint32_t>(std::max(u, v)));
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    edges.resize(keys.size());
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        edges[i] = {static_cast<int>(keys[i] >> 32), static_cast<int>(keys[i] & 0xffffffffu)};
+    }
+}
+
+template <PixelFormat Format>
+std::int64_t wireframe_rasterize(const Model &model, const std::vector<Edge> &edges,
+                                 Framebuffer<Format> &frame_buffer, PackedPixel color,
+                                 const Affine3f *transform, WireframeScratch *scratch) {
+    const int width = frame_buffer.get_width();
+    const int height = frame_buffer.get_height();
+    WireframeScratch local_scratch;
+    WireframeScratch &s = scratch ? *scratch : local_scratch;
+
+    // 顶点阶段, 然后四舍五入为像素坐标
+    s.arena.reset();
+    transform_vertices(model, width, height, s.arena, s.vertices, transform);
+    const int n = s.vertices.size();
+    s.x.allocate(s.arena, n);
+    s.y.allocate(s.arena, n);
+#pragma omp parallel for schedule(static) if (n > 65536)
+    for (int i = 0; i < n; ++i) {
+        s.x[i] = to_pixel(s.vertices.x[i]);
+        s.y[i] = to_pixel(s.vertices.y[i]);
+    }
+
+    // 按 y 范围把边分到各带, 完全在屏幕外的边不分配
+    const int bands = (height + band_rows - 1) / band_rows;
+    s.band_begin.assign(s.arena, bands + 1, 0);
+    auto band_range = [&](const Edge &edge, int &first, int &last) {
+        const int xa = s.x[edge.a], xb = s.x[edge.b];
+        const int ya = s.y[edge.a], yb = s.y[edge.b];
+        if (std::max(xa, xb) < 0 || std::min(xa, xb) > width - 1 ||
+            std::max(ya, yb) < 0 || std::min(ya, yb) > height - 1)
+            return false;
+        first = std::max(std::min(ya, yb), 0) / band_rows;
+        last = std::min(std::max(ya, yb), height - 1) / band_rows;
+        return true;
+    };
+    for (const Edge &edge : edges) {
+        int first, last;
+        if (!band_range(edge, first, last)) continue;
+        for (int band = first; band <= last; ++band) ++s.band_begin[band + 1];
+    }
+    for (int band = 0; band < bands; ++band) s.band_begin[band + 1] += s.band_begin[band];
+    s.bins.allocate(s.arena, s.band_begin[bands]);
+    for (int band = bands - 1; band >= 0; --band) s.band_begin[band + 1] = s.band_begin[band];
+    for (int i = 0; i < static_cast<int>(edges.size()); ++i) {
+        int first, last;
+        if (!band_range(edges[i], first, last)) continue;
+        for (int band = first; band <= last; ++band) s.bins[s.band_begin[band + 1]++] = i;
+    }
+
+    // 各带只写自己的行, 可以并行
+    std::int64_t drawn = 0;
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : drawn)
+    for (int band = 0; band < bands; ++band) {
+        const int y_min = band * band_rows;
+        const int y_max = std::min(y_min + band_rows, height) - 1;
+        for (int k = s.band_begin[band]; k < s.band_begin[band + 1]; ++k) {
+            const Edge &edge = edges[s.bins[k]];
+            drawn += line_draw(s.x[edge.a], s.y[edge.a], s.x[edge.b], s.y[edge.b],
+                               frame_buffer, color, y_min, y_max);
+        }
+    }
+    return drawn;
+}
+
+template std::int64_t wireframe_rasterize<PixelFormat::GRAYSCALE>(
+    const Model &, const std::vector<Edge> &, Framebuffer<PixelFormat::GRAYSCALE> &,
+    PackedPixel, const Affine3f *, WireframeScratch *);
+template std::int64_t wireframe_rasterize<PixelFormat::RGB>(
+    const Model &, const std::vector<Edge> &, Framebuffer<PixelFormat::RGB> &,
+    PackedPixel, const Affine3f *, WireframeScratch *);
+template std::int64_t wireframe_rasterize<PixelFormat::RGBA>(
+    const Model &, const std::vector<Edge> &, Framebuffer<PixelFormat::RGBA> &,
+    PackedPixel, const Affine3f *, WireframeScratch *);
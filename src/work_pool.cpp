@@ -0,0 +1,85 @@
+#include "work_pool.h"
+#include <algorithm>
+
+WorkPool::WorkPool(int threads, const std::function<void(int worker)> &init) {
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < threads; ++i) queues_.push_back(std::make_unique<Queue>());
+    for (int i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i, init] {
+            if (init) init(i);
+            work(i);
+        });
+    }
+}
+
+WorkPool::~WorkPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    batch_started_.notify_all();
+    for (auto &thread : threads_) thread.join();
+}
+
+bool WorkPool::next_task(int worker, int &task) {
+    {
+        Queue &own = *queues_[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    const int n = queues_.size();
+    for (int i = 1; i < n; ++i) {
+        Queue &victim = *queues_[(worker + i) % n];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkPool::work(int worker) {
+    unsigned seen = 0;
+    for (;;) {
+        const Task *task = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            batch_started_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) return;
+            seen = generation_;
+            task = task_;
+        }
+
+        // 任务在提交时已全部入队, 所有队列都空了说明本批没有可领取的任务
+        // 每个线程都要在取不到任务后登记, run 等所有线程登记后才返回,
+        // 所以不会有线程带着上一批的任务函数取到下一批的任务
+        int index = 0;
+        while (next_task(worker, index)) (*task)(index, worker);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (++idle_workers_ == size()) batch_finished_.notify_all();
+    }
+}
+
+void WorkPool::run(int count, const Task &task) {
+    if (count <= 0) return;
+    const int n = queues_.size();
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (int i = 0; i < count; ++i) {
+        Queue &queue = *queues_[i % n];
+        std::lock_guard<std::mutex> queue_lock(queue.mutex);
+        queue.tasks.push_back(i);
+    }
+    task_ = &task;
+    idle_workers_ = 0;
+    ++generation_;
+    batch_started_.notify_all();
+    batch_finished_.wait(lock, [this] { return idle_workers_ == size(); });
+    task_ = nullptr;
+}